@@ -0,0 +1,188 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "MB/modbusUtils.hpp"
+#include "allocationCounter.hpp"
+#include "benchmark/benchmark.h"
+
+#include <array>
+
+using namespace MB;
+
+namespace {
+constexpr std::array<utils::MBFunctionCode, 8> FunctionCodes = {
+    utils::ReadDiscreteOutputCoils,
+    utils::ReadDiscreteInputContacts,
+    utils::ReadAnalogOutputHoldingRegisters,
+    utils::ReadAnalogInputRegisters,
+    utils::WriteSingleDiscreteOutputCoil,
+    utils::WriteSingleAnalogOutputRegister,
+    utils::WriteMultipleDiscreteOutputCoils,
+    utils::WriteMultipleAnalogOutputHoldingRegisters};
+
+bool isCoil(utils::MBFunctionCode functionCode) {
+  const auto registers = utils::functionRegister(functionCode);
+  return registers == utils::OutputCoils || registers == utils::InputContacts;
+}
+
+// Largest count that fits in a single frame
+int64_t maxCount(utils::MBFunctionCode functionCode) {
+  switch (functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+    return 2000;
+  case utils::WriteMultipleDiscreteOutputCoils:
+    return 1968;
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters:
+    return 125;
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    return 123;
+  default:
+    return 1;
+  }
+}
+
+// Arguments: function code, number of values
+void functionCodesAndSizes(benchmark::internal::Benchmark *benchmark) {
+  for (const auto functionCode : FunctionCodes) {
+    const auto max = maxCount(functionCode);
+    benchmark->Args({functionCode, 1});
+    if (max > 16)
+      benchmark->Args({functionCode, 16});
+    if (max > 1)
+      benchmark->Args({functionCode, max});
+  }
+}
+
+ModbusCells values(utils::MBFunctionCode functionCode, uint16_t count) {
+  ModbusCells cells;
+  for (uint16_t i = 0; i < count; i++) {
+    if (isCoil(functionCode))
+      cells.push_back(ModbusCell(i % 3 == 0));
+    else
+      cells.push_back(ModbusCell(static_cast<uint16_t>(i * 7)));
+  }
+  return cells;
+}
+
+ModbusRequest makeRequest(const benchmark::State &state) {
+  const auto functionCode = static_cast<utils::MBFunctionCode>(state.range(0));
+  const auto count = static_cast<uint16_t>(state.range(1));
+
+  switch (utils::functionType(functionCode)) {
+  case utils::Read:
+    return ModbusRequest(1, functionCode, 100, count);
+  default:
+    return ModbusRequest(1, functionCode, 100, count,
+                         values(functionCode, count));
+  }
+}
+
+ModbusResponse makeResponse(const benchmark::State &state) {
+  const auto functionCode = static_cast<utils::MBFunctionCode>(state.range(0));
+  const auto count = static_cast<uint16_t>(state.range(1));
+
+  switch (utils::functionType(functionCode)) {
+  case utils::WriteMultiple:
+    return ModbusResponse(1, functionCode, 100, count);
+  default:
+    return ModbusResponse(1, functionCode, 100, count,
+                          values(functionCode, count));
+  }
+}
+
+void label(benchmark::State &state) {
+  state.SetLabel(utils::mbFunctionToStr(
+      static_cast<utils::MBFunctionCode>(state.range(0))));
+}
+
+//! Reports heap allocations per iteration
+void report(benchmark::State &state, const Allocations::Counter &counter) {
+  state.counters["allocations"] =
+      benchmark::Counter(static_cast<double>(counter.count()),
+                         benchmark::Counter::kAvgIterations);
+}
+} // namespace
+
+static void BM_RequestParse(benchmark::State &state) {
+  const auto raw = makeRequest(state).toRaw();
+  Allocations::Counter counter;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(ModbusRequest::fromRaw(raw));
+  state.SetBytesProcessed(state.iterations() * int64_t(raw.size()));
+  report(state, counter);
+  label(state);
+}
+BENCHMARK(BM_RequestParse)->Apply(functionCodesAndSizes);
+
+static void BM_RequestToRaw(benchmark::State &state) {
+  const auto request = makeRequest(state);
+  Allocations::Counter counter;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(request.toRaw());
+  report(state, counter);
+  label(state);
+}
+BENCHMARK(BM_RequestToRaw)->Apply(functionCodesAndSizes);
+
+static void BM_ResponseParse(benchmark::State &state) {
+  const auto raw = makeResponse(state).toRaw();
+  Allocations::Counter counter;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(ModbusResponse::fromRaw(raw));
+  state.SetBytesProcessed(state.iterations() * int64_t(raw.size()));
+  report(state, counter);
+  label(state);
+}
+BENCHMARK(BM_ResponseParse)->Apply(functionCodesAndSizes);
+
+static void BM_ResponseToRaw(benchmark::State &state) {
+  const auto response = makeResponse(state);
+  Allocations::Counter counter;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(response.toRaw());
+  report(state, counter);
+  label(state);
+}
+BENCHMARK(BM_ResponseToRaw)->Apply(functionCodesAndSizes);
+
+static void BM_CalculateCRC(benchmark::State &state) {
+  std::vector<uint8_t> data(static_cast<std::size_t>(state.range(0)));
+  for (std::size_t i = 0; i < data.size(); i++)
+    data[i] = static_cast<uint8_t>(i * 31);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(data.data());
+    benchmark::DoNotOptimize(utils::calculateCRC(data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CalculateCRC)->RangeMultiplier(4)->Range(4, 256);
+
+static void BM_CellRegister(benchmark::State &state) {
+  const auto cells = values(utils::ReadAnalogOutputHoldingRegisters, 125);
+  for (auto _ : state) {
+    uint32_t sum = 0;
+    for (const auto &cell : cells)
+      sum += cell.reg();
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(cells.size()));
+}
+BENCHMARK(BM_CellRegister);
+
+static void BM_CellCoil(benchmark::State &state) {
+  const auto cells = values(utils::ReadDiscreteOutputCoils, 2000);
+  for (auto _ : state) {
+    uint32_t set = 0;
+    for (const auto &cell : cells)
+      set += cell.coil();
+    benchmark::DoNotOptimize(set);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(cells.size()));
+}
+BENCHMARK(BM_CellCoil);
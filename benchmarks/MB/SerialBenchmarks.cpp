@@ -0,0 +1,99 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/Serial/connection.hpp"
+#include "allocationCounter.hpp"
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+#include <stdlib.h>
+#include <thread>
+
+using namespace MB;
+
+namespace {
+// Slave side of pseudo terminal, answers every read request from master
+class PtyResponder {
+private:
+  int _master;
+  std::string _path;
+  std::atomic<bool> _stop = false;
+  std::thread _thread;
+
+  void run(std::vector<uint8_t> response) {
+    std::vector<uint8_t> request;
+    std::array<uint8_t, 256> buffer;
+    while (!_stop.load(std::memory_order_relaxed)) {
+      pollfd waitingFD = {.fd = _master, .events = POLLIN, .revents = 0};
+      if (::poll(&waitingFD, 1, 10) <= 0)
+        continue;
+
+      const auto size = ::read(_master, buffer.data(), buffer.size());
+      if (size <= 0)
+        continue;
+      request.insert(request.end(), buffer.begin(), buffer.begin() + size);
+      // Read requests are always 8 bytes long with CRC
+      if (request.size() >= 8) {
+        request.clear();
+        if (::write(_master, response.data(), response.size()) < 0)
+          return;
+      }
+    }
+  }
+
+public:
+  explicit PtyResponder(std::vector<uint8_t> response) {
+    _master = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (_master < 0 || ::grantpt(_master) != 0 || ::unlockpt(_master) != 0)
+      throw std::runtime_error("Cannot open pseudo terminal");
+    _path = ::ptsname(_master);
+
+    termios tty = {};
+    ::tcgetattr(_master, &tty);
+    ::cfmakeraw(&tty);
+    ::tcsetattr(_master, TCSANOW, &tty);
+
+    _thread = std::thread([this, response = std::move(response)] {
+      run(response);
+    });
+  }
+
+  ~PtyResponder() {
+    _stop = true;
+    _thread.join();
+    ::close(_master);
+  }
+
+  [[nodiscard]] const std::string &path() const { return _path; }
+};
+} // namespace
+
+// Request and response over pseudo terminal, there is no baud rate delay
+static void BM_SerialRoundTrip(benchmark::State &state) {
+  const auto count = static_cast<uint16_t>(state.range(0));
+  const ModbusRequest request(1, utils::ReadAnalogOutputHoldingRegisters, 0,
+                              count);
+
+  auto response = ModbusResponse(1, utils::ReadAnalogOutputHoldingRegisters, 0,
+                                 count, ModbusCells(count, ModbusCell(uint16_t(7))))
+                      .toRaw();
+  const auto crc = utils::calculateCRC(response);
+  response.push_back(static_cast<uint8_t>(crc));
+  response.push_back(static_cast<uint8_t>(crc >> 8));
+
+  PtyResponder responder(response);
+  Serial::Connection connection(responder.path());
+  connection.setBaudRate(115200);
+  connection.connect();
+
+  Allocations::Counter counter;
+  for (auto _ : state) {
+    connection.sendRequest(request);
+    benchmark::DoNotOptimize(connection.awaitResponse());
+  }
+  state.counters["allocations"] =
+      benchmark::Counter(static_cast<double>(counter.count()),
+                         benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SerialRoundTrip)->Arg(1)->Arg(125)->UseRealTime();
@@ -0,0 +1,21 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusStats.hpp"
+#include "benchmark/benchmark.h"
+
+using namespace MB;
+
+namespace {
+// Cost of a single empty measured scope, target is below 50 ns. Without
+// MODBUS_STATS it measures the empty loop.
+void BM_StatsScope(benchmark::State &state) {
+  for (auto _ : state) {
+    MODBUS_STATS_SCOPE(Stats::Handler);
+    benchmark::ClobberMemory();
+  }
+  state.SetLabel(Stats::Enabled ? "stats" : "no stats");
+}
+BENCHMARK(BM_StatsScope)->ThreadRange(1, 4);
+} // namespace
@@ -0,0 +1,53 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/TCP/connection.hpp"
+#include "MB/TCP/server.hpp"
+#include "allocationCounter.hpp"
+#include "benchmark/benchmark.h"
+
+#include <thread>
+
+using namespace MB;
+
+namespace {
+constexpr int Port = 15503;
+} // namespace
+
+// Request and response over loopback, server answers from its own thread
+static void BM_TCPRoundTrip(benchmark::State &state) {
+  const auto count = static_cast<uint16_t>(state.range(0));
+  TCP::Server server(Port);
+
+  std::thread responder([&] {
+    auto connection = server.awaitConnection();
+    ModbusCells values(count, ModbusCell(uint16_t(0x1234)));
+    try {
+      while (true) {
+        auto request = connection.awaitRequest();
+        connection.sendResponse(ModbusResponse(
+            request.slaveID(), request.functionCode(), request.registerAddress(),
+            request.numberOfRegisters(), values));
+      }
+    } catch (const ModbusException &) {
+      // Client has disconnected
+    }
+  });
+
+  {
+    auto client = TCP::Connection::with("127.0.0.1", Port);
+    const ModbusRequest request(1, utils::ReadAnalogOutputHoldingRegisters, 0,
+                                count);
+    Allocations::Counter counter;
+    for (auto _ : state) {
+      client.sendRequest(request);
+      benchmark::DoNotOptimize(client.awaitResponse());
+    }
+    state.counters["allocations"] =
+        benchmark::Counter(static_cast<double>(counter.count()),
+                           benchmark::Counter::kAvgIterations);
+  }
+  responder.join();
+}
+BENCHMARK(BM_TCPRoundTrip)->Arg(1)->Arg(125)->UseRealTime();
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <memory>
+#include <memory_resource>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -16,6 +18,7 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include "MB/flightRecorder.hpp"
 #include "MB/modbusException.hpp"
 #include "MB/modbusRequest.hpp"
 #include "MB/modbusResponse.hpp"
@@ -32,6 +35,7 @@ private:
   int _fd;
 
   int _timeout = Connection::DefaultSerialTimeout;
+  std::shared_ptr<FlightRecorder> _recorder;
 
 public:
   constexpr explicit Connection() : _termios(), _fd(-1) {}
@@ -59,6 +63,9 @@ public:
   [[nodiscard]] std::tuple<MB::ModbusRequest, std::vector<uint8_t>> awaitRequest();
 
   [[nodiscard]] std::vector<uint8_t> awaitRawMessage();
+  //! awaitRawMessage() allocating from the given resource
+  [[nodiscard]] std::pmr::vector<uint8_t>
+  awaitRawMessage(std::pmr::memory_resource *resource);
 
   void enableParity(const bool parity) {
     if (parity)
@@ -123,5 +130,14 @@ public:
   int getTimeout() const { return _timeout; }
 
   void setTimeout(int timeout) { _timeout = timeout; }
+
+  //! Records sent and received frames, nullptr disables recording
+  void setFlightRecorder(std::shared_ptr<FlightRecorder> recorder) {
+    _recorder = std::move(recorder);
+  }
+
+  [[nodiscard]] const std::shared_ptr<FlightRecorder> &flightRecorder() const {
+    return _recorder;
+  }
 };
 } // namespace MB::Serial
@@ -0,0 +1,101 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "MB/modbusException.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "ring.hpp"
+
+namespace MB::Shm {
+struct Segment;
+
+/**
+ * @brief Modbus over a pair of shared memory rings (requests and responses).
+ *
+ * Frames use MBAP header, like Modbus TCP. Frames are encoded into a stack
+ * buffer and copied into the ring with a single memcpy, requests/responses
+ * are parsed from ring memory, so neither side allocates for frames with up
+ * to 16 values. Each segment connects single client with single server.
+ * Every frame is tagged with generation of the client it belongs to, so
+ * requests and responses of a client that went away are dropped by the
+ * receiving side, even if they are written after the next one attaches.
+ *
+ * Unlike socket connections send* methods do not return the raw frame, as
+ * that would need a copy.
+ */
+class Connection {
+public:
+  static const unsigned int DefaultShmTimeout = 500;
+  //! Busy poll iterations before sleeping, a few microseconds
+  static const unsigned int DefaultSpin = 4000;
+
+private:
+  Segment *_segment = nullptr;
+  std::size_t _size = 0;
+  bool _client = false;
+  //! Generation of the client, frames of other generations are stale
+  uint32_t _generation = 0;
+  Ring _input;
+  Ring _output;
+
+  uint16_t _messageID = 0;
+  int _timeout = Connection::DefaultShmTimeout;
+  unsigned _spin = Connection::DefaultSpin;
+
+  Connection(Segment *segment, std::size_t size, bool client) noexcept;
+  void unmap() noexcept;
+  template <typename Message> void send(const Message &message);
+  std::span<const uint8_t> receive(int timeout, utils::MBErrorCode timeoutError);
+
+  friend class Server;
+
+public:
+  explicit Connection() noexcept = default;
+  Connection(const Connection &) = delete;
+  Connection(Connection &&moved) noexcept;
+  Connection &operator=(Connection &&other) noexcept;
+  ~Connection();
+
+  /**
+   * @brief Attaches as the client of segment created by Server.
+   * @throws std::runtime_error - When segment does not exist or already has
+   * a client.
+   */
+  static Connection with(const std::string &name);
+
+  void sendRequest(const MB::ModbusRequest &req);
+  void sendResponse(const MB::ModbusResponse &res);
+  void sendException(const MB::ModbusException &ex);
+
+  //! Values that do not fit inline come from resource
+  [[nodiscard]] MB::ModbusRequest
+  awaitRequest(std::pmr::memory_resource *resource =
+                   std::pmr::get_default_resource());
+  //! Values that do not fit inline come from resource
+  [[nodiscard]] MB::ModbusResponse
+  awaitResponse(std::pmr::memory_resource *resource =
+                    std::pmr::get_default_resource());
+
+  //! Returns copy of a single frame with MBAP header
+  [[nodiscard]] std::vector<uint8_t> awaitRawMessage();
+
+  [[nodiscard]] uint16_t getMessageId() const { return _messageID; }
+
+  void setMessageId(uint16_t messageId) { _messageID = messageId; }
+
+  //! Milliseconds awaitResponse() waits for a frame
+  [[nodiscard]] int getTimeout() const { return _timeout; }
+
+  void setTimeout(int timeout) { _timeout = timeout; }
+
+  //! Number of busy poll checks before sleeping, 0 sleeps right away
+  void setSpin(unsigned spin) { _spin = spin; }
+};
+} // namespace MB::Shm
@@ -0,0 +1,89 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace MB::Shm {
+/**
+ * @brief Control block of a ring, placed in shared memory before its data.
+ *
+ * Positions grow forever and are masked with capacity. Sequence words are
+ * futex words, bumped only when the other side announced it is sleeping.
+ */
+struct RingHeader {
+  alignas(64) std::atomic<uint64_t> head{0};
+  std::atomic<uint32_t> spaceSequence{0};
+  std::atomic<uint32_t> producerWaiting{0};
+
+  alignas(64) std::atomic<uint64_t> tail{0};
+  std::atomic<uint32_t> dataSequence{0};
+  std::atomic<uint32_t> consumerWaiting{0};
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                    std::atomic<uint32_t>::is_always_lock_free,
+                "Shared memory ring needs address free atomics");
+};
+
+/**
+ * @brief Single-producer single-consumer ring of frames in shared memory.
+ *
+ * Does not own memory, any process mapping the same header and data may use
+ * it. Frames are stored contiguously (prefixed with their size), so reader
+ * gets a view straight into the ring. Waiting spins first, then sleeps on
+ * a futex.
+ */
+class Ring {
+public:
+  //! Bytes taken by a frame of given size, including prefix and alignment
+  static constexpr std::size_t recordSize(std::size_t frameSize) noexcept {
+    return (sizeof(uint32_t) + frameSize + 3) & ~std::size_t(3);
+  }
+
+private:
+  RingHeader *_header = nullptr;
+  uint8_t *_data = nullptr;
+  std::size_t _capacity = 0;
+  // Size of the record returned by read(), freed by release()
+  std::size_t _reading = 0;
+
+public:
+  Ring() noexcept = default;
+
+  /**
+   * @brief Creates view of a ring.
+   * @param capacity - Size of data, power of two.
+   */
+  Ring(RingHeader *header, uint8_t *data, std::size_t capacity) noexcept
+      : _header(header), _data(data), _capacity(capacity) {}
+
+  [[nodiscard]] std::size_t capacity() const noexcept { return _capacity; }
+
+  /**
+   * @brief Writes first and second part as a single frame.
+   * @param timeout - Milliseconds to wait for space, negative waits forever.
+   * @param spin - Number of checks before going to sleep.
+   * @return False if there was no space before timeout.
+   */
+  bool write(std::span<const uint8_t> first, std::span<const uint8_t> second,
+             int timeout, unsigned spin);
+
+  /**
+   * @brief Waits for frame, see write() for timeout and spin.
+   * @return View of the frame, valid until release(), empty on timeout.
+   */
+  [[nodiscard]] std::span<const uint8_t> read(int timeout, unsigned spin);
+
+  //! Frees frame returned by read()
+  void release() noexcept;
+
+  //! Drops all frames, only consumer may call it
+  void clear() noexcept;
+
+};
+} // namespace MB::Shm
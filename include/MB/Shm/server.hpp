@@ -0,0 +1,48 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <string>
+
+#include "connection.hpp"
+
+namespace MB::Shm {
+/**
+ * @brief Creates shared memory segment (shm_open) that a client may attach
+ * to. Segment left by a previous server with the same name is replaced,
+ * segment is removed when server is destroyed.
+ */
+class Server {
+public:
+  static const std::size_t DefaultCapacity = 64 * 1024;
+
+private:
+  std::string _name;
+  Segment *_segment = nullptr;
+  std::size_t _size = 0;
+
+public:
+  /**
+   * @brief Creates segment.
+   * @param name - Name for shm_open, ex. "/modbus-gateway".
+   * @param capacity - Bytes of each ring, rounded up to power of two.
+   */
+  explicit Server(const std::string &name,
+                  std::size_t capacity = DefaultCapacity);
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  [[nodiscard]] const std::string &name() const { return _name; }
+
+  /**
+   * @brief Waits until client attaches.
+   * @param timeout - Milliseconds to wait, negative waits forever.
+   * @throws ModbusException - Timeout.
+   */
+  Connection awaitConnection(int timeout = -1);
+};
+} // namespace MB::Shm
@@ -0,0 +1,187 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+#include "../modbusProtocol.hpp"
+#include "../mpscQueue.hpp"
+#include "server.hpp"
+
+namespace MB {
+namespace TCP {
+
+/**
+ * @brief Modbus TCP server whose handlers may complete requests later, from
+ * any thread.
+ *
+ * All connections are served by a single poll loop in run(). Every request
+ * is passed to the handler together with a Responder, the loop keeps
+ * reading and dispatching further requests while earlier ones are still
+ * pending, and each response is sent with transaction id of its request as
+ * soon as it is completed. A slow request (ex. forwarded to RTU bus) does
+ * not hold back the rest of the connection.
+ *
+ * Connection that has too many requests in flight, or too much output its
+ * peer did not read yet, is not read from until it drains.
+ */
+class AsyncServer {
+public:
+  static constexpr std::size_t DefaultCompletionCapacity = 1024;
+  //! Requests of a connection handled at once, before reading is paused
+  static constexpr std::size_t MaxInFlight = 256;
+  //! Unsent bytes of a connection, before reading is paused
+  static constexpr std::size_t MaxPendingOutput = 64 * 1024;
+
+private:
+  struct Completion {
+    uint64_t connection;
+    uint16_t transactionId;
+    std::optional<ModbusResponse> response;
+    std::optional<ModbusException> error;
+  };
+
+  // Shared with responders, which may outlive the server
+  struct Completions {
+    utils::MPSCQueue<Completion> queue;
+    //! eventfd (pipe if unavailable) that wakes the poll loop
+    int readFd = -1;
+    int writeFd = -1;
+    //! Set when server is destroyed, completions are dropped then
+    std::atomic<bool> closed = false;
+
+    explicit Completions(std::size_t capacity);
+    ~Completions();
+    void push(Completion &&completion);
+    void wake() const noexcept;
+  };
+
+  struct Session {
+    int fd;
+    Protocol::TCPServer protocol;
+    //! Requests passed to handler and not responded yet
+    std::size_t inFlight = 0;
+
+    [[nodiscard]] bool throttled() const noexcept {
+      return inFlight >= MaxInFlight ||
+             protocol.pendingOutput().size() >= MaxPendingOutput;
+    }
+  };
+
+public:
+  /**
+   * @brief Completes a single request, may be moved to and used from any
+   * thread. Only the first respond() call is sent. Responder destroyed
+   * without respond() sends nothing (like slaves do for broadcasts) and
+   * frees the request's MaxInFlight slot of its connection.
+   */
+  class Responder {
+  private:
+    //! Empty once the request is answered or released
+    std::shared_ptr<Completions> _completions;
+    uint64_t _connection;
+    uint16_t _transactionId;
+
+    Responder(std::shared_ptr<Completions> completions, uint64_t connection,
+              uint16_t transactionId)
+        : _completions(std::move(completions)), _connection(connection),
+          _transactionId(transactionId) {}
+
+    void complete(std::optional<ModbusResponse> response,
+                  std::optional<ModbusException> error);
+
+    friend class AsyncServer;
+
+  public:
+    Responder(const Responder &) = delete;
+    Responder &operator=(const Responder &) = delete;
+    Responder(Responder &&moved) noexcept = default;
+    Responder &operator=(Responder &&other) noexcept;
+    ~Responder();
+
+    /**
+     * @brief Sends response. On the loop thread (ex. from within handler) it
+     * is queued on the connection right away, other threads push it to the
+     * completion queue and block while the queue is full.
+     */
+    void respond(const ModbusResponse &response);
+    //! Sends exception, see respond(const ModbusResponse &)
+    void respond(const ModbusException &exception);
+    //! Releases request without sending anything
+    void ignore();
+
+    //! True once respond() or ignore() was called
+    [[nodiscard]] bool completed() const noexcept { return !_completions; }
+
+    [[nodiscard]] uint16_t transactionId() const noexcept {
+      return _transactionId;
+    }
+  };
+
+  /**
+   * Called on the loop thread for every request, must not block. Exceptions
+   * thrown by handler are sent back (SlaveDeviceFailure if they are not
+   * ModbusException), unless the responder has already completed or was
+   * moved out of the handler.
+   */
+  using Handler =
+      std::function<void(const ModbusRequest &request, Responder responder)>;
+
+private:
+  Server _server;
+  Handler _handler;
+  std::shared_ptr<Completions> _completions;
+  std::unordered_map<uint64_t, Session> _sessions;
+  uint64_t _nextConnection = 0;
+  std::atomic<bool> _stop = false;
+
+  //! Request being passed to handler, tells how its responder completed
+  struct Dispatching {
+    uint64_t connection;
+    uint16_t transactionId;
+    bool answered = false;
+    bool ignored = false;
+  };
+  std::optional<Dispatching> _dispatching;
+
+  void accept();
+  // Returns false when connection should be closed
+  bool read(uint64_t id, Session &session);
+  //! Passes received requests to handler until the session is throttled
+  bool dispatch(uint64_t id, Session &session);
+  bool write(Session &session);
+  void complete();
+  //! Queues completion on its connection, must be called on the loop thread
+  void respond(const Completion &completion);
+
+public:
+  /**
+   * @brief Opens listening socket.
+   * @param completionCapacity - Number of completions that may wait for the
+   * loop thread.
+   */
+  AsyncServer(int port, Handler handler,
+              std::size_t completionCapacity = DefaultCompletionCapacity);
+  ~AsyncServer();
+
+  AsyncServer(const AsyncServer &) = delete;
+  AsyncServer &operator=(const AsyncServer &) = delete;
+
+  //! Serves connections until stop() is called
+  void run();
+
+  //! Makes run() return, may be called from any thread
+  void stop() noexcept;
+
+  [[nodiscard]] std::size_t connections() const noexcept {
+    return _sessions.size();
+  }
+};
+}} // namespace MB::TCP
@@ -4,9 +4,13 @@
 
 #pragma once
 
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "../flightRecorder.hpp"
 #include "../modbusException.hpp"
 #include "../modbusRequest.hpp"
 #include "../modbusResponse.hpp"
@@ -22,8 +26,25 @@ private:
   int _sockfd = -1;
   uint16_t _messageID = 0;
   int _timeout = Connection::DefaultTCPTimeout;
+  std::shared_ptr<FlightRecorder> _recorder;
+
+  // Received data that has not been consumed yet, it may hold many frames
+  std::vector<uint8_t> _input;
+  std::size_t _inputBegin = 0;
+  std::size_t _inputEnd = 0;
+  // Frames waiting for flush()
+  std::vector<uint8_t> _output;
 
   void closeSockfd(void);
+  // Waits for data and reads it into buffer, returns number of bytes read
+  std::size_t receive(uint8_t *buffer, std::size_t capacity, int timeout,
+                      utils::MBErrorCode timeoutError);
+  // Returns next complete MBAP frame, valid until next receive
+  std::span<const uint8_t> awaitFrame(int timeout,
+                                      utils::MBErrorCode timeoutError);
+  void queue(std::span<const uint8_t> frame);
+  // Queues response, flushes unless another request is already buffered
+  void queueResponse(std::span<const uint8_t> frame);
 
 public:
   explicit Connection() noexcept : _sockfd(-1), _messageID(0){};
@@ -41,14 +62,53 @@ public:
   std::vector<uint8_t> sendRequest(const MB::ModbusRequest &req);
   std::vector<uint8_t> sendResponse(const MB::ModbusResponse &res);
   std::vector<uint8_t> sendException(const MB::ModbusException &ex);
-
-  [[nodiscard]] MB::ModbusRequest awaitRequest();
-  [[nodiscard]] MB::ModbusResponse awaitResponse();
+  //! sendRequest() encoding into memory from the given resource
+  std::pmr::vector<uint8_t> sendRequest(const MB::ModbusRequest &req,
+                                        std::pmr::memory_resource *resource);
+  //! sendResponse() encoding into memory from the given resource
+  std::pmr::vector<uint8_t> sendResponse(const MB::ModbusResponse &res,
+                                         std::pmr::memory_resource *resource);
+
+  //! Receive buffer and values that do not fit inline come from resource
+  [[nodiscard]] MB::ModbusRequest
+  awaitRequest(std::pmr::memory_resource *resource =
+                   std::pmr::get_default_resource());
+  //! Receive buffer and values that do not fit inline come from resource
+  [[nodiscard]] MB::ModbusResponse
+  awaitResponse(std::pmr::memory_resource *resource =
+                    std::pmr::get_default_resource());
 
   [[nodiscard]] std::vector<uint8_t> awaitRawMessage();
+  //! awaitRawMessage() allocating from the given resource
+  [[nodiscard]] std::pmr::vector<uint8_t>
+  awaitRawMessage(std::pmr::memory_resource *resource);
+
+  /**
+   * Checks if a complete request has already been received. Responses sent
+   * while it is true are held back and written together with the response to
+   * the last buffered request, so pipelined requests take one write.
+   */
+  [[nodiscard]] bool hasBufferedRequest() const noexcept;
+
+  //! Writes held back responses, awaitRequest() does it before blocking
+  void flush();
 
   [[nodiscard]] uint16_t getMessageId() const { return _messageID; }
 
   void setMessageId(uint16_t messageId) { _messageID = messageId; }
+
+  //! Milliseconds awaitResponse() waits for a frame
+  [[nodiscard]] int getTimeout() const { return _timeout; }
+
+  void setTimeout(int timeout) { _timeout = timeout; }
+
+  //! Records sent and received frames, nullptr disables recording
+  void setFlightRecorder(std::shared_ptr<FlightRecorder> recorder) {
+    _recorder = std::move(recorder);
+  }
+
+  [[nodiscard]] const std::shared_ptr<FlightRecorder> &flightRecorder() const {
+    return _recorder;
+  }
 };
 }} // namespace MB::TCP
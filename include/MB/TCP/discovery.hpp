@@ -0,0 +1,78 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../modbusUtils.hpp"
+
+namespace MB {
+namespace TCP {
+
+//! Configuration of Discovery
+struct DiscoveryOptions {
+  int port = 502;
+  //! Unit ids probed on every host that accepts connection
+  std::vector<uint8_t> unitIds = {1};
+  //! Maximal number of connections open at once
+  std::size_t maxConnections = 256;
+  //! Maximal number of units probed at once on a single connection
+  std::size_t pipelineDepth = 8;
+  std::chrono::milliseconds connectTimeout{300};
+  std::chrono::milliseconds requestTimeout{500};
+  //! Register read by probes
+  uint16_t probeAddress = 0;
+  utils::MBFunctionCode probeFunction = utils::ReadAnalogOutputHoldingRegisters;
+  //! Find largest number of registers that device returns in one read
+  bool findMaxRegisters = true;
+};
+
+//! Unit that answered the probe
+struct DiscoveredDevice {
+  std::string address;
+  uint8_t unitId;
+  //! Round trip time of the first probe
+  std::chrono::microseconds latency;
+  //! Largest accepted read count, 0 if not checked or first probe failed
+  uint16_t maxRegisters;
+  //! Exception sent to the first probe, device is present but rejects probe
+  std::optional<utils::MBErrorCode> error;
+};
+
+/**
+ * @brief Finds Modbus devices in a range of hosts and unit ids.
+ *
+ * All hosts are connected to concurrently with non blocking sockets (up to
+ * maxConnections at once). On every connection probe reads are pipelined
+ * for pipelineDepth unit ids at a time. Responsive units get their
+ * maximal register count bisected. Units that do not answer in time or are
+ * reported as unreachable by a gateway are skipped.
+ */
+class Discovery {
+private:
+  DiscoveryOptions _options;
+
+public:
+  explicit Discovery(DiscoveryOptions options = {});
+
+  /**
+   * @brief Probes all given IPv4 hosts.
+   * @return Responsive devices, ordered by host and unit id.
+   * @throws std::runtime_error - When host is not a valid IPv4 address.
+   */
+  std::vector<DiscoveredDevice> scan(const std::vector<std::string> &hosts);
+
+  /**
+   * @brief Lists hosts of IPv4 network, ex. "192.168.0.0/22". Network and
+   * broadcast addresses are skipped for prefixes shorter than 31.
+   * @throws std::runtime_error - When network is not valid.
+   */
+  static std::vector<std::string> hostsOf(const std::string &network);
+};
+}} // namespace MB::TCP
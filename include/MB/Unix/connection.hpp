@@ -0,0 +1,98 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "MB/modbusException.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+
+namespace MB::Unix {
+/**
+ * @brief Modbus over local (AF_UNIX) stream socket.
+ *
+ * Frames use MBAP header, like Modbus TCP, so bridging to TCP is a plain
+ * copy. File descriptors may be attached to any sent frame (SCM_RIGHTS),
+ * descriptors received with awaited frames are kept until takeFds().
+ */
+class Connection {
+public:
+  static const unsigned int DefaultUnixTimeout = 500;
+  //! Maximal number of descriptors attached to a single frame
+  static const std::size_t MaxFds = 16;
+
+private:
+  int _sockfd = -1;
+  uint16_t _messageID = 0;
+  int _timeout = Connection::DefaultUnixTimeout;
+  std::vector<int> _fds;
+
+  void closeSockfd();
+  void closeFds();
+  std::vector<uint8_t> send(const std::vector<uint8_t> &frame,
+                            std::span<const int> fds);
+  // Reads exactly size bytes, collecting attached descriptors
+  void receive(uint8_t *buffer, std::size_t size, int timeout,
+               utils::MBErrorCode timeoutError);
+  // Reads whole MBAP frame into buffer, returns its size
+  template <typename Buffer>
+  std::size_t receiveFrame(Buffer &buffer, int timeout,
+                           utils::MBErrorCode timeoutError);
+
+public:
+  explicit Connection() noexcept = default;
+  explicit Connection(int sockfd) noexcept;
+  Connection(const Connection &) = delete;
+  Connection(Connection &&moved) noexcept;
+  Connection &operator=(Connection &&other) noexcept;
+  ~Connection();
+
+  [[nodiscard]] int getSockfd() const { return _sockfd; }
+
+  static Connection with(const std::string &path);
+
+  //! Sends request, fds are passed along with it to the other process
+  std::vector<uint8_t> sendRequest(const MB::ModbusRequest &req,
+                                   std::span<const int> fds = {});
+  std::vector<uint8_t> sendResponse(const MB::ModbusResponse &res,
+                                    std::span<const int> fds = {});
+  std::vector<uint8_t> sendException(const MB::ModbusException &ex,
+                                     std::span<const int> fds = {});
+
+  //! Receive buffer and values that do not fit inline come from resource
+  [[nodiscard]] MB::ModbusRequest
+  awaitRequest(std::pmr::memory_resource *resource =
+                   std::pmr::get_default_resource());
+  //! Receive buffer and values that do not fit inline come from resource
+  [[nodiscard]] MB::ModbusResponse
+  awaitResponse(std::pmr::memory_resource *resource =
+                    std::pmr::get_default_resource());
+
+  //! Returns single frame with MBAP header
+  [[nodiscard]] std::vector<uint8_t> awaitRawMessage();
+  //! awaitRawMessage() allocating from the given resource
+  [[nodiscard]] std::pmr::vector<uint8_t>
+  awaitRawMessage(std::pmr::memory_resource *resource);
+
+  /**
+   * @brief Returns descriptors received so far, caller becomes their owner.
+   * Descriptors that are not taken are closed with the connection.
+   */
+  [[nodiscard]] std::vector<int> takeFds();
+
+  [[nodiscard]] uint16_t getMessageId() const { return _messageID; }
+
+  void setMessageId(uint16_t messageId) { _messageID = messageId; }
+
+  //! Milliseconds awaitResponse() waits for a frame
+  [[nodiscard]] int getTimeout() const { return _timeout; }
+
+  void setTimeout(int timeout) { _timeout = timeout; }
+};
+} // namespace MB::Unix
@@ -0,0 +1,40 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <string>
+
+#include "connection.hpp"
+
+namespace MB::Unix {
+/**
+ * @brief Listens on a filesystem socket path.
+ *
+ * Stale socket left at path is replaced, path is removed when server is
+ * destroyed.
+ */
+class Server {
+private:
+  int _serverfd = -1;
+  std::string _path;
+
+public:
+  explicit Server(const std::string &path);
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server(Server &&moved) noexcept
+      : _serverfd(moved._serverfd), _path(std::move(moved._path)) {
+    moved._serverfd = -1;
+    moved._path.clear();
+  }
+  Server &operator=(Server &&moved) noexcept;
+
+  [[nodiscard]] int nativeHandle() const { return _serverfd; }
+  [[nodiscard]] const std::string &path() const { return _path; }
+
+  Connection awaitConnection();
+};
+} // namespace MB::Unix
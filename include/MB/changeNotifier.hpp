@@ -0,0 +1,164 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "modbusUtils.hpp"
+#include "mpscQueue.hpp"
+
+namespace MB {
+
+//! Addresses that subscription is interested in
+struct ChangeRange {
+  utils::MBFunctionRegisters table;
+  uint16_t first = 0;
+  uint16_t last = 0xFFFF;
+  //! Only writes to this unit, any unit if not set
+  std::optional<uint8_t> unit = std::nullopt;
+};
+
+//! Values written by a master
+struct Change {
+  //! Unit written to, for coalesced change unit of the range or 0
+  uint8_t unit;
+  utils::MBFunctionRegisters table;
+  //! Written addresses [first, last] within the subscribed range
+  uint16_t first;
+  uint16_t last;
+  //! Set when change merges writes that did not fit in the queue
+  bool coalesced = false;
+};
+
+/**
+ * @brief Delivers notifications about written ranges of register banks to
+ * application threads.
+ *
+ * publish() is called by the thread that serves requests (see
+ * RegisterBank::setChangeNotifier()), it only pushes to lock-free queues of
+ * matching subscriptions and never waits for consumers. When consumer lags
+ * and its queue is full, further changes are merged into a single coalesced
+ * change that covers all of them, so no write is missed and memory stays
+ * bounded. Consumers may sleep until a change arrives, publish() takes a
+ * lock only to wake a consumer that announced it is sleeping.
+ */
+class ChangeNotifier {
+public:
+  static constexpr std::size_t DefaultCapacity = 256;
+
+  using Callback = std::function<void(const Change &)>;
+
+private:
+  //! Wakes a sleeping consumer, costs the producer a fence when nobody sleeps
+  class Signal {
+  private:
+    std::atomic<bool> _waiting = false;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _signalled = false;
+
+  public:
+    /**
+     * Announces that consumer is going to sleep. Consumer has to check for
+     * work once more afterwards, then call wait() or cancel().
+     */
+    void prepare() noexcept;
+    void cancel() noexcept;
+    //! Sleeps until notified or deadline
+    void wait(std::chrono::steady_clock::time_point deadline);
+    //! Sleeps until notified
+    void wait();
+    //! Wakes consumer if it announced it is sleeping
+    void notify() noexcept;
+    //! Wakes consumer even if it is not sleeping yet
+    void wake() noexcept;
+  };
+
+public:
+  //! Queue of changes of a single consumer
+  class Subscription {
+  private:
+    //! Coalesced range packed as first << 16 | last, Empty when none
+    static constexpr uint64_t Empty = ~uint64_t(0);
+
+    ChangeRange _range;
+    utils::MPSCQueue<Change> _queue;
+    std::atomic<uint64_t> _coalesced = Empty;
+    Callback _callback;
+    Signal _signal;
+
+    void push(const Change &change) noexcept;
+
+    friend class ChangeNotifier;
+
+  public:
+    Subscription(ChangeRange range, std::size_t capacity, Callback callback)
+        : _range(range), _queue(capacity), _callback(std::move(callback)) {}
+
+    [[nodiscard]] const ChangeRange &range() const noexcept { return _range; }
+
+    /**
+     * @brief Returns next change or std::nullopt, never blocks. Only one
+     * thread may call it, and not for callback subscriptions.
+     */
+    std::optional<Change> next();
+
+    /**
+     * @brief Waits up to timeout for next change, std::nullopt if none came.
+     * Same restrictions as next().
+     */
+    std::optional<Change> next(std::chrono::milliseconds timeout);
+  };
+
+private:
+  using Subscriptions = std::vector<std::shared_ptr<Subscription>>;
+
+  std::size_t _capacity;
+  //! Replaced as a whole, so publish() never sees list being modified
+  std::atomic<std::shared_ptr<const Subscriptions>> _subscriptions;
+  std::mutex _mutex;
+
+  std::atomic<bool> _stop = false;
+  std::thread _dispatcher;
+  //! Raised by publish() for callback subscriptions
+  Signal _dispatcherSignal;
+
+  void add(const std::shared_ptr<Subscription> &subscription);
+  void dispatch();
+
+public:
+  //! @param capacity - Changes queued per subscription before coalescing
+  explicit ChangeNotifier(std::size_t capacity = DefaultCapacity);
+  ~ChangeNotifier();
+
+  ChangeNotifier(const ChangeNotifier &) = delete;
+  ChangeNotifier &operator=(const ChangeNotifier &) = delete;
+
+  //! Creates subscription that is read with Subscription::next()
+  std::shared_ptr<Subscription> subscribe(const ChangeRange &range);
+
+  /**
+   * @brief Creates subscription whose changes are passed to callback, on
+   * the notifier thread. Callback must not throw.
+   */
+  std::shared_ptr<Subscription> subscribe(const ChangeRange &range,
+                                          Callback callback);
+
+  void unsubscribe(const std::shared_ptr<Subscription> &subscription);
+
+  //! Notifies subscriptions overlapping with written range
+  void publish(uint8_t unit, utils::MBFunctionRegisters table,
+               uint16_t address, uint16_t count) noexcept;
+};
+} // namespace MB
@@ -0,0 +1,138 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "modbusException.hpp"
+#include "modbusResponse.hpp"
+
+namespace MB {
+/**
+ * @brief Work-stealing thread pool that decodes received frames.
+ *
+ * I/O threads only receive and frame data, then hand raw response frames
+ * (without MBAP header) to the pool. Frames of a single device are decoded
+ * and delivered strictly in submission order, frames of different devices
+ * are decoded in parallel. Idle workers steal work from busy ones.
+ */
+class DecodePool {
+public:
+  /**
+   * Called on a worker thread with decoded response. On success response
+   * points to decoded frame and error is empty, otherwise response is nullptr
+   * and error holds thrown exception (ModbusException for Modbus errors).
+   * This is the place for scaling, change detection etc. Exceptions thrown
+   * by the callback are ignored.
+   */
+  using Decoded = std::function<void(uint32_t device,
+                                     const ModbusResponse *response,
+                                     std::exception_ptr error)>;
+
+private:
+  struct Task {
+    uint32_t device;
+    std::vector<uint8_t> frame;
+    bool CRC;
+    Decoded callback;
+  };
+
+  //! Serializes tasks of a single device
+  struct Strand {
+    uint32_t device;
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    bool scheduled = false;
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Strand *> strands;
+  };
+
+  using StrandMap = std::unordered_map<uint32_t, std::unique_ptr<Strand>>;
+
+  //! Part of the device map, so submitting to different devices rarely
+  //! contends on a lock
+  struct alignas(64) StrandShard {
+    std::mutex mutex;
+    // Only devices with pending frames, idle strands are removed
+    StrandMap strands;
+    //! Removed map nodes with their strands, reused by the next devices
+    std::vector<StrandMap::node_type> free;
+  };
+
+  static const std::size_t StrandBatch = 16;
+  static const std::size_t StrandShards = 64;
+  //! Idle strands kept per shard for reuse
+  static const std::size_t FreeStrands = 64;
+
+  std::array<StrandShard, StrandShards> _shards;
+
+  std::vector<std::unique_ptr<Worker>> _workers;
+  std::vector<std::thread> _threads;
+  std::atomic<std::size_t> _nextWorker = 0;
+
+  //! Strands waiting in worker queues
+  std::atomic<std::size_t> _queued = 0;
+  //! Workers about to sleep, schedule() wakes them only if there are any
+  std::atomic<std::size_t> _sleepers = 0;
+  //! Bumped to wake sleeping workers
+  std::atomic<uint32_t> _wakeSequence = 0;
+  std::atomic<bool> _stopping = false;
+
+  // Waited on by drain(), notified only when it drops to 0
+  std::atomic<std::size_t> _outstanding = 0;
+
+  StrandShard &shard(uint32_t device) noexcept;
+  void schedule(Strand *strand);
+  Strand *take(std::size_t index);
+  void runStrand(Strand *strand);
+  // Removes strand if it has no tasks, returns false otherwise
+  bool release(Strand *strand);
+  void work(std::size_t index);
+
+public:
+  /**
+   * @brief Starts pool.
+   * @param threads - Number of worker threads, 0 means one per core.
+   */
+  explicit DecodePool(std::size_t threads = 0);
+  ~DecodePool();
+
+  DecodePool(const DecodePool &) = delete;
+  DecodePool &operator=(const DecodePool &) = delete;
+
+  /**
+   * @brief Queues raw response frame for decoding, safe to call from any
+   * thread.
+   * @param device - User chosen device key, callbacks for the same key are
+   * called in submission order and never concurrently.
+   * @param frame - Raw response, as accepted by ModbusResponse::fromRaw.
+   * @param callback - Called when frame is decoded.
+   * @param CRC - If true frame contains CRC that will be checked.
+   */
+  void submit(uint32_t device, std::vector<uint8_t> frame, Decoded callback,
+              bool CRC = false);
+
+  //! Blocks until every submitted frame is decoded and delivered
+  void drain();
+
+  [[nodiscard]] std::size_t threadsCount() const { return _threads.size(); }
+
+  //! Number of devices whose frames are queued or being decoded
+  [[nodiscard]] std::size_t strandsCount();
+};
+} // namespace MB
@@ -0,0 +1,150 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "registerBank.hpp"
+
+namespace MB {
+
+struct DurableOptions {
+  //! Sizes of the tables, see DenseRegisterBank
+  std::size_t outputCoils = DenseRegisterBank::MaxTableSize;
+  std::size_t inputContacts = DenseRegisterBank::MaxTableSize;
+  std::size_t holdingRegisters = DenseRegisterBank::MaxTableSize;
+  std::size_t inputRegisters = DenseRegisterBank::MaxTableSize;
+
+  //! Longest time a write waits for the group it belongs to be committed
+  std::chrono::milliseconds commitInterval{5};
+  //! Group is committed earlier when it reaches this many bytes of log
+  std::size_t commitBytes = 64 * 1024;
+  //! Log is compacted into the snapshot when it grows past this size
+  std::size_t compactBytes = 16 * 1024 * 1024;
+};
+
+/**
+ * @brief Dense register bank that survives restarts.
+ *
+ * Writes are applied in memory immediately and appended to a write-ahead
+ * log. Background thread commits the log in groups (one fsync for all
+ * writes from commitInterval or commitBytes), and compacts it into a
+ * snapshot file from time to time. On startup snapshot is mapped and log
+ * tail is replayed over it.
+ *
+ * Writes are durable once whenDurable() callback reports so, responses
+ * should be sent from it if client has to be sure that values persist:
+ * @code
+ * auto response = bank->handle(request);
+ * bank->whenDurable([=](bool durable) mutable {
+ *   if (durable)
+ *     responder.respond(response);
+ *   else
+ *     responder.respond(MB::ModbusException(MB::utils::SlaveDeviceFailure,
+ *                                           request.slaveID(),
+ *                                           request.functionCode()));
+ * });
+ * @endcode
+ *
+ * Unlike other banks, it may be used from many threads.
+ */
+class DurableRegisterBank : public RegisterBank {
+public:
+  //! Receives false if log could not be written
+  using DurableCallback = std::function<void(bool durable)>;
+
+private:
+  struct Waiting {
+    uint64_t sequence;
+    DurableCallback callback;
+  };
+
+  std::filesystem::path _directory;
+  DurableOptions _options;
+  DenseRegisterBank _bank;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _wake;
+  //! Signalled by the committer thread after every commit
+  std::condition_variable _committed;
+  //! Log records waiting for commit
+  std::vector<uint8_t> _pending;
+  std::chrono::steady_clock::time_point _pendingSince;
+  //! Number of writes appended and committed
+  uint64_t _appended = 0;
+  uint64_t _durable = 0;
+  uint64_t _compactions = 0;
+  std::vector<Waiting> _waiting;
+  bool _flushRequested = false;
+  bool _compactRequested = false;
+  bool _failed = false;
+  bool _stopping = false;
+
+  // Owned by the committer thread after construction
+  int _logFd = -1;
+  std::size_t _logSize = 0;
+  uint64_t _generation = 0;
+  std::vector<uint8_t> _batch;
+  std::vector<uint8_t> _image;
+
+  std::thread _committer;
+
+  void recover();
+  void replay(const std::filesystem::path &path);
+  //! Serializes tables, must be called with _mutex held
+  void captureImage();
+  void writeSnapshot();
+  void appendLog(std::span<const uint8_t> data, bool sync);
+  void compact();
+  void commitLoop();
+
+public:
+  /**
+   * @brief Opens bank stored in directory, creating it if needed.
+   * @throws std::runtime_error - When files can not be created or snapshot
+   * was created with different table sizes.
+   */
+  explicit DurableRegisterBank(std::filesystem::path directory,
+                               DurableOptions options = {});
+  //! Commits pending writes before returning
+  ~DurableRegisterBank() override;
+
+  DurableRegisterBank(const DurableRegisterBank &) = delete;
+  DurableRegisterBank &operator=(const DurableRegisterBank &) = delete;
+
+  void read(utils::MBFunctionRegisters table, uint16_t address,
+            std::span<ModbusCell> out) const override;
+  /**
+   * @copydoc RegisterBank::write
+   * @throws ModbusException - SlaveDeviceFailure once log could not be
+   * written, bank is read only then.
+   */
+  void write(utils::MBFunctionRegisters table, uint16_t address,
+             std::span<const ModbusCell> values) override;
+
+  /**
+   * @brief Calls callback, from the committer thread, once all writes made
+   * so far are durable. If they are already, callback is called immediately.
+   */
+  void whenDurable(DurableCallback callback);
+
+  /**
+   * @brief Commits pending writes without waiting for the group to fill.
+   * @throws std::runtime_error - When log could not be written.
+   */
+  void sync();
+
+  //! Writes snapshot and starts new log, blocks until done
+  void compactNow();
+};
+} // namespace MB
@@ -0,0 +1,99 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "modbusException.hpp"
+
+namespace MB {
+/**
+ * @brief Ring of the last frames sent and received by a connection.
+ *
+ * Recording never allocates or locks: each entry is copied into a fixed
+ * slot guarded by a sequence number, so dump() may run on any thread while
+ * the connection keeps recording. Entries overwritten during dump() are
+ * skipped. Frames longer than MaxFrameSize are truncated.
+ */
+class FlightRecorder {
+public:
+  //! Bytes kept from each frame, enough for MBAP header and the longest PDU
+  static constexpr std::size_t MaxFrameSize = 264;
+
+  enum Direction : uint8_t { Tx, Rx, Error };
+
+  struct Record {
+    std::chrono::system_clock::time_point time;
+    Direction direction;
+    //! Error that ended transaction, 0 if there was none
+    uint8_t errorCode;
+    //! Length of the frame before truncation
+    std::size_t length;
+    std::vector<uint8_t> frame;
+  };
+
+  //! Called when connection raises exception with non-standard error code
+  using DumpHandler = std::function<void(const FlightRecorder &recorder,
+                                         const ModbusException &error)>;
+
+private:
+  static constexpr std::size_t Words = MaxFrameSize / sizeof(uint64_t);
+
+  struct Slot {
+    //! 2 * position + 1 while written, 2 * position + 2 when complete
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<int64_t> time{0};
+    //! Direction, error code and length
+    std::atomic<uint32_t> meta{0};
+    std::array<std::atomic<uint64_t>, Words> data{};
+  };
+
+  std::unique_ptr<Slot[]> _slots;
+  std::size_t _mask;
+  std::atomic<uint64_t> _head{0};
+  DumpHandler _dumpHandler;
+
+public:
+  /**
+   * @brief Constructs recorder.
+   * @param capacity - Number of kept entries, rounded up to power of two.
+   */
+  explicit FlightRecorder(std::size_t capacity = 64);
+
+  FlightRecorder(const FlightRecorder &) = delete;
+  FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+  [[nodiscard]] std::size_t capacity() const noexcept { return _mask + 1; }
+
+  /**
+   * @brief Records frame, safe to call from many threads as long as fewer
+   * than capacity() of them record at the same time.
+   */
+  void record(Direction direction, std::span<const uint8_t> frame,
+              uint8_t errorCode = 0) noexcept;
+
+  /**
+   * @brief Records error and, if its code is not a standard Modbus one,
+   * calls dump handler. Default handler writes dump to std::clog.
+   */
+  void failure(const ModbusException &error);
+
+  void setDumpHandler(DumpHandler handler) { _dumpHandler = std::move(handler); }
+
+  //! Returns recorded entries, oldest first
+  [[nodiscard]] std::vector<Record> records() const;
+
+  //! Writes recorded entries, one per line, frames as hex
+  void dump(std::ostream &out) const;
+};
+} // namespace MB
@@ -0,0 +1,66 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "modbusUtils.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Headers of many response frames, stored as structure of arrays.
+ *
+ * Element i of every column describes frame i passed to
+ * decodeResponses(). Register values are not copied, they can be read
+ * straight from the frame starting at payloadOffsets[i].
+ */
+struct ResponseBatch {
+  //! Status of successfully decoded frame
+  static constexpr uint8_t Ok = 0;
+
+  std::vector<uint8_t> slaveIDs;
+  //! Function codes, without exception bit
+  std::vector<utils::MBFunctionCode> functionCodes;
+  //! Starting address, only known for write responses (0 for reads)
+  std::vector<uint16_t> addresses;
+  //! Number of registers/coils in the frame
+  std::vector<uint16_t> counts;
+  //! Offset of first value byte inside the frame, 0 if frame has no values
+  std::vector<uint16_t> payloadOffsets;
+  //! Ok or utils::MBErrorCode describing why frame is invalid
+  std::vector<uint8_t> statuses;
+
+  [[nodiscard]] std::size_t size() const { return statuses.size(); }
+
+  void resize(std::size_t size) {
+    slaveIDs.resize(size);
+    functionCodes.resize(size);
+    addresses.resize(size);
+    counts.resize(size);
+    payloadOffsets.resize(size);
+    statuses.resize(size);
+  }
+};
+
+/**
+ * @brief Decodes many raw response frames at once.
+ *
+ * Frames are validated column by column with branch free loops, so the
+ * compiler can vectorize them. Malformed frames do not throw, they get
+ * status set instead. Columns are resized, not reallocated, so reusing the
+ * same batch does not allocate.
+ * @param frames - Raw responses, as accepted by ModbusResponse::fromRaw.
+ * @param batch - Output, resized to frames.size().
+ * @param CRC - If true frames contain CRC that will be checked.
+ * @return Number of frames with Ok status.
+ */
+std::size_t decodeResponses(std::span<const std::span<const uint8_t>> frames,
+                            ResponseBatch &batch, bool CRC = false);
+} // namespace MB
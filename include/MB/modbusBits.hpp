@@ -0,0 +1,133 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// This header contains bulk conversions of coils between Modbus wire
+// format and other representations
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "modbusCell.hpp"
+
+namespace MB {
+namespace utils {
+/**
+ * @brief Unpacks coils from wire format (first coil in the least significant
+ * bit of the first byte) into one byte per coil.
+ * @param wire - At least (count + 7) / 8 bytes.
+ * @param count - Number of coils.
+ * @param out - Output, count bytes equal to 0 or 1.
+ */
+void unpackBits(const uint8_t *wire, std::size_t count, uint8_t *out) noexcept;
+
+/**
+ * @brief Packs coils stored as one byte per coil into wire format.
+ * @param bytes - Coils, any non zero byte is treated as true.
+ * @param count - Number of coils.
+ * @param wire - Output, (count + 7) / 8 bytes, unused bits are set to 0.
+ */
+void packBits(const uint8_t *bytes, std::size_t count, uint8_t *wire) noexcept;
+
+//! unpackBits() for bool arrays
+inline void unpackBits(const uint8_t *wire, std::size_t count,
+                       bool *out) noexcept {
+  static_assert(sizeof(bool) == 1);
+  unpackBits(wire, count, reinterpret_cast<uint8_t *>(out));
+}
+
+//! packBits() for bool arrays
+inline void packBits(const bool *bools, std::size_t count,
+                     uint8_t *wire) noexcept {
+  static_assert(sizeof(bool) == 1);
+  packBits(reinterpret_cast<const uint8_t *>(bools), count, wire);
+}
+
+//! Number of bytes needed to send count coils
+constexpr std::size_t bitsBytes(std::size_t count) { return (count + 7) / 8; }
+
+//! Unpacks coils from wire format straight into cells
+void unpackCoils(const uint8_t *wire, std::size_t count, ModbusCell *cells);
+
+/**
+ * @brief Packs coil cells into wire format.
+ * @throws bad_variant_access - When some cell is a register.
+ */
+void packCoils(const ModbusCell *cells, std::size_t count, uint8_t *wire);
+} // namespace utils
+
+/**
+ * @brief Packed array of coils.
+ *
+ * Bits are stored in the same order as on the wire, so conversion from and
+ * to Modbus frames is a plain copy.
+ */
+class BitArray {
+private:
+  std::vector<uint64_t> _words;
+  std::size_t _size = 0;
+
+  void clearTail() noexcept {
+    if (_size % 64 != 0)
+      _words.back() &= (uint64_t(1) << (_size % 64)) - 1;
+  }
+
+public:
+  //! Constructs array of size coils, all false
+  explicit BitArray(std::size_t size = 0)
+      : _words((size + 63) / 64, 0), _size(size) {}
+
+  //! Creates array from wire format bytes
+  static BitArray fromWire(std::span<const uint8_t> wire, std::size_t count);
+  //! Creates array from one byte per coil representation
+  static BitArray fromBytes(std::span<const uint8_t> bytes);
+
+  //! Writes utils::bitsBytes(size()) bytes of wire format
+  void toWire(uint8_t *wire) const noexcept;
+  //! Writes size() bytes equal to 0 or 1
+  void toBytes(uint8_t *bytes) const noexcept;
+
+  [[nodiscard]] std::size_t size() const noexcept { return _size; }
+
+  [[nodiscard]] bool test(std::size_t index) const noexcept {
+    return (_words[index / 64] >> (index % 64)) & 1;
+  }
+
+  void set(std::size_t index, bool value = true) noexcept {
+    auto mask = uint64_t(1) << (index % 64);
+    if (value)
+      _words[index / 64] |= mask;
+    else
+      _words[index / 64] &= ~mask;
+  }
+
+  //! Number of true coils
+  [[nodiscard]] std::size_t count() const noexcept;
+  //! Number of true coils in range [first, first + length)
+  [[nodiscard]] std::size_t count(std::size_t first,
+                                  std::size_t length) const noexcept;
+
+  //! Copy of range [first, first + length)
+  [[nodiscard]] BitArray range(std::size_t first, std::size_t length) const;
+
+  //! Coils that differ between arrays (xor), arrays must have equal size
+  [[nodiscard]] BitArray diff(const BitArray &other) const;
+
+  //! Calls function(index) for every true coil, in ascending order
+  template <typename F> void forEachSet(F &&function) const {
+    for (std::size_t w = 0; w < _words.size(); w++) {
+      for (auto word = _words[w]; word != 0; word &= word - 1)
+        function(w * 64 + static_cast<std::size_t>(std::countr_zero(word)));
+    }
+  }
+
+  [[nodiscard]] bool operator==(const BitArray &other) const noexcept {
+    return _size == other._size && _words == other._words;
+  }
+};
+} // namespace MB
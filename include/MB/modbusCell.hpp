@@ -9,6 +9,9 @@
 #include <variant>
 #include <string>
 
+#include "modbusUtils.hpp"
+#include "smallVector.hpp"
+
 /**
  * Namespace that contains whole project
  */
@@ -118,7 +121,21 @@ public:
    * @return String representation.
    */
   [[nodiscard]] std::string toString() const noexcept {
-    return isCoil() ? ((coil()) ? "true" : "false") : std::to_string(reg());
+    std::string result;
+    appendTo(result);
+    return result;
+  }
+
+  //! Appends string representation of the cell to out
+  void appendTo(std::string &out) const {
+    if (isCoil())
+      out += coil() ? "true" : "false";
+    else
+      utils::appendNumber(out, reg());
   }
 };
+
+//! Values of request or response, short frames are stored without heap
+//! allocation
+using ModbusCells = utils::SmallVector<ModbusCell, 16>;
 } // namespace MB
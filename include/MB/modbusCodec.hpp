@@ -0,0 +1,103 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// This header contains allocation and exception free frame codec, it is the
+// only part of the core built with MODBUS_FREESTANDING
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "modbusUtils.hpp"
+
+/**
+ * Codec working on fixed size buffers. It never allocates and never throws,
+ * errors are reported with Status.
+ */
+namespace MB::Codec {
+//! Ok or utils::MBErrorCode describing why frame is invalid
+using Status = uint8_t;
+//! Status of successfully decoded frame
+inline constexpr Status Ok = 0;
+
+//! Maximal size of RTU frame (slave id, PDU and CRC), enough for TCP PDU too
+inline constexpr std::size_t MaxFrameSize = 256;
+//! Maximal number of value bytes in a frame (125 registers or 2000 coils)
+inline constexpr std::size_t MaxPayloadSize = 250;
+
+//! Buffer that fits any frame
+using Buffer = std::array<uint8_t, MaxFrameSize>;
+
+/**
+ * @brief Decoded request or response.
+ *
+ * Values are kept in wire format: registers as big endian words, coils
+ * packed 8 per byte. Single coil writes are stored as a single packed coil.
+ */
+struct Frame {
+  uint8_t slaveId = 0;
+  utils::MBFunctionCode functionCode = utils::Undefined;
+  uint16_t address = 0;
+  //! Number of registers or coils
+  uint16_t count = 0;
+  std::array<uint8_t, MaxPayloadSize> payload{};
+
+  [[nodiscard]] uint16_t reg(std::size_t index) const noexcept {
+    return utils::bigEndianConv(&payload[index * 2]);
+  }
+
+  void setReg(std::size_t index, uint16_t value) noexcept {
+    payload[index * 2] = static_cast<uint8_t>(value >> 8);
+    payload[index * 2 + 1] = static_cast<uint8_t>(value);
+  }
+
+  [[nodiscard]] bool coil(std::size_t index) const noexcept {
+    return (payload[index / 8] >> (index % 8)) & 1;
+  }
+
+  void setCoil(std::size_t index, bool value) noexcept {
+    auto mask = static_cast<uint8_t>(1 << (index % 8));
+    if (value)
+      payload[index / 8] |= mask;
+    else
+      payload[index / 8] &= static_cast<uint8_t>(~mask);
+  }
+};
+
+/**
+ * @brief Decodes raw request.
+ * @param raw - Frame without MBAP header, with CRC on back if CRC is true.
+ * @return Ok, InvalidByteOrder, InvalidCRC, IllegalFunction or
+ * IllegalDataValue (values count out of Modbus limits).
+ */
+Status decodeRequest(std::span<const uint8_t> raw, Frame &out,
+                     bool CRC = false) noexcept;
+
+/**
+ * @brief Decodes raw response.
+ * @return Same as decodeRequest(), or error code of exception response. Then
+ * out contains only slave id and function code.
+ */
+Status decodeResponse(std::span<const uint8_t> raw, Frame &out,
+                      bool CRC = false) noexcept;
+
+/**
+ * @brief Encodes request.
+ * @return Number of bytes written, 0 if frame is invalid or out is too small.
+ */
+std::size_t encodeRequest(const Frame &frame, std::span<uint8_t> out,
+                          bool CRC = false) noexcept;
+
+//! Encodes response, see encodeRequest()
+std::size_t encodeResponse(const Frame &frame, std::span<uint8_t> out,
+                           bool CRC = false) noexcept;
+
+//! Encodes exception response, see encodeRequest()
+std::size_t encodeException(uint8_t slaveId, utils::MBFunctionCode functionCode,
+                            utils::MBErrorCode errorCode,
+                            std::span<uint8_t> out, bool CRC = false) noexcept;
+} // namespace MB::Codec
@@ -4,8 +4,10 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <cstring>
+#include <span>
 #include <stdexcept>
 #include <vector>
 
@@ -21,11 +23,23 @@ namespace MB {
  * around standard error codes and some custom codes.
  */
 class ModbusException : public std::exception {
+public:
+  //! Longest message returned by what() and toString()
+  static constexpr std::size_t MaxMessageSize = 128;
+
 private:
   uint8_t _slaveId;
   bool _validSlave;
   utils::MBErrorCode _errorCode;
   utils::MBFunctionCode _functionCode;
+  //! Null terminated message, formatted whenever the fields change
+  std::array<char, MaxMessageSize> _message;
+
+  void formatMessage() noexcept {
+    const auto size =
+        format(std::span<char>(_message.data(), _message.size() - 1));
+    _message[size] = '\0';
+  }
 
 public:
   /**
@@ -37,6 +51,11 @@ public:
    * in RS)
    * */
   explicit ModbusException(const std::vector<uint8_t> &inputData,
+                           bool CRC = false) noexcept
+      : ModbusException(std::span<const uint8_t>(inputData), CRC) {}
+
+  //! Constructs Exception from any contiguous buffer, ex. std::pmr::vector
+  explicit ModbusException(std::span<const uint8_t> inputData,
                            bool CRC = false) noexcept;
 
   //! Constructs Exception based on error code, function code and slaveId
@@ -44,20 +63,26 @@ public:
       utils::MBErrorCode errorCode, uint8_t slaveId = 0xFF,
       utils::MBFunctionCode functionCode = utils::Undefined) noexcept
       : _slaveId(slaveId), _validSlave(true), _errorCode(errorCode),
-        _functionCode(functionCode) {}
+        _functionCode(functionCode) {
+    formatMessage();
+  }
 
   /*
    * Check if there is Modbus error in raw modbus input
    * NOTE: this method doesn't detect invalid byte order, byte order is
    * checked at ModbusRequest/ModbusResponse
    * */
-  static bool exist(const std::vector<uint8_t> &inputData) noexcept {
+  static bool exist(std::span<const uint8_t> inputData) noexcept {
     if (inputData.size() < 2) // TODO Figure out better solution to such mistake
       return false;
 
     return inputData[1] & 0b10000000;
   }
 
+  static bool exist(const std::vector<uint8_t> &inputData) noexcept {
+    return exist(std::span<const uint8_t>(inputData));
+  }
+
   /*
    *  Returns attached SlaveID
    *  NOTE: it is worth to check if slaveId is specified with isSlaveValid()
@@ -71,6 +96,7 @@ public:
   void setSlaveID(uint8_t slaveId) noexcept {
     _validSlave = true;
     _slaveId = slaveId;
+    formatMessage();
   }
 
   //! Returns detected error code
@@ -79,20 +105,21 @@ public:
   }
 
   /**
-   * This function is less optimal, it is just to be compatible with
-   * std::excepetion You should preferably use toString()
+   * Returns message formatted into the exception itself, does not allocate.
+   * Returned string is valid for the lifetime of the object.
    */
   [[nodiscard]] const char *what() const noexcept override {
-    auto og = toString();
-    char *str = new char[og.size()];
-#ifdef _WIN32
-    strncpy_s(str, og.size(), og.c_str(), og.size());
-#else
-    stpcpy(str, og.c_str());
-#endif
-    return str;
+    return _message.data();
   }
 
+  /**
+   * @brief Writes string representation of object to buffer, does not
+   * allocate.
+   * @return Number of written characters, output is truncated to buffer size
+   * and not null terminated.
+   */
+  std::size_t format(std::span<char> buffer) const noexcept;
+
   //! Returns string representation of object
   [[nodiscard]] std::string toString() const noexcept;
   //! Converts object to modbus byte representation
@@ -104,6 +131,7 @@ public:
 
   void setFunctionCode(utils::MBFunctionCode functionCode) noexcept {
     _functionCode = functionCode;
+    formatMessage();
   }
 };
 } // namespace MB
@@ -0,0 +1,129 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <thread>
+
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "mpscQueue.hpp"
+
+namespace MB {
+/**
+ * @brief Asynchronous logger of frames and errors.
+ *
+ * Logging thread only copies a binary record into a lock-free queue, records
+ * are decoded, formatted and written to the sink by a background thread.
+ * When the queue is full, records are dropped and counted instead of
+ * blocking the caller.
+ */
+class Logger {
+public:
+  enum Level : uint8_t { Debug, Info, Warning, Error, Off };
+  enum Direction : uint8_t { Tx, Rx, None };
+
+  //! Bytes kept from each frame, enough for the longest PDU
+  static constexpr std::size_t MaxFrameSize = 264;
+  static constexpr std::size_t DefaultCapacity = 1024;
+
+  //! Receives formatted lines (without newline) on the background thread
+  using Sink = std::function<void(Level level, std::string_view line)>;
+
+private:
+  enum Kind : uint8_t { Request, Response, Exception, Text };
+
+  struct Record {
+    int64_t time;
+    Level level;
+    Kind kind;
+    Direction direction;
+    uint16_t size;
+    std::array<uint8_t, MaxFrameSize> data;
+  };
+
+  Sink _sink;
+  std::atomic<Level> _level;
+  std::atomic<uint64_t> _pushed{0};
+  std::atomic<uint64_t> _written{0};
+  std::atomic<uint64_t> _dropped{0};
+  std::atomic<bool> _stop{false};
+  //! Set while background thread is about to sleep, push() wakes it only then
+  std::atomic<bool> _sleeping{false};
+  //! Bumped to wake background thread
+  std::atomic<uint32_t> _wakeSequence{0};
+  //! Threads in flush(), _written is notified only when there are any
+  mutable std::atomic<uint32_t> _flushers{0};
+  utils::MPSCQueue<Record> _queue;
+  std::thread _thread;
+
+  void push(Level level, Kind kind, Direction direction,
+            std::span<const uint8_t> data) noexcept;
+  void run();
+  void write(const Record &record);
+
+public:
+  /**
+   * @brief Starts background thread.
+   * @param sink - Destination of lines, by default they are written to
+   * std::clog.
+   * @param level - Records below this level are ignored.
+   * @param capacity - Number of records that may wait for formatting.
+   */
+  explicit Logger(Sink sink = {}, Level level = Info,
+                  std::size_t capacity = DefaultCapacity);
+  //! Writes remaining records and stops background thread
+  ~Logger();
+
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  void setLevel(Level level) noexcept {
+    _level.store(level, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] Level level() const noexcept {
+    return _level.load(std::memory_order_relaxed);
+  }
+
+  //! Checks if records of given level are logged, use it to skip building them
+  [[nodiscard]] bool enabled(Level level) const noexcept {
+    return level != Off && level >= _level.load(std::memory_order_relaxed);
+  }
+
+  //! Logs raw request PDU, it is decoded only when formatted
+  void request(Level level, Direction direction,
+               std::span<const uint8_t> pdu) noexcept;
+  //! Logs request, encoding it without heap allocation
+  void request(Level level, Direction direction,
+               const ModbusRequest &request) noexcept;
+
+  //! Logs raw response PDU, it is decoded only when formatted
+  void response(Level level, Direction direction,
+                std::span<const uint8_t> pdu) noexcept;
+  //! Logs response, encoding it without heap allocation
+  void response(Level level, Direction direction,
+                const ModbusResponse &response) noexcept;
+
+  void exception(Level level, const ModbusException &exception) noexcept;
+
+  //! Logs text, truncated to MaxFrameSize
+  void message(Level level, std::string_view text) noexcept;
+
+  //! Waits until every record logged before the call is written
+  void flush() const;
+
+  //! Number of records dropped because the queue was full
+  [[nodiscard]] uint64_t dropped() const noexcept {
+    return _dropped.load(std::memory_order_relaxed);
+  }
+};
+} // namespace MB
@@ -0,0 +1,300 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// This header contains protocol state machines that do no I/O on their own,
+// so they can be driven by any event loop (epoll, libuv, asio, ...)
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "timerWheel.hpp"
+
+/**
+ * State machines of Modbus protocol. They consume received bytes, produce
+ * bytes to send, report timer deadlines and emit parsed frames. Caller owns
+ * the socket/serial port and the clock:
+ * @code
+ * client.send(request, Clock::now());
+ * write(fd, client.pendingOutput()) -> client.consumeOutput(written)
+ * read(fd, buffer) -> client.receive(buffer)
+ * deadline reached -> client.onTimer(Clock::now())
+ * while (auto event = client.nextEvent()) ...
+ * @endcode
+ */
+namespace MB::Protocol {
+using Clock = std::chrono::steady_clock;
+
+//! MBAP header: transaction id, protocol id (0), length of the rest, unit id
+constexpr std::size_t MBAPSize = 6;
+//! Largest MBAP length field, unit id and the longest PDU
+constexpr uint16_t MaxMBAPLength = 254;
+
+//! Result of a client transaction
+struct Completion {
+  uint16_t transactionId;
+  //! Parsed response, filled with address from request
+  std::optional<ModbusResponse> response;
+  //! Exception sent by the device, Timeout, ProtocolError or parsing error
+  std::optional<ModbusException> error;
+};
+
+//! Request received by the server
+struct Incoming {
+  uint16_t transactionId;
+  std::optional<ModbusRequest> request;
+  //! Set if request could not be parsed, can be sent back with respond()
+  std::optional<ModbusException> error;
+};
+
+namespace details {
+//! Bytes produced by state machine, waiting to be written by the caller
+class OutputBuffer {
+private:
+  std::vector<uint8_t> _data;
+  std::size_t _offset = 0;
+
+public:
+  [[nodiscard]] std::span<const uint8_t> pending() const noexcept {
+    return {_data.data() + _offset, _data.size() - _offset};
+  }
+
+  void consume(std::size_t count) noexcept {
+    _offset += std::min(count, _data.size() - _offset);
+    if (_offset == _data.size()) {
+      _data.clear();
+      _offset = 0;
+    }
+  }
+
+  std::vector<uint8_t> &data() noexcept { return _data; }
+};
+} // namespace details
+
+/**
+ * @brief Modbus TCP client, many transactions may be in flight at once.
+ *
+ * Requests are framed with MBAP header, responses are matched with requests
+ * by transaction id, so they can arrive in any order. Responses to unknown
+ * (ex. already timed out) transactions are dropped.
+ */
+class TCPClient {
+public:
+  static constexpr std::chrono::milliseconds DefaultTimeout{500};
+
+private:
+  struct Transaction {
+    ModbusRequest request;
+    utils::TimerWheel<uint16_t>::Id timer;
+  };
+
+  std::unordered_map<uint16_t, Transaction> _transactions;
+  utils::TimerWheel<uint16_t> _timers;
+  uint16_t _nextId = 0;
+
+  std::vector<uint8_t> _input;
+  details::OutputBuffer _output;
+  std::deque<Completion> _events;
+
+  void handleFrame(uint16_t transactionId, std::span<const uint8_t> frame);
+  void failAll(utils::MBErrorCode errorCode);
+
+public:
+  /**
+   * @brief Queues request for sending.
+   * @param now - Current time, used to compute deadline.
+   * @param timeout - Time after which transaction fails with Timeout.
+   * @return Transaction id that will be reported in Completion.
+   * @throws std::runtime_error - When all transaction ids are in use.
+   */
+  uint16_t send(const ModbusRequest &request, Clock::time_point now,
+                Clock::duration timeout = DefaultTimeout);
+
+  /**
+   * @brief Feeds bytes read from the socket, may contain partial or many
+   * frames. Frames that do not follow MBAP fail all transactions with
+   * ProtocolError, connection should be reopened then.
+   */
+  void receive(std::span<const uint8_t> data);
+
+  //! Bytes that should be written to the socket
+  [[nodiscard]] std::span<const uint8_t> pendingOutput() const noexcept {
+    return _output.pending();
+  }
+  //! Marks count bytes of pendingOutput() as written
+  void consumeOutput(std::size_t count) noexcept { _output.consume(count); }
+
+  /**
+   * @brief Time at which onTimer() should be called next. It may be earlier
+   * than the nearest deadline (see utils::TimerWheel), but never later.
+   */
+  [[nodiscard]] std::optional<Clock::time_point> nextDeadline() const;
+  //! Fails transactions with deadline before or at now with Timeout
+  void onTimer(Clock::time_point now);
+
+  //! Returns next completed transaction
+  std::optional<Completion> nextEvent();
+
+  [[nodiscard]] std::size_t inFlight() const noexcept {
+    return _transactions.size();
+  }
+};
+
+/**
+ * @brief Modbus TCP server side of a single connection.
+ *
+ * Requests may be answered in any order, each response is sent with
+ * transaction id of its request.
+ */
+class TCPServer {
+private:
+  std::vector<uint8_t> _input;
+  details::OutputBuffer _output;
+  std::deque<Incoming> _events;
+
+  void write(uint16_t transactionId, const std::vector<uint8_t> &frame);
+
+public:
+  /**
+   * @brief Feeds bytes read from the socket, may contain partial or many
+   * frames. If stream does not follow MBAP, buffered data is dropped and
+   * Incoming with ProtocolError is emitted, connection should be closed then.
+   */
+  void receive(std::span<const uint8_t> data);
+
+  //! Returns next received request
+  std::optional<Incoming> nextEvent();
+
+  //! Queues response for request with given transaction id
+  void respond(uint16_t transactionId, const ModbusResponse &response);
+  //! Queues exception for request with given transaction id
+  void respond(uint16_t transactionId, const ModbusException &exception);
+
+  //! Bytes that should be written to the socket
+  [[nodiscard]] std::span<const uint8_t> pendingOutput() const noexcept {
+    return _output.pending();
+  }
+  //! Marks count bytes of pendingOutput() as written
+  void consumeOutput(std::size_t count) noexcept { _output.consume(count); }
+};
+
+/**
+ * @brief Modbus RTU client.
+ *
+ * Serial line allows single transaction at a time, so requests are queued
+ * and the next one is written only after previous is completed. Bytes
+ * received while no transaction is active are dropped. Broadcast requests
+ * (slave id 0) complete after the timeout with neither response nor error.
+ */
+class RTUClient {
+public:
+  static constexpr std::chrono::milliseconds DefaultTimeout{100};
+
+private:
+  struct Transaction {
+    uint16_t id;
+    ModbusRequest request;
+    Clock::duration timeout;
+  };
+
+  std::deque<Transaction> _queue;
+  bool _active = false;
+  Clock::time_point _deadline;
+  uint16_t _nextId = 0;
+
+  std::vector<uint8_t> _input;
+  details::OutputBuffer _output;
+  std::deque<Completion> _events;
+
+  void startNext(Clock::time_point now);
+  void complete(Completion completion, Clock::time_point now);
+
+public:
+  /**
+   * @brief Queues request for sending.
+   * @param timeout - Time to wait for response, counted from the moment
+   * request is written to pendingOutput().
+   * @return Id that will be reported in Completion.
+   */
+  uint16_t send(const ModbusRequest &request, Clock::time_point now,
+                Clock::duration timeout = DefaultTimeout);
+
+  //! Feeds bytes read from the serial port
+  void receive(std::span<const uint8_t> data, Clock::time_point now);
+
+  //! Bytes that should be written to the serial port
+  [[nodiscard]] std::span<const uint8_t> pendingOutput() const noexcept {
+    return _output.pending();
+  }
+  //! Marks count bytes of pendingOutput() as written
+  void consumeOutput(std::size_t count) noexcept { _output.consume(count); }
+
+  //! Deadline of active transaction
+  [[nodiscard]] std::optional<Clock::time_point> nextDeadline() const;
+  //! Completes active transaction with Timeout if deadline has passed
+  void onTimer(Clock::time_point now);
+
+  //! Returns next completed transaction
+  std::optional<Completion> nextEvent();
+
+  //! Number of queued and active transactions
+  [[nodiscard]] std::size_t inFlight() const noexcept { return _queue.size(); }
+};
+
+/**
+ * @brief Modbus RTU server (slave) side of a serial line.
+ *
+ * Requests are framed by length implied by function code and checked with
+ * CRC. Frames with invalid CRC are dropped together with the rest of the
+ * buffered input, as RTU slaves must not answer them. Unknown function codes
+ * can not be framed, so they are reported with IllegalFunction and buffered
+ * input is dropped. Serial line has no transaction ids, transactionId of
+ * Incoming is always 0 and responses are written in the order of respond()
+ * calls. Requests addressed to other slaves are reported too, filtering them
+ * is up to the caller.
+ */
+class RTUServer {
+private:
+  std::vector<uint8_t> _input;
+  details::OutputBuffer _output;
+  std::deque<Incoming> _events;
+
+  void write(std::vector<uint8_t> frame);
+
+public:
+  //! Feeds bytes read from the serial port, may contain partial or many frames
+  void receive(std::span<const uint8_t> data);
+
+  /**
+   * @brief Drops partially received frame. Should be called after silence
+   * on the line (3.5 characters), which ends every RTU frame.
+   */
+  void reset() noexcept { _input.clear(); }
+
+  //! Returns next received request
+  std::optional<Incoming> nextEvent();
+
+  //! Queues response, CRC is appended
+  void respond(const ModbusResponse &response);
+  //! Queues exception, CRC is appended
+  void respond(const ModbusException &exception);
+
+  //! Bytes that should be written to the serial port
+  [[nodiscard]] std::span<const uint8_t> pendingOutput() const noexcept {
+    return _output.pending();
+  }
+  //! Marks count bytes of pendingOutput() as written
+  void consumeOutput(std::size_t count) noexcept { _output.consume(count); }
+};
+} // namespace MB::Protocol
@@ -0,0 +1,302 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "modbusUtils.hpp"
+#include "modbusValues.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+namespace details {
+template <typename> struct MemberTraits;
+
+template <typename C, typename M> struct MemberTraits<M C::*> {
+  using Class = C;
+  using Type = M;
+};
+} // namespace details
+
+/**
+ * @brief Describes where a single struct member lives in the register map.
+ * @tparam Member - Pointer to the member.
+ * @tparam Raw - Type in which value is stored in registers.
+ */
+template <auto Member, utils::RegisterValue Raw> struct RegisterField {
+  using Class = typename details::MemberTraits<decltype(Member)>::Class;
+  using Type = typename details::MemberTraits<decltype(Member)>::Type;
+
+  static constexpr uint16_t width = utils::registersCount<Raw>;
+
+  //! Offset from the start of the map, in registers
+  uint16_t offset;
+  utils::WordOrder order;
+  //! Member value = raw value * scale
+  double scale;
+
+  //! Decodes field from width registers
+  void decode(const uint16_t *words, Class &out) const {
+    auto raw = utils::decodeValue<Raw>(words, order);
+    if (scale == 1.0)
+      out.*Member = static_cast<Type>(raw);
+    else
+      out.*Member = static_cast<Type>(static_cast<double>(raw) * scale);
+  }
+
+  //! Encodes field into registers, registers[0] is the start of the map
+  void encode(const Class &in, uint16_t *registers) const {
+    Raw raw;
+    if (scale == 1.0)
+      raw = static_cast<Raw>(in.*Member);
+    else if constexpr (std::is_floating_point_v<Raw>)
+      raw = static_cast<Raw>(static_cast<double>(in.*Member) / scale);
+    else
+      raw = static_cast<Raw>(std::llround(static_cast<double>(in.*Member) / scale));
+    utils::encodeValue<Raw>(raw, registers + offset, order);
+  }
+};
+
+/**
+ * @brief Creates field descriptor.
+ * @tparam Member - Pointer to the member, ex. &Meter::voltage.
+ * @tparam Raw - Type stored in registers, defaults to type of the member.
+ * @param offset - Offset from the start of the map, in registers.
+ * @param order - Word order of multi register values.
+ * @param scale - Member value = raw value * scale.
+ */
+template <auto Member,
+          utils::RegisterValue Raw =
+              typename details::MemberTraits<decltype(Member)>::Type>
+constexpr RegisterField<Member, Raw> field(uint16_t offset,
+                                           utils::WordOrder order = utils::ABCD,
+                                           double scale = 1.0) {
+  return RegisterField<Member, Raw>{offset, order, scale};
+}
+
+/**
+ * @brief Register map of a device, decoded directly into struct T.
+ *
+ * Map is meant to be declared as constexpr, then all of the field offsets,
+ * orders and scales are constants and decode()/encode() are unrolled
+ * over the fields with no lookups at runtime. Example:
+ * @code
+ * struct Meter { float voltage; double energy; };
+ * constexpr auto meterMap = MB::registerMap<Meter>(
+ *     MB::utils::ReadAnalogOutputHoldingRegisters, 100,
+ *     MB::field<&Meter::voltage>(0, MB::utils::CDAB),
+ *     MB::field<&Meter::energy, uint32_t>(2, MB::utils::ABCD, 0.01));
+ * @endcode
+ */
+template <typename T, typename... Fields> class RegisterMap {
+  static_assert(sizeof...(Fields) > 0, "Register map needs at least one field");
+  static_assert((std::is_same_v<typename Fields::Class, T> && ...),
+                "All fields must be members of the mapped struct");
+
+public:
+  //! Maximal number of registers in a single read request
+  static constexpr uint16_t MaxReadRegisters = 125;
+  //! Maximal number of registers in a single write request
+  static constexpr uint16_t MaxWriteRegisters = 123;
+
+  static_assert(((Fields::width <= MaxWriteRegisters) && ...),
+                "Every field must fit in a single request");
+
+  //! Registers range [first, first + count)
+  struct Block {
+    uint16_t first;
+    uint16_t count;
+  };
+
+private:
+  utils::MBFunctionCode _functionCode;
+  uint16_t _address;
+  std::tuple<Fields...> _fields;
+
+  //! Fields ranges, sorted by offset
+  constexpr std::array<Block, sizeof...(Fields)> fieldRanges() const {
+    std::array<Block, sizeof...(Fields)> result{};
+    std::size_t i = 0;
+    std::apply(
+        [&](const auto &...fields) {
+          ((result[i++] = Block{fields.offset, fields.width}), ...);
+        },
+        _fields);
+    std::sort(result.begin(), result.end(),
+              [](Block a, Block b) { return a.first < b.first; });
+    return result;
+  }
+
+public:
+  /**
+   * @param functionCode - Function used to read the map, either
+   * ReadAnalogOutputHoldingRegisters or ReadAnalogInputRegisters.
+   * @param address - Address of the first register of the map.
+   */
+  constexpr RegisterMap(utils::MBFunctionCode functionCode, uint16_t address,
+                        Fields... fields)
+      : _functionCode(functionCode), _address(address), _fields(fields...) {
+    if (functionCode != utils::ReadAnalogOutputHoldingRegisters &&
+        functionCode != utils::ReadAnalogInputRegisters)
+      throw std::runtime_error("Register map needs register read function");
+  }
+
+  [[nodiscard]] constexpr uint16_t address() const { return _address; }
+
+  [[nodiscard]] constexpr utils::MBFunctionCode functionCode() const {
+    return _functionCode;
+  }
+
+  //! Number of registers from the start of the map to the end of last field
+  [[nodiscard]] constexpr uint16_t span() const {
+    uint16_t result = 0;
+    for (auto range : fieldRanges())
+      result = std::max<uint16_t>(result, range.first + range.count);
+    return result;
+  }
+
+  //! Number of read requests needed to cover the map
+  [[nodiscard]] constexpr std::size_t readBlocksCount() const {
+    std::size_t count = 0;
+    while (readBlock(count).count != 0)
+      count++;
+    return count;
+  }
+
+  /**
+   * @brief N-th read block, Block{0, 0} past the last one.
+   * Every block starts at a field and covers following fields that fit in
+   * a single request, so registers far from any field are never read and
+   * multi register values are never split between blocks.
+   */
+  [[nodiscard]] constexpr Block readBlock(std::size_t n) const {
+    const auto ranges = fieldRanges();
+    std::size_t i = 0;
+    for (std::size_t block = 0; i < ranges.size(); block++) {
+      const uint16_t first = ranges[i].first;
+      uint16_t end = first + ranges[i].count;
+      for (i++; i < ranges.size() &&
+                ranges[i].first + ranges[i].count - first <= MaxReadRegisters;
+           i++)
+        end = std::max<uint16_t>(end, ranges[i].first + ranges[i].count);
+
+      if (block == n)
+        return Block{static_cast<uint16_t>(_address + first),
+                     static_cast<uint16_t>(end - first)};
+    }
+    return Block{0, 0};
+  }
+
+  //! Creates read requests covering whole map
+  [[nodiscard]] std::vector<ModbusRequest> readRequests(uint8_t slaveId) const {
+    std::vector<ModbusRequest> result;
+    for (std::size_t i = 0; i < readBlocksCount(); i++) {
+      auto block = readBlock(i);
+      result.emplace_back(slaveId, _functionCode, block.first, block.count);
+    }
+    return result;
+  }
+
+  /**
+   * @brief Decodes fields that are fully contained in registers.
+   * @param registers - Register values, registers[0] is at address first.
+   * @param out - Struct that will be filled.
+   * @param first - Address of registers[0].
+   */
+  void decode(std::span<const uint16_t> registers, T &out,
+              uint16_t first) const {
+    const int shift = static_cast<int>(first) - _address;
+    const int size = static_cast<int>(registers.size());
+    std::apply(
+        [&](const auto &...fields) {
+          ((fields.offset >= shift && fields.offset + fields.width <= shift + size
+                ? fields.decode(registers.data() + (fields.offset - shift), out)
+                : void()),
+           ...);
+        },
+        _fields);
+  }
+
+  //! Decodes registers that start at the address of the map
+  void decode(std::span<const uint16_t> registers, T &out) const {
+    decode(registers, out, _address);
+  }
+
+  /**
+   * @brief Decodes fields contained in the response.
+   * @note Read responses do not contain address, call ModbusResponse::from
+   * with the request first.
+   */
+  void decode(const ModbusResponse &response, T &out) const {
+    const auto &values = response.registerValues();
+    std::array<uint16_t, MaxReadRegisters> registers{};
+    auto count = std::min<std::size_t>(values.size(), registers.size());
+    for (std::size_t i = 0; i < count; i++)
+      registers[i] = values[i].reg();
+    decode(std::span<const uint16_t>(registers.data(), count), out,
+           response.registerAddress());
+  }
+
+  //! Encodes all fields into registers, registers[0] is start of the map
+  void encode(const T &in, std::span<uint16_t> registers) const {
+    if (registers.size() < span())
+      throw std::runtime_error("Registers buffer is smaller than the map");
+    std::apply([&](const auto &...fields) { (fields.encode(in, registers.data()), ...); },
+               _fields);
+  }
+
+  /**
+   * @brief Creates write requests for all fields.
+   * Registers between fields are never written, every contiguous run of
+   * fields gets its own request.
+   */
+  [[nodiscard]] std::vector<ModbusRequest> writeRequests(uint8_t slaveId,
+                                                         const T &in) const {
+    if (_functionCode != utils::ReadAnalogOutputHoldingRegisters)
+      throw std::runtime_error("Only holding registers can be written");
+
+    std::vector<uint16_t> registers(span());
+    encode(in, registers);
+
+    std::vector<ModbusRequest> result;
+    auto ranges = fieldRanges();
+    for (std::size_t i = 0; i < ranges.size();) {
+      uint16_t first = ranges[i].first;
+      uint16_t end = first + ranges[i].count;
+      for (i++; i < ranges.size() && ranges[i].first <= end &&
+                ranges[i].first + ranges[i].count - first <= MaxWriteRegisters;
+           i++)
+        end = std::max<uint16_t>(end, ranges[i].first + ranges[i].count);
+
+      ModbusCells values(registers.begin() + first, registers.begin() + end);
+      result.emplace_back(slaveId,
+                          utils::WriteMultipleAnalogOutputHoldingRegisters,
+                          static_cast<uint16_t>(_address + first),
+                          static_cast<uint16_t>(end - first), values);
+    }
+    return result;
+  }
+};
+
+//! Creates register map of struct T, see RegisterMap
+template <typename T, typename... Fields>
+constexpr RegisterMap<T, Fields...> registerMap(utils::MBFunctionCode functionCode,
+                                                uint16_t address,
+                                                Fields... fields) {
+  return RegisterMap<T, Fields...>(functionCode, address, fields...);
+}
+} // namespace MB
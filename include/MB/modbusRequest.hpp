@@ -5,6 +5,8 @@
 #pragma once
 
 #include <cstdint>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -28,7 +30,9 @@ private:
   uint16_t _address;
   uint16_t _registersNumber;
 
-  std::vector<ModbusCell> _values;
+  ModbusCells _values;
+
+  template <typename Buffer> void writeRaw(Buffer &result) const;
 
 public:
   /**
@@ -45,7 +49,17 @@ public:
    * @throws ModbusException
    **/
   explicit ModbusRequest(const std::vector<uint8_t> &inputData,
-                         bool CRC = false) noexcept(false);
+                         bool CRC = false) noexcept(false)
+      : ModbusRequest(std::span<const uint8_t>(inputData), CRC) {}
+
+  /**
+   * @brief Constructs Request from raw data, see constructor above.
+   * @param resource - Resource used if values do not fit inline.
+   * @throws ModbusException
+   */
+  explicit ModbusRequest(std::span<const uint8_t> inputData, bool CRC = false,
+                         std::pmr::memory_resource *resource =
+                             std::pmr::get_default_resource()) noexcept(false);
 
   /*
    * @description Constructs Request from raw data
@@ -57,6 +71,13 @@ public:
     return ModbusRequest(inputData);
   }
 
+  //! fromRaw() for any contiguous buffer, ex. std::pmr::vector
+  static ModbusRequest fromRaw(std::span<const uint8_t> inputData,
+                               std::pmr::memory_resource *resource =
+                                   std::pmr::get_default_resource()) {
+    return ModbusRequest(inputData, false, resource);
+  }
+
   /*
    * @description Constructs Request from raw data and checks it's CRC
    * @params inputData is a vector of bytes that will be interpreted
@@ -68,15 +89,25 @@ public:
     return ModbusRequest(inputData, true);
   }
 
+  //! fromRawCRC() for any contiguous buffer, ex. std::pmr::vector
+  static ModbusRequest fromRawCRC(std::span<const uint8_t> inputData,
+                                  std::pmr::memory_resource *resource =
+                                      std::pmr::get_default_resource()) {
+    return ModbusRequest(inputData, true, resource);
+  }
+
   /**
    * Simple constructor, that allows to create "dummy" ModbusRequest
    * object. May be useful in some cases.
+   * Values that do not fit inline are kept in resource.
    */
   explicit ModbusRequest(uint8_t slaveId = 0,
                          utils::MBFunctionCode functionCode =
                              static_cast<utils::MBFunctionCode>(0),
                          uint16_t address = 0, uint16_t registersNumber = 0,
-                         std::vector<ModbusCell> values = {}) noexcept;
+                         ModbusCells values = {},
+                         std::pmr::memory_resource *resource =
+                             std::pmr::get_default_resource()) noexcept;
 
   ModbusRequest(const ModbusRequest &) = default;
 
@@ -85,6 +116,9 @@ public:
   //! Returns raw bytes representation of object, ready for modbus
   //! communication
   [[nodiscard]] std::vector<uint8_t> toRaw() const noexcept;
+  //! toRaw() allocating from the given resource
+  [[nodiscard]] std::pmr::vector<uint8_t>
+  toRaw(std::pmr::memory_resource *resource) const;
 
   //! Returns function type based on Modbus function code
   [[nodiscard]] utils::MBFunctionType functionType() const noexcept {
@@ -101,7 +135,7 @@ public:
   }
   [[nodiscard]] uint16_t registerAddress() const { return _address; }
   [[nodiscard]] uint16_t numberOfRegisters() const { return _registersNumber; }
-  [[nodiscard]] const std::vector<ModbusCell> &registerValues() const {
+  [[nodiscard]] const ModbusCells &registerValues() const {
     return _values;
   }
 
@@ -114,6 +148,6 @@ public:
     _registersNumber = registersNumber;
     _values.resize(registersNumber);
   }
-  void setValues(const std::vector<ModbusCell> &values) { _values = values; }
+  void setValues(const ModbusCells &values) { _values = values; }
 };
 } // namespace MB
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <cstdint>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -30,7 +32,9 @@ private:
   uint16_t _address;
   uint16_t _registersNumber;
 
-  std::vector<ModbusCell> _values;
+  ModbusCells _values;
+
+  template <typename Buffer> void writeRaw(Buffer &result) const;
 
 public:
   /**
@@ -46,7 +50,17 @@ public:
    *exception if it is invalid
    * @throws ModbusException
    **/
-  explicit ModbusResponse(const std::vector<uint8_t> &inputData, bool CRC = false);
+  explicit ModbusResponse(const std::vector<uint8_t> &inputData, bool CRC = false)
+      : ModbusResponse(std::span<const uint8_t>(inputData), CRC) {}
+
+  /**
+   * @brief Constructs Response from raw data, see constructor above.
+   * @param resource - Resource used if values do not fit inline.
+   * @throws ModbusException
+   */
+  explicit ModbusResponse(std::span<const uint8_t> inputData, bool CRC = false,
+                          std::pmr::memory_resource *resource =
+                              std::pmr::get_default_resource());
 
   /*
    * @description Constructs Response from raw data
@@ -56,6 +70,13 @@ public:
   static ModbusResponse fromRaw(const std::vector<uint8_t> &inputData) {
     return ModbusResponse(inputData);
   }
+
+  //! fromRaw() for any contiguous buffer, ex. std::pmr::vector
+  static ModbusResponse fromRaw(std::span<const uint8_t> inputData,
+                                std::pmr::memory_resource *resource =
+                                    std::pmr::get_default_resource()) {
+    return ModbusResponse(inputData, false, resource);
+  }
   /*
    * @description Constructs Request from raw data and checks it's CRC
    * @params inputData is a vector of bytes that will be interpreted
@@ -67,21 +88,34 @@ public:
     return ModbusResponse(inputData, true);
   }
 
+  //! fromRawCRC() for any contiguous buffer, ex. std::pmr::vector
+  static ModbusResponse fromRawCRC(std::span<const uint8_t> inputData,
+                                   std::pmr::memory_resource *resource =
+                                       std::pmr::get_default_resource()) {
+    return ModbusResponse(inputData, true, resource);
+  }
+
   /**
    * Simple constructor, that allows to create "dummy" ModbusResponse
    * object. May be useful in some cases.
+   * Values that do not fit inline are kept in resource.
    */
   ModbusResponse(uint8_t slaveId = 0,
                  utils::MBFunctionCode functionCode =
                      static_cast<utils::MBFunctionCode>(0),
                  uint16_t address = 0, uint16_t registersNumber = 0,
-                 const std::vector<ModbusCell> &values = {});
+                 const ModbusCells &values = {},
+                 std::pmr::memory_resource *resource =
+                     std::pmr::get_default_resource());
 
   ModbusResponse(const ModbusResponse &) = default;
 
   //! Converts object to it's string representation
   [[nodiscard]] std::string toString() const;
   [[nodiscard]] std::vector<uint8_t> toRaw() const;
+  //! toRaw() allocating from the given resource
+  [[nodiscard]] std::pmr::vector<uint8_t>
+  toRaw(std::pmr::memory_resource *resource) const;
   //! Fills all data from associated request
   void from(const ModbusRequest &);
 
@@ -99,7 +133,7 @@ public:
   }
   [[nodiscard]] uint16_t registerAddress() const { return _address; }
   [[nodiscard]] uint16_t numberOfRegisters() const { return _registersNumber; }
-  [[nodiscard]] const std::vector<ModbusCell> &registerValues() const {
+  [[nodiscard]] const ModbusCells &registerValues() const {
     return _values;
   }
 
@@ -112,6 +146,6 @@ public:
     _registersNumber = registersNumber;
     _values.resize(registersNumber);
   }
-  void setValues(const std::vector<ModbusCell> &values) { _values = values; }
+  void setValues(const ModbusCells &values) { _values = values; }
 };
 } // namespace MB
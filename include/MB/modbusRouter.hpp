@@ -0,0 +1,123 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "registerBank.hpp"
+
+namespace MB {
+
+/**
+ * @brief Dispatches requests to virtual slaves by unit id, so one server can
+ * host many of them.
+ *
+ * Routes are kept in a table indexed directly by unit id. Example, with
+ * TCP::AsyncServer:
+ * @code
+ * MB::Router router;
+ * router.add(1, 100, std::make_shared<MB::DenseRegisterBank>(1000));
+ * MB::TCP::AsyncServer server(502, [&](const auto &request, auto responder) {
+ *   if (auto response = router.handle(request))
+ *     responder.respond(*response);
+ *   else
+ *     responder.ignore(); // Broadcast or unknown unit, nothing is sent
+ * });
+ * @endcode
+ */
+class Router {
+public:
+  //! Serves requests of routed unit, may throw ModbusException
+  using Handler = std::function<ModbusResponse(const ModbusRequest &)>;
+
+  //! What happens with requests sent to unit 0
+  enum BroadcastPolicy {
+    //! Broadcasts are dropped
+    IgnoreBroadcast,
+    //! Writes are executed by every route, without response
+    BroadcastToAll,
+    //! Unit 0 is routed like any other unit and responds
+    RouteBroadcast,
+  };
+
+  static constexpr uint8_t BroadcastUnit = 0;
+
+private:
+  struct Route {
+    //! Number of add() call, units added together share it
+    std::size_t id = 0;
+    std::shared_ptr<RegisterBank> bank;
+    Handler handler;
+
+    [[nodiscard]] bool empty() const { return !bank && !handler; }
+    [[nodiscard]] ModbusResponse handle(const ModbusRequest &request) const {
+      return bank ? bank->handle(request) : handler(request);
+    }
+  };
+
+  std::array<Route, 256> _routes;
+  std::size_t _nextRoute = 1;
+  std::optional<utils::MBErrorCode> _unknownUnit = utils::GatewayPathUnavailable;
+  BroadcastPolicy _broadcast = BroadcastToAll;
+
+  void add(uint8_t first, uint8_t last, Route route);
+  void broadcast(const ModbusRequest &request);
+
+public:
+  //! Routes unit to bank, replacing previous route
+  void add(uint8_t unit, std::shared_ptr<RegisterBank> bank) {
+    add(unit, unit, std::move(bank));
+  }
+  //! Routes units [first, last] to the same bank
+  void add(uint8_t first, uint8_t last, std::shared_ptr<RegisterBank> bank);
+
+  //! Routes unit to handler, replacing previous route
+  void add(uint8_t unit, Handler handler) {
+    add(unit, unit, std::move(handler));
+  }
+  //! Routes units [first, last] to the same handler
+  void add(uint8_t first, uint8_t last, Handler handler);
+
+  //! Removes routes of units [first, last]
+  void remove(uint8_t first, uint8_t last);
+  void remove(uint8_t unit) { remove(unit, unit); }
+
+  [[nodiscard]] bool routed(uint8_t unit) const {
+    return !_routes[unit].empty();
+  }
+
+  //! Bank routed to unit, nullptr if unit is not routed to a bank
+  [[nodiscard]] std::shared_ptr<RegisterBank> bank(uint8_t unit) const {
+    return _routes[unit].bank;
+  }
+
+  /**
+   * @brief Sets error sent for units without route, GatewayPathUnavailable
+   * by default. With std::nullopt such requests are not answered, like by
+   * missing device on serial line.
+   */
+  void setUnknownUnitError(std::optional<utils::MBErrorCode> errorCode) {
+    _unknownUnit = errorCode;
+  }
+
+  //! Sets broadcast handling, BroadcastToAll by default
+  void setBroadcastPolicy(BroadcastPolicy policy) { _broadcast = policy; }
+
+  /**
+   * @brief Serves request with route of its unit.
+   * @return Response, or std::nullopt when nothing should be sent back.
+   * @throws ModbusException - Error that should be sent back.
+   */
+  [[nodiscard]] std::optional<ModbusResponse>
+  handle(const ModbusRequest &request);
+};
+} // namespace MB
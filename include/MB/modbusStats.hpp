@@ -0,0 +1,174 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// This header contains per-stage latency statistics, they are collected only
+// when library is built with MODBUS_STATS
+
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(MODBUS_STATS) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+/**
+ * Latency of each stage of a transaction, aggregated into log2 histograms.
+ * Transports, parsing and encoding are measured by the library, handler can
+ * be measured by the application:
+ * @code
+ * auto request = connection.awaitRequest();
+ * {
+ *   MODBUS_STATS_SCOPE(MB::Stats::Handler);
+ *   response = handle(request);
+ * }
+ * @endcode
+ */
+namespace MB::Stats {
+enum Stage : uint8_t {
+  //! Read syscalls (recv/read), without waiting for data
+  Receive,
+  //! Adding MBAP header or CRC to sent frames
+  Framing,
+  //! Parsing of requests and responses
+  Parse,
+  //! Application handler, measured with MODBUS_STATS_SCOPE
+  Handler,
+  //! Encoding of requests, responses and exceptions
+  Encode,
+  //! Write syscalls (send/write)
+  Send,
+  StageCount
+};
+
+#ifdef MODBUS_STATS
+inline constexpr bool Enabled = true;
+#else
+inline constexpr bool Enabled = false;
+#endif
+
+//! Bucket i counts durations in [2^(i-1), 2^i) ticks, bucket 0 counts 0
+inline constexpr std::size_t Buckets = 64;
+
+namespace details {
+// Count is not kept separately, it is the sum of buckets
+struct alignas(64) Histogram {
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> max{0};
+  std::array<std::atomic<uint64_t>, Buckets> buckets{};
+};
+
+/**
+ * Histograms of a single thread. Only the owning thread writes them, so
+ * recording needs no locked instructions, snapshot() reads them through
+ * atomics. They are merged into shared totals when the thread exits.
+ */
+struct ThreadHistograms {
+  std::array<Histogram, StageCount> histograms;
+
+  ThreadHistograms();
+  ~ThreadHistograms();
+
+  ThreadHistograms(const ThreadHistograms &) = delete;
+  ThreadHistograms &operator=(const ThreadHistograms &) = delete;
+};
+
+inline thread_local ThreadHistograms threadHistograms;
+
+// Single writer increment, plain add instead of a locked one
+inline void add(std::atomic<uint64_t> &counter, uint64_t value) noexcept {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+} // namespace details
+
+//! Current time in ticks (TSC where available, nanoseconds otherwise)
+inline uint64_t ticks() noexcept {
+#if defined(MODBUS_STATS) && (defined(__x86_64__) || defined(__i386__))
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+//! Adds duration of stage that started at start ticks, no-op without stats
+inline void record(Stage stage, uint64_t start) noexcept {
+  if constexpr (Enabled) {
+    const auto duration = ticks() - start;
+    auto &histogram = details::threadHistograms.histograms[stage];
+    details::add(histogram.sum, duration);
+    details::add(histogram.buckets[std::min<std::size_t>(
+                     std::bit_width(duration), Buckets - 1)],
+                 1);
+    if (duration > histogram.max.load(std::memory_order_relaxed))
+      histogram.max.store(duration, std::memory_order_relaxed);
+  } else {
+    (void)stage;
+    (void)start;
+  }
+}
+
+//! Records duration of enclosing scope
+class Scope {
+private:
+  Stage _stage;
+  uint64_t _start;
+
+public:
+  explicit Scope(Stage stage) noexcept
+      : _stage(stage), _start(Enabled ? ticks() : 0) {}
+  ~Scope() { record(_stage, _start); }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+};
+
+//! Statistics of a single stage, durations in nanoseconds
+struct StageStats {
+  uint64_t count = 0;
+  double mean = 0;
+  double max = 0;
+  //! Upper bound of each histogram bucket
+  std::array<double, Buckets> bucketLimits{};
+  std::array<uint64_t, Buckets> buckets{};
+
+  /**
+   * @brief Estimates percentile from histogram.
+   * @param percent - Value in range [0, 100].
+   * @return Upper bound of bucket containing percentile, so it is accurate
+   * up to factor of 2.
+   */
+  [[nodiscard]] double percentile(double percent) const noexcept;
+};
+
+//! Statistics of all stages, index with Stage
+using Snapshot = std::array<StageStats, StageCount>;
+
+//! Returns statistics collected since start (or reset())
+Snapshot snapshot();
+
+//! Clears statistics, recording at the same time may be partially lost
+void reset() noexcept;
+
+//! Human readable name of stage
+std::string toString(Stage stage);
+} // namespace MB::Stats
+
+#ifdef MODBUS_STATS
+#define MODBUS_STATS_CONCAT_(a, b) a##b
+#define MODBUS_STATS_CONCAT(a, b) MODBUS_STATS_CONCAT_(a, b)
+//! Measures enclosing scope as given stage
+#define MODBUS_STATS_SCOPE(stage)                                              \
+  ::MB::Stats::Scope MODBUS_STATS_CONCAT(modbusStatsScope, __LINE__)(stage)
+#else
+#define MODBUS_STATS_SCOPE(stage) static_cast<void>(0)
+#endif
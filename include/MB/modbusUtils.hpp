@@ -6,9 +6,12 @@
 
 #pragma once
 
+#include <charconv>
 #include <cstdint>
+#include <cstdlib>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <tuple>
 
@@ -71,8 +74,8 @@ inline bool isStandardErrorCode(MBErrorCode code) {
   }
 }
 
-//! Converts Modbus error code to it's string representation
-inline std::string mbErrorCodeToStr(MBErrorCode code) noexcept {
+//! Name of Modbus error code, does not allocate
+constexpr std::string_view mbErrorCodeName(MBErrorCode code) noexcept {
   switch (code) {
   case IllegalFunction:
     return "Illegal function";
@@ -113,6 +116,11 @@ inline std::string mbErrorCodeToStr(MBErrorCode code) noexcept {
   }
 }
 
+//! Converts Modbus error code to it's string representation
+inline std::string mbErrorCodeToStr(MBErrorCode code) noexcept {
+  return std::string(mbErrorCodeName(code));
+}
+
 //! All modbus standard function codes + Undefined one
 enum MBFunctionCode : uint8_t {
   // Reading functions
@@ -151,7 +159,11 @@ inline MBFunctionType functionType(const MBFunctionCode code) {
   case WriteMultipleDiscreteOutputCoils:
     return WriteMultiple;
   default:
+#if defined(__cpp_exceptions)
     throw std::runtime_error("The function code is undefined");
+#else
+    std::abort();
+#endif
   }
 }
 
@@ -179,12 +191,16 @@ inline MBFunctionRegisters functionRegister(const MBFunctionCode code) {
   case ReadAnalogInputRegisters:
     return InputRegisters;
   default:
+#if defined(__cpp_exceptions)
     throw std::runtime_error("The function code is undefined");
+#else
+    std::abort();
+#endif
   }
 }
 
-//! Converts modbus function code to its string represenatiton
-inline std::string mbFunctionToStr(MBFunctionCode code) noexcept {
+//! Name of modbus function code, does not allocate
+constexpr std::string_view mbFunctionName(MBFunctionCode code) noexcept {
   switch (code) {
   case ReadDiscreteOutputCoils:
     return "Read from output coils";
@@ -207,6 +223,18 @@ inline std::string mbFunctionToStr(MBFunctionCode code) noexcept {
   }
 }
 
+//! Converts modbus function code to its string represenatiton
+inline std::string mbFunctionToStr(MBFunctionCode code) noexcept {
+  return std::string(mbFunctionName(code));
+}
+
+//! Appends decimal representation of value, without temporary strings
+inline void appendNumber(std::string &out, unsigned value) {
+  char buffer[10];
+  const auto end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+  out.append(buffer, end);
+}
+
 //! Create uint16_t from buffer of two bytes, ex. { 0x01, 0x02 } => 0x0102
 inline uint16_t bigEndianConv(const uint8_t *buf) {
   return static_cast<uint16_t>(buf[1]) +
@@ -270,8 +298,10 @@ inline std::pair<uint8_t, uint8_t> splitUint16(const uint16_t val) {
   return std::make_pair((val >> 8) & 0xFF, val & 0xFF);
 }
 
-//! Insert uint16_t into buffer of uint8_t's. Preserve big endianess.
-inline void pushUint16(std::vector<uint8_t>& buffer, const uint16_t val) {
+//! Insert uint16_t into buffer of uint8_t's (std::vector or
+//! std::pmr::vector). Preserve big endianess.
+template <typename Buffer>
+inline void pushUint16(Buffer& buffer, const uint16_t val) {
   auto [high, low] = splitUint16(val);
   buffer.push_back(high);
   buffer.push_back(low);
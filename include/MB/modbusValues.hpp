@@ -0,0 +1,272 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// This header contains conversions between registers and multi register
+// values (16, 32 and 64 bit integers, floats and doubles)
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#include "modbusCell.hpp"
+#include "modbusResponse.hpp"
+
+namespace MB::utils {
+
+/*! Order of bytes of multi register value as it is sent on the wire, A is
+ * the most significant byte. For 64 bit values the same rule is extended,
+ * ex. CDAB means that the least significant register is sent first.
+ */
+enum WordOrder : uint8_t {
+  //! Big endian, Modbus standard
+  ABCD,
+  //! Registers swapped ("word swap")
+  CDAB,
+  //! Bytes inside of registers swapped
+  BADC,
+  //! Little endian
+  DCBA
+};
+
+//! Types that can be stored in registers
+template <typename T>
+concept RegisterValue = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+                        (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+//! Number of registers taken by the value of type T
+template <RegisterValue T>
+constexpr std::size_t registersCount = sizeof(T) / 2;
+
+namespace details {
+template <typename T>
+using Bits = std::conditional_t<
+    sizeof(T) == 2, uint16_t,
+    std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>;
+
+constexpr bool swapsWords(WordOrder order) {
+  return order == CDAB || order == DCBA;
+}
+
+constexpr bool swapsBytes(WordOrder order) {
+  return order == BADC || order == DCBA;
+}
+
+//! Index of wire byte that holds k-th (from most significant) value byte
+template <RegisterValue T, WordOrder Order>
+constexpr std::array<uint8_t, sizeof(T)> bytePermutation() {
+  constexpr auto words = registersCount<T>;
+  std::array<uint8_t, sizeof(T)> result{};
+  for (std::size_t m = 0; m < words; m++) {
+    auto word = swapsWords(Order) ? words - 1 - m : m;
+    result[2 * m] = static_cast<uint8_t>(2 * word + (swapsBytes(Order) ? 1 : 0));
+    result[2 * m + 1] =
+        static_cast<uint8_t>(2 * word + (swapsBytes(Order) ? 0 : 1));
+  }
+  return result;
+}
+
+template <RegisterValue T, WordOrder Order>
+inline T fromWords(const uint16_t *words) {
+  constexpr auto count = registersCount<T>;
+  Bits<T> bits = 0;
+  for (std::size_t m = 0; m < count; m++) {
+    uint16_t word = words[swapsWords(Order) ? count - 1 - m : m];
+    if constexpr (swapsBytes(Order))
+      word = static_cast<uint16_t>((word << 8) | (word >> 8));
+    bits = static_cast<Bits<T>>((bits << 16) | word);
+  }
+  return std::bit_cast<T>(bits);
+}
+
+template <RegisterValue T, WordOrder Order>
+inline void toWords(T value, uint16_t *words) {
+  constexpr auto count = registersCount<T>;
+  auto bits = std::bit_cast<Bits<T>>(value);
+  for (std::size_t m = count; m-- > 0;) {
+    auto word = static_cast<uint16_t>(bits & 0xFFFF);
+    if constexpr (swapsBytes(Order))
+      word = static_cast<uint16_t>((word << 8) | (word >> 8));
+    words[swapsWords(Order) ? count - 1 - m : m] = word;
+    bits = static_cast<Bits<T>>(bits >> 8 >> 8);
+  }
+}
+
+template <RegisterValue T, WordOrder Order>
+inline T fromBytes(const uint8_t *bytes) {
+  constexpr auto permutation = bytePermutation<T, Order>();
+  Bits<T> bits = 0;
+  for (auto index : permutation)
+    bits = static_cast<Bits<T>>((bits << 8) | bytes[index]);
+  return std::bit_cast<T>(bits);
+}
+
+template <RegisterValue T, WordOrder Order>
+inline void decodeWords(const uint16_t *registers, T *out, std::size_t count) {
+  for (std::size_t i = 0; i < count; i++)
+    out[i] = fromWords<T, Order>(registers + i * registersCount<T>);
+}
+
+template <RegisterValue T, WordOrder Order>
+inline void decodeBytes(const uint8_t *bytes, T *out, std::size_t count) {
+  std::size_t i = 0;
+#if defined(__SSSE3__)
+  // Every 16 bytes are converted with a single shuffle, host is little endian
+  if constexpr (std::endian::native == std::endian::little) {
+    constexpr auto permutation = bytePermutation<T, Order>();
+    constexpr auto perVector = 16 / sizeof(T);
+    alignas(16) uint8_t mask[16];
+    for (std::size_t v = 0; v < perVector; v++)
+      for (std::size_t b = 0; b < sizeof(T); b++)
+        mask[v * sizeof(T) + b] = static_cast<uint8_t>(
+            v * sizeof(T) + permutation[sizeof(T) - 1 - b]);
+
+    const auto shuffle = _mm_load_si128(reinterpret_cast<const __m128i *>(mask));
+    for (; i + perVector <= count; i += perVector) {
+      auto data = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(bytes + i * sizeof(T)));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                       _mm_shuffle_epi8(data, shuffle));
+    }
+  }
+#endif
+  for (; i < count; i++)
+    out[i] = fromBytes<T, Order>(bytes + i * sizeof(T));
+}
+
+template <RegisterValue T, WordOrder Order>
+inline void encodeWords(const T *values, uint16_t *registers,
+                        std::size_t count) {
+  for (std::size_t i = 0; i < count; i++)
+    toWords<T, Order>(values[i], registers + i * registersCount<T>);
+}
+
+// Turns runtime order into template argument, so that loops above are
+// compiled without any branches inside
+template <typename F> inline void withOrder(WordOrder order, F &&function) {
+  switch (order) {
+  case ABCD:
+    function(std::integral_constant<WordOrder, ABCD>());
+    break;
+  case CDAB:
+    function(std::integral_constant<WordOrder, CDAB>());
+    break;
+  case BADC:
+    function(std::integral_constant<WordOrder, BADC>());
+    break;
+  case DCBA:
+    function(std::integral_constant<WordOrder, DCBA>());
+    break;
+  }
+}
+} // namespace details
+
+//! Creates single value from registers, words must hold registersCount<T>
+//! registers
+template <RegisterValue T>
+inline T decodeValue(const uint16_t *words, WordOrder order = ABCD) {
+  T result{};
+  details::withOrder(order, [&](auto o) {
+    result = details::fromWords<T, decltype(o)::value>(words);
+  });
+  return result;
+}
+
+//! Splits single value into registersCount<T> registers
+template <RegisterValue T>
+inline void encodeValue(T value, uint16_t *words, WordOrder order = ABCD) {
+  details::withOrder(order, [&](auto o) {
+    details::toWords<T, decltype(o)::value>(value, words);
+  });
+}
+
+/**
+ * @brief Converts registers into array of values.
+ * @param registers - Registers as returned by the device.
+ * @param out - Output values, as many as fit in the registers are converted.
+ * @param order - Word order used by the device.
+ * @return Number of converted values.
+ */
+template <RegisterValue T>
+inline std::size_t decodeValues(std::span<const uint16_t> registers,
+                                std::span<T> out, WordOrder order = ABCD) {
+  auto count = std::min(out.size(), registers.size() / registersCount<T>);
+  details::withOrder(order, [&](auto o) {
+    details::decodeWords<T, decltype(o)::value>(registers.data(), out.data(),
+                                                count);
+  });
+  return count;
+}
+
+/**
+ * @brief Converts raw register bytes (ex. payload of read response, see
+ * ResponseBatch::payloadOffsets) into array of values.
+ * @param payload - Registers in wire (big endian) representation.
+ * @param out - Output values, as many as fit in the payload are converted.
+ * @param order - Word order used by the device.
+ * @return Number of converted values.
+ */
+template <RegisterValue T>
+inline std::size_t decodeValues(std::span<const uint8_t> payload,
+                                std::span<T> out, WordOrder order = ABCD) {
+  auto count = std::min(out.size(), payload.size() / sizeof(T));
+  details::withOrder(order, [&](auto o) {
+    details::decodeBytes<T, decltype(o)::value>(payload.data(), out.data(),
+                                                count);
+  });
+  return count;
+}
+
+/**
+ * @brief Converts register cells into array of values.
+ * @throws bad_variant_access - When some cell is a coil.
+ * @return Number of converted values.
+ */
+template <RegisterValue T>
+inline std::size_t decodeValues(std::span<const ModbusCell> cells,
+                                std::span<T> out, WordOrder order = ABCD) {
+  auto count = std::min(out.size(), cells.size() / registersCount<T>);
+  uint16_t words[registersCount<T>];
+  for (std::size_t i = 0; i < count; i++) {
+    for (std::size_t w = 0; w < registersCount<T>; w++)
+      words[w] = cells[i * registersCount<T> + w].reg();
+    out[i] = decodeValue<T>(words, order);
+  }
+  return count;
+}
+
+//! Converts register values of the response into array of values
+template <RegisterValue T>
+inline std::size_t decodeValues(const ModbusResponse &response,
+                                std::span<T> out, WordOrder order = ABCD) {
+  const auto &values = response.registerValues();
+  return decodeValues<T>(std::span<const ModbusCell>(values.data(), values.size()),
+                         out, order);
+}
+
+/**
+ * @brief Converts array of values into registers, ex. for write request.
+ * @return Number of converted values.
+ */
+template <RegisterValue T>
+inline std::size_t encodeValues(std::span<const T> values,
+                                std::span<uint16_t> registers,
+                                WordOrder order = ABCD) {
+  auto count = std::min(values.size(), registers.size() / registersCount<T>);
+  details::withOrder(order, [&](auto o) {
+    details::encodeWords<T, decltype(o)::value>(values.data(), registers.data(),
+                                                count);
+  });
+  return count;
+}
+} // namespace MB::utils
@@ -0,0 +1,99 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace MB::utils {
+/**
+ * @brief Bounded, lock-free multi-producer single-consumer queue.
+ *
+ * Any number of threads may call tryPush() concurrently, only one thread may
+ * call tryPop(). Storage is allocated once, in the constructor, so pushing and
+ * popping never allocates.
+ */
+template <typename T> class MPSCQueue {
+private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    std::optional<T> value;
+  };
+
+  std::unique_ptr<Slot[]> _slots;
+  std::size_t _mask;
+
+  alignas(64) std::atomic<std::size_t> _head = 0;
+  alignas(64) std::size_t _tail = 0;
+
+public:
+  /**
+   * @brief Constructs queue.
+   * @param capacity - Minimal number of elements, rounded up to power of two.
+   */
+  explicit MPSCQueue(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity)
+      size <<= 1;
+
+    _slots = std::make_unique<Slot[]>(size);
+    _mask = size - 1;
+    for (std::size_t i = 0; i < size; i++)
+      _slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  MPSCQueue(const MPSCQueue &) = delete;
+  MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+  //! Returns number of elements that queue can hold
+  [[nodiscard]] std::size_t capacity() const noexcept { return _mask + 1; }
+
+  /**
+   * @brief Pushes value to the queue, safe to call from many threads.
+   * @return False when queue is full, value is left untouched then.
+   */
+  bool tryPush(T &&value) {
+    auto pos = _head.load(std::memory_order_relaxed);
+    while (true) {
+      auto &slot = _slots[pos & _mask];
+      auto seq = slot.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq) -
+                  static_cast<std::ptrdiff_t>(pos);
+
+      if (diff == 0) {
+        if (_head.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          slot.value.emplace(std::move(value));
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Pops value from the queue, only one thread may call it.
+   * @return Popped value or std::nullopt when queue is empty.
+   */
+  std::optional<T> tryPop() {
+    auto &slot = _slots[_tail & _mask];
+    if (slot.sequence.load(std::memory_order_acquire) != _tail + 1)
+      return std::nullopt;
+
+    std::optional<T> value = std::move(slot.value);
+    slot.value.reset();
+    slot.sequence.store(_tail + _mask + 1, std::memory_order_release);
+    _tail++;
+    return value;
+  }
+};
+} // namespace MB::utils
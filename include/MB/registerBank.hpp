@@ -0,0 +1,174 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "changeNotifier.hpp"
+#include "modbusCell.hpp"
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "modbusUtils.hpp"
+
+namespace MB {
+
+/**
+ * @brief Data of a single slave: coils, discrete inputs, holding and input
+ * registers, served with handle().
+ *
+ * Banks are not synchronized, they are meant to be accessed from the thread
+ * that serves requests.
+ */
+class RegisterBank {
+private:
+  std::shared_ptr<ChangeNotifier> _notifier;
+
+public:
+  virtual ~RegisterBank() = default;
+
+  /**
+   * @brief Copies out.size() values of table starting at address.
+   * Coil tables produce coil cells and register tables register cells.
+   * @throws ModbusException - IllegalDataAddress when any value is missing.
+   */
+  virtual void read(utils::MBFunctionRegisters table, uint16_t address,
+                    std::span<ModbusCell> out) const = 0;
+
+  /**
+   * @brief Stores values in table starting at address. Input tables may be
+   * written too, only handle() limits requests to writable tables.
+   * @throws ModbusException - IllegalDataAddress when any value is missing.
+   */
+  virtual void write(utils::MBFunctionRegisters table, uint16_t address,
+                     std::span<const ModbusCell> values) = 0;
+
+  /**
+   * @brief Executes request on the bank.
+   * @throws ModbusException - Error that should be sent back, with slave id
+   * and function code of the request.
+   */
+  [[nodiscard]] ModbusResponse handle(const ModbusRequest &request);
+
+  /**
+   * @brief Publishes ranges written by requests passed to handle(), writes
+   * made directly with write() are not published.
+   */
+  void setChangeNotifier(std::shared_ptr<ChangeNotifier> notifier) {
+    _notifier = std::move(notifier);
+  }
+};
+
+/**
+ * @brief Bank that keeps every table in a contiguous array, starting at
+ * address 0. Suits devices with compact address space, see
+ * SparseRegisterBank for scattered addresses.
+ */
+class DenseRegisterBank : public RegisterBank {
+public:
+  //! Number of values in the largest possible table
+  static constexpr std::size_t MaxTableSize = 65536;
+
+private:
+  std::vector<bool> _coils;
+  std::vector<bool> _contacts;
+  std::vector<uint16_t> _holding;
+  std::vector<uint16_t> _input;
+
+  void check(std::size_t tableSize, uint16_t address, std::size_t count) const;
+
+public:
+  //! Creates bank with size values in every table
+  explicit DenseRegisterBank(std::size_t size = MaxTableSize)
+      : DenseRegisterBank(size, size, size, size) {}
+
+  //! Creates bank with given table sizes, values are zeroed
+  DenseRegisterBank(std::size_t outputCoils, std::size_t inputContacts,
+                    std::size_t holdingRegisters, std::size_t inputRegisters);
+
+  void read(utils::MBFunctionRegisters table, uint16_t address,
+            std::span<ModbusCell> out) const override;
+  void write(utils::MBFunctionRegisters table, uint16_t address,
+             std::span<const ModbusCell> values) override;
+
+  //! Number of values in table
+  [[nodiscard]] std::size_t size(utils::MBFunctionRegisters table) const;
+
+  //! Direct access to holding or input registers
+  [[nodiscard]] std::span<uint16_t> registers(utils::MBFunctionRegisters table);
+  [[nodiscard]] std::span<const uint16_t>
+  registers(utils::MBFunctionRegisters table) const;
+
+  //! Direct access to output coils or input contacts
+  [[nodiscard]] std::vector<bool> &coils(utils::MBFunctionRegisters table);
+  [[nodiscard]] const std::vector<bool> &
+  coils(utils::MBFunctionRegisters table) const;
+};
+
+/**
+ * @brief Bank for scattered addresses, memory is allocated per page of
+ * PageSize values that contains at least one defined value.
+ *
+ * Every table is a two level radix: address high byte selects page and low
+ * byte value in it. Only defined addresses may be read or written, others
+ * are reported with IllegalDataAddress like by a real device.
+ */
+class SparseRegisterBank : public RegisterBank {
+public:
+  static constexpr std::size_t PageSize = 256;
+
+private:
+  static constexpr std::size_t PagesCount =
+      DenseRegisterBank::MaxTableSize / PageSize;
+
+  // Coils are stored as 0 or 1, so both kinds of tables share the layout
+  struct Page {
+    std::array<uint16_t, PageSize> values{};
+    std::bitset<PageSize> defined;
+  };
+  using Table = std::array<std::unique_ptr<Page>, PagesCount>;
+
+  std::array<Table, 4> _tables;
+
+  [[nodiscard]] const Table &table(utils::MBFunctionRegisters table) const {
+    return _tables[static_cast<std::size_t>(table)];
+  }
+  [[nodiscard]] Table &table(utils::MBFunctionRegisters table) {
+    return _tables[static_cast<std::size_t>(table)];
+  }
+
+  //! Calls fn(page, offset, count) for every page of range, all defined
+  template <typename Function>
+  void forRange(utils::MBFunctionRegisters table, uint16_t address,
+                std::size_t count, Function &&fn) const;
+
+public:
+  /**
+   * @brief Makes count values of table starting at address available,
+   * with initial value. Already defined values are overwritten.
+   */
+  void define(utils::MBFunctionRegisters table, uint16_t address,
+              std::size_t count, uint16_t initial = 0);
+  //! Makes values unavailable, empty pages are freed
+  void undefine(utils::MBFunctionRegisters table, uint16_t address,
+                std::size_t count);
+
+  [[nodiscard]] bool defined(utils::MBFunctionRegisters table,
+                             uint16_t address) const;
+
+  //! Number of allocated pages in all tables
+  [[nodiscard]] std::size_t pagesCount() const;
+
+  void read(utils::MBFunctionRegisters table, uint16_t address,
+            std::span<ModbusCell> out) const override;
+  void write(utils::MBFunctionRegisters table, uint16_t address,
+             std::span<const ModbusCell> values) override;
+};
+} // namespace MB
@@ -0,0 +1,213 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "mpscQueue.hpp"
+
+namespace MB {
+/**
+ * @brief Thread safe client front-end for a single connection.
+ *
+ * Connection is moved into the client and is used only by its dedicated I/O
+ * thread. Any thread can submit requests, they are passed to the I/O thread
+ * through lock-free queue and processed in submission order. Works with
+ * MB::TCP::Connection and MB::Serial::Connection.
+ */
+template <typename Connection> class SharedClient {
+public:
+  /**
+   * Called on the I/O thread when request completes. On success response
+   * points to received response and error is empty, otherwise response is
+   * nullptr and error holds thrown exception (usually ModbusException).
+   * Callback must not throw.
+   */
+  using Callback = std::function<void(const ModbusResponse *response,
+                                      std::exception_ptr error)>;
+
+  static const std::size_t DefaultQueueCapacity = 256;
+
+private:
+  struct Job {
+    ModbusRequest request;
+    std::optional<std::promise<ModbusResponse>> promise;
+    Callback callback;
+  };
+
+  Connection _connection;
+  utils::MPSCQueue<Job> _queue;
+  std::atomic<uint32_t> _pending = 0;
+  std::atomic<bool> _running = true;
+  std::thread _thread;
+
+public:
+  /**
+   * @brief Constructs client and starts its I/O thread.
+   * @param connection - Connection that will be owned by the client.
+   * @param queueCapacity - Maximal number of not yet processed requests.
+   */
+  explicit SharedClient(Connection &&connection,
+                        std::size_t queueCapacity = DefaultQueueCapacity)
+      : _connection(std::move(connection)), _queue(queueCapacity),
+        _thread([this]() { run(); }) {}
+
+  SharedClient(const SharedClient &) = delete;
+  SharedClient &operator=(const SharedClient &) = delete;
+
+  /**
+   * @brief Stops I/O thread, requests that were not sent yet fail with
+   * ConnectionClosed.
+   */
+  ~SharedClient() {
+    _running.store(false, std::memory_order_release);
+    _pending.fetch_add(1, std::memory_order_release);
+    _pending.notify_one();
+    _thread.join();
+  }
+
+  /**
+   * @brief Submits request, may be called from any thread.
+   * @return Future that holds response or thrown ModbusException.
+   */
+  std::future<ModbusResponse> submit(const ModbusRequest &request) {
+    std::promise<ModbusResponse> promise;
+    auto future = promise.get_future();
+    push(Job{request, std::move(promise), nullptr});
+    return future;
+  }
+
+  /**
+   * @brief Submits request, may be called from any thread.
+   * @param callback - Called from I/O thread when request completes.
+   */
+  void submit(const ModbusRequest &request, Callback callback) {
+    push(Job{request, std::nullopt, std::move(callback)});
+  }
+
+private:
+  void push(Job &&job) {
+    // Counter is raised before the push, so I/O thread never sleeps while
+    // some producer is in the middle of pushing
+    _pending.fetch_add(1, std::memory_order_acq_rel);
+    while (!_queue.tryPush(std::move(job)))
+      std::this_thread::yield();
+    _pending.notify_one();
+  }
+
+  static void complete(Job &job, const ModbusResponse *response,
+                       std::exception_ptr error) {
+    if (job.promise) {
+      if (error)
+        job.promise->set_exception(error);
+      else
+        job.promise->set_value(*response);
+    } else if (job.callback) {
+      job.callback(response, error);
+    }
+  }
+
+  ModbusResponse awaitResponse() {
+    if constexpr (std::is_same_v<decltype(_connection.awaitResponse()),
+                                 ModbusResponse>)
+      return _connection.awaitResponse();
+    else
+      return std::get<0>(_connection.awaitResponse());
+  }
+
+  ModbusResponse transact(const ModbusRequest &request) {
+    constexpr bool identified = requires(Connection c) {
+      c.setMessageId(uint16_t{});
+      c.getTimeout();
+      c.setTimeout(int{});
+    };
+
+    if constexpr (requires(Connection c) { c.setMessageId(uint16_t{}); })
+      _connection.setMessageId(
+          static_cast<uint16_t>(_connection.getMessageId() + 1));
+
+    _connection.sendRequest(request);
+
+    if constexpr (!identified) {
+      return awaitResponse();
+    } else {
+      // Late replies to requests that timed out are still in the stream,
+      // they are dropped until the expected one arrives or time runs out
+      struct RestoreTimeout {
+        Connection &connection;
+        int timeout;
+        ~RestoreTimeout() { connection.setTimeout(timeout); }
+      } restore{_connection, _connection.getTimeout()};
+      const auto deadline = std::chrono::steady_clock::now() +
+                            std::chrono::milliseconds(restore.timeout);
+
+      while (true) {
+        try {
+          return awaitResponse();
+        } catch (const ModbusException &ex) {
+          if (ex.getErrorCode() != utils::InvalidMessageID)
+            throw;
+        }
+
+        const auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now())
+                .count();
+        if (remaining <= 0)
+          throw ModbusException(utils::Timeout);
+        _connection.setTimeout(static_cast<int>(remaining));
+      }
+    }
+  }
+
+  void run() {
+    while (true) {
+      auto job = _queue.tryPop();
+
+      if (!job) {
+        if (!_running.load(std::memory_order_acquire))
+          break;
+
+        if (_pending.load(std::memory_order_acquire) == 0)
+          _pending.wait(0, std::memory_order_acquire);
+        else
+          std::this_thread::yield();
+        continue;
+      }
+
+      _pending.fetch_sub(1, std::memory_order_relaxed);
+
+      if (!_running.load(std::memory_order_acquire)) {
+        complete(*job, nullptr,
+                 std::make_exception_ptr(
+                     ModbusException(utils::ConnectionClosed)));
+        continue;
+      }
+
+      std::optional<ModbusResponse> response;
+      std::exception_ptr error;
+      try {
+        response.emplace(transact(job->request));
+      } catch (...) {
+        error = std::current_exception();
+      }
+      complete(*job, response ? &*response : nullptr, error);
+    }
+  }
+};
+} // namespace MB
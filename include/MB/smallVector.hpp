@@ -0,0 +1,247 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace MB::utils {
+/**
+ * @brief Vector that keeps up to N elements inline, without touching the heap.
+ *
+ * Only larger contents are allocated, from the memory resource given at
+ * construction (default resource otherwise). Elements must be trivially
+ * copyable, so copying and moving is always a plain memcpy. Interface follows
+ * std::pmr::vector, including propagation of the resource: copies use the
+ * default resource, moves keep the resource of the source.
+ */
+template <typename T, std::size_t N> class SmallVector {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "SmallVector elements must be trivially copyable");
+  static_assert(N > 0, "SmallVector needs inline capacity");
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  //! Number of elements stored without heap allocation
+  static constexpr size_type InlineCapacity = N;
+
+private:
+  T *_data;
+  std::pmr::memory_resource *_resource;
+  size_type _size = 0;
+  size_type _capacity = N;
+  alignas(T) std::byte _inline[N * sizeof(T)];
+
+  T *inlineData() noexcept { return reinterpret_cast<T *>(_inline); }
+
+  void release() noexcept {
+    if (!isInline())
+      _resource->deallocate(_data, _capacity * sizeof(T), alignof(T));
+  }
+
+  // Moves contents into storage for at least capacity elements
+  void grow(size_type capacity) {
+    capacity = std::max(capacity, _capacity * 2);
+    T *data = static_cast<T *>(
+        _resource->allocate(capacity * sizeof(T), alignof(T)));
+    if (_size != 0)
+      std::memcpy(static_cast<void *>(data), _data, _size * sizeof(T));
+    release();
+    _data = data;
+    _capacity = capacity;
+  }
+
+  void fill(T *first, size_type count, const T &value) {
+    for (size_type i = 0; i < count; i++)
+      ::new (static_cast<void *>(first + i)) T(value);
+  }
+
+public:
+  SmallVector() noexcept : SmallVector(std::pmr::get_default_resource()) {}
+
+  explicit SmallVector(std::pmr::memory_resource *resource) noexcept
+      : _data(inlineData()), _resource(resource) {}
+
+  explicit SmallVector(size_type count, const T &value = T(),
+                       std::pmr::memory_resource *resource =
+                           std::pmr::get_default_resource())
+      : SmallVector(resource) {
+    assign(count, value);
+  }
+
+  template <std::input_iterator It>
+  SmallVector(It first, It last,
+              std::pmr::memory_resource *resource =
+                  std::pmr::get_default_resource())
+      : SmallVector(resource) {
+    assign(first, last);
+  }
+
+  SmallVector(std::initializer_list<T> values,
+              std::pmr::memory_resource *resource =
+                  std::pmr::get_default_resource())
+      : SmallVector(values.begin(), values.end(), resource) {}
+
+  //! Allows passing std::vector wherever SmallVector is expected
+  SmallVector(const std::vector<T> &values)
+      : SmallVector(values.begin(), values.end()) {}
+
+  SmallVector(const SmallVector &other) : SmallVector() { *this = other; }
+
+  SmallVector(const SmallVector &other, std::pmr::memory_resource *resource)
+      : SmallVector(resource) {
+    *this = other;
+  }
+
+  SmallVector(SmallVector &&other) noexcept : SmallVector(other._resource) {
+    *this = std::move(other);
+  }
+
+  //! Takes over storage of other only if both use the same resource
+  SmallVector(SmallVector &&other, std::pmr::memory_resource *resource)
+      : SmallVector(resource) {
+    *this = std::move(other);
+  }
+
+  ~SmallVector() { release(); }
+
+  SmallVector &operator=(const SmallVector &other) {
+    if (this != &other) {
+      if (other._size > _capacity)
+        grow(other._size);
+      if (other._size != 0)
+        std::memcpy(static_cast<void *>(_data), other._data,
+                    other._size * sizeof(T));
+      _size = other._size;
+    }
+    return *this;
+  }
+
+  /**
+   * @brief Takes over storage of other.
+   * @note If resources differ elements are copied instead, that may allocate.
+   */
+  SmallVector &operator=(SmallVector &&other) {
+    if (this == &other)
+      return *this;
+
+    if (other.isInline() || *other._resource != *_resource) {
+      *this = static_cast<const SmallVector &>(other);
+    } else {
+      release();
+      _data = other._data;
+      _size = other._size;
+      _capacity = other._capacity;
+      other._data = other.inlineData();
+      other._capacity = N;
+    }
+    other._size = 0;
+    return *this;
+  }
+
+  SmallVector &operator=(std::initializer_list<T> values) {
+    assign(values.begin(), values.end());
+    return *this;
+  }
+
+  //! Copies contents into std::vector, for code that expects one
+  operator std::vector<T>() const { return std::vector<T>(begin(), end()); }
+
+  void assign(size_type count, const T &value) {
+    clear();
+    resize(count, value);
+  }
+
+  template <std::input_iterator It> void assign(It first, It last) {
+    clear();
+    if constexpr (std::forward_iterator<It>)
+      reserve(static_cast<size_type>(std::distance(first, last)));
+    for (; first != last; ++first)
+      emplace_back(*first);
+  }
+
+  [[nodiscard]] T *data() noexcept { return _data; }
+  [[nodiscard]] const T *data() const noexcept { return _data; }
+
+  [[nodiscard]] size_type size() const noexcept { return _size; }
+  [[nodiscard]] size_type capacity() const noexcept { return _capacity; }
+  [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+
+  //! Resource used when elements do not fit inline
+  [[nodiscard]] std::pmr::memory_resource *resource() const noexcept {
+    return _resource;
+  }
+
+  //! Returns true if elements are stored without heap allocation
+  [[nodiscard]] bool isInline() const noexcept {
+    return _data == reinterpret_cast<const T *>(_inline);
+  }
+
+  iterator begin() noexcept { return _data; }
+  iterator end() noexcept { return _data + _size; }
+  const_iterator begin() const noexcept { return _data; }
+  const_iterator end() const noexcept { return _data + _size; }
+  const_iterator cbegin() const noexcept { return _data; }
+  const_iterator cend() const noexcept { return _data + _size; }
+
+  T &operator[](size_type index) noexcept { return _data[index]; }
+  const T &operator[](size_type index) const noexcept { return _data[index]; }
+
+  T &front() noexcept { return _data[0]; }
+  const T &front() const noexcept { return _data[0]; }
+  T &back() noexcept { return _data[_size - 1]; }
+  const T &back() const noexcept { return _data[_size - 1]; }
+
+  void reserve(size_type capacity) {
+    if (capacity > _capacity)
+      grow(capacity);
+  }
+
+  void resize(size_type size) { resize(size, T()); }
+
+  void resize(size_type size, const T &value) {
+    if (size > _capacity)
+      grow(size);
+    if (size > _size)
+      fill(_data + _size, size - _size, value);
+    _size = size;
+  }
+
+  void clear() noexcept { _size = 0; }
+
+  void push_back(const T &value) { emplace_back(value); }
+
+  template <typename... Args> T &emplace_back(Args &&...args) {
+    // Value is created first, as args may refer to an element
+    T value(std::forward<Args>(args)...);
+    if (_size == _capacity)
+      grow(_size + 1);
+    ::new (static_cast<void *>(_data + _size)) T(value);
+    return _data[_size++];
+  }
+
+  void pop_back() noexcept { _size--; }
+
+  [[nodiscard]] bool operator==(const SmallVector &other) const {
+    return std::equal(begin(), end(), other.begin(), other.end());
+  }
+};
+} // namespace MB::utils
@@ -0,0 +1,287 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace MB::utils {
+/**
+ * @brief Hierarchical timer wheel, schedule(), cancel() and firing are O(1).
+ *
+ * Time is split into ticks. Timers expiring within 64 ticks are kept in the
+ * first level, later ones in coarser levels (64 times longer slots each) and
+ * are moved down when their slot is reached. Timers further than 64^4 ticks
+ * wait on the last level and are reinserted until they get close enough.
+ * Timer fires at the first tick not earlier than its deadline, so it is never
+ * early and at most one tick late.
+ *
+ * Each timer carries value of type T, that is passed to the callback of
+ * advance(). Wheel does no I/O and does not read the clock.
+ */
+template <typename T> class TimerWheel {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  //! Handle of scheduled timer, stays invalid after timer fires or is cancelled
+  struct Id {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    [[nodiscard]] bool operator==(const Id &) const = default;
+  };
+
+private:
+  static constexpr std::size_t LevelBits = 6;
+  static constexpr std::size_t SlotsPerLevel = 1u << LevelBits;
+  static constexpr std::size_t Levels = 4;
+  static constexpr uint64_t MaxDelta = (uint64_t(1) << (LevelBits * Levels)) - 1;
+
+  static constexpr uint32_t Nil = UINT32_MAX;
+  // List of timers that are already due, fired on next advance()
+  static constexpr std::size_t ExpiredList = Levels * SlotsPerLevel;
+
+  struct Node {
+    T value{};
+    uint64_t expiry = 0;
+    uint32_t prev = Nil;
+    uint32_t next = Nil;
+    uint32_t generation = 0;
+    uint16_t list = 0;
+    bool active = false;
+  };
+
+  Clock::duration _tick;
+  Clock::time_point _origin;
+  uint64_t _current = 0;
+
+  std::vector<Node> _nodes;
+  uint32_t _free = Nil;
+  std::size_t _size = 0;
+
+  std::array<uint32_t, Levels * SlotsPerLevel + 1> _heads;
+  // Non empty slots of each level
+  std::array<uint64_t, Levels> _occupied{};
+
+  void link(uint32_t index, std::size_t list) {
+    auto &node = _nodes[index];
+    node.list = static_cast<uint16_t>(list);
+    node.prev = Nil;
+    node.next = _heads[list];
+    if (node.next != Nil)
+      _nodes[node.next].prev = index;
+    _heads[list] = index;
+    if (list != ExpiredList)
+      _occupied[list / SlotsPerLevel] |= uint64_t(1) << (list % SlotsPerLevel);
+  }
+
+  void unlink(uint32_t index) {
+    auto &node = _nodes[index];
+    if (node.prev != Nil)
+      _nodes[node.prev].next = node.next;
+    else
+      _heads[node.list] = node.next;
+    if (node.next != Nil)
+      _nodes[node.next].prev = node.prev;
+
+    if (node.list != ExpiredList && _heads[node.list] == Nil)
+      _occupied[node.list / SlotsPerLevel] &=
+          ~(uint64_t(1) << (node.list % SlotsPerLevel));
+  }
+
+  // Puts timer into the slot matching its distance from current tick
+  void place(uint32_t index) {
+    const auto expiry = _nodes[index].expiry;
+    if (expiry <= _current) {
+      link(index, ExpiredList);
+      return;
+    }
+
+    const auto target = _current + std::min(expiry - _current, MaxDelta);
+    std::size_t level = 0;
+    while (((target - _current) >> (LevelBits * (level + 1))) != 0)
+      level++;
+    link(index, level * SlotsPerLevel +
+                    ((target >> (LevelBits * level)) & (SlotsPerLevel - 1)));
+  }
+
+  void release(uint32_t index) {
+    auto &node = _nodes[index];
+    node.active = false;
+    node.generation++;
+    node.value = T{};
+    node.next = _free;
+    _free = index;
+    _size--;
+  }
+
+  template <typename Callback> void fire(std::size_t list, Callback &callback) {
+    // Callback may schedule or cancel timers, so list is re-read every time
+    while (_heads[list] != Nil) {
+      const auto index = _heads[list];
+      unlink(index);
+      T value = std::move(_nodes[index].value);
+      release(index);
+      callback(value);
+    }
+  }
+
+  // Next tick after current at which a timer fires or a slot moves down
+  [[nodiscard]] std::optional<uint64_t> nextTick() const noexcept {
+    std::optional<uint64_t> result;
+    for (std::size_t level = 0; level < Levels; level++) {
+      if (_occupied[level] == 0)
+        continue;
+
+      const auto shift = LevelBits * level;
+      const auto position = _current >> shift;
+      // First level has slot of current tick already processed
+      const auto start = (position + 1) & (SlotsPerLevel - 1);
+      const auto distance =
+          static_cast<uint64_t>(std::countr_zero(
+              std::rotr(_occupied[level], static_cast<int>(start)))) +
+          1;
+      const auto tick = (position + distance) << shift;
+      if (!result || tick < *result)
+        result = tick;
+    }
+    return result;
+  }
+
+  template <typename Callback>
+  void process(uint64_t tick, Callback &callback) {
+    _current = tick;
+    // Higher levels first, they may move timers to the slot of lower level
+    for (std::size_t level = Levels - 1; level > 0; level--) {
+      const auto shift = LevelBits * level;
+      if ((tick & ((uint64_t(1) << shift) - 1)) != 0)
+        continue;
+
+      const auto list =
+          level * SlotsPerLevel + ((tick >> shift) & (SlotsPerLevel - 1));
+      auto index = _heads[list];
+      _heads[list] = Nil;
+      _occupied[level] &= ~(uint64_t(1) << (list % SlotsPerLevel));
+      while (index != Nil) {
+        const auto next = _nodes[index].next;
+        place(index);
+        index = next;
+      }
+    }
+
+    fire(tick & (SlotsPerLevel - 1), callback);
+    fire(ExpiredList, callback);
+  }
+
+  [[nodiscard]] uint64_t toTick(Clock::time_point time) const noexcept {
+    if (time <= _origin)
+      return 0;
+    return static_cast<uint64_t>((time - _origin) / _tick);
+  }
+
+public:
+  /**
+   * @brief Constructs wheel.
+   * @param tick - Resolution of timers.
+   * @param origin - Time of tick 0, deadlines before it fire immediately.
+   */
+  explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(1),
+                      Clock::time_point origin = Clock::time_point())
+      : _tick(tick), _origin(origin) {
+    _heads.fill(Nil);
+  }
+
+  /**
+   * @brief Schedules timer. Deadline that has already passed fires on next
+   * advance().
+   * @return Id that may be used to cancel timer.
+   */
+  Id schedule(Clock::time_point deadline, T value) {
+    uint32_t index;
+    if (_free != Nil) {
+      index = _free;
+      _free = _nodes[index].next;
+    } else {
+      index = static_cast<uint32_t>(_nodes.size());
+      _nodes.emplace_back();
+    }
+
+    auto &node = _nodes[index];
+    node.value = std::move(value);
+    node.active = true;
+    // Rounded up, so timer never fires before deadline
+    node.expiry = toTick(deadline);
+    if (_origin + static_cast<Clock::rep>(node.expiry) * _tick < deadline)
+      node.expiry++;
+    _size++;
+    place(index);
+    return Id{index, node.generation};
+  }
+
+  //! Cancels timer, returns false if it has already fired or was cancelled
+  bool cancel(Id id) noexcept {
+    if (id.index >= _nodes.size())
+      return false;
+    auto &node = _nodes[id.index];
+    if (!node.active || node.generation != id.generation)
+      return false;
+
+    unlink(id.index);
+    release(id.index);
+    return true;
+  }
+
+  /**
+   * @brief Moves wheel to now, calling callback(T&) for every timer with
+   * deadline before or at now. Timers are fired in order of their ticks.
+   * @note Ticks without any timer are skipped, so long gaps are cheap.
+   */
+  template <typename Callback>
+  void advance(Clock::time_point now, Callback &&callback) {
+    const auto target = std::max(toTick(now), _current);
+    fire(ExpiredList, callback);
+    for (auto tick = nextTick(); tick && *tick <= target; tick = nextTick())
+      process(*tick, callback);
+    _current = target;
+  }
+
+  /**
+   * @brief Time at which advance() should be called next.
+   * @note It may be earlier than the nearest deadline, when timers have to
+   * be moved to a lower level first, but never later.
+   */
+  [[nodiscard]] std::optional<Clock::time_point> nextDeadline() const noexcept {
+    std::optional<uint64_t> tick;
+    if (_heads[ExpiredList] != Nil)
+      tick = _current;
+    else
+      tick = nextTick();
+
+    if (!tick)
+      return std::nullopt;
+    return _origin + static_cast<Clock::rep>(*tick) * _tick;
+  }
+
+  //! Cancels all timers
+  void clear() noexcept {
+    for (uint32_t index = 0; index < _nodes.size(); index++) {
+      if (_nodes[index].active)
+        release(index);
+    }
+    _heads.fill(Nil);
+    _occupied.fill(0);
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return _size; }
+  [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+};
+} // namespace MB::utils
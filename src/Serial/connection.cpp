@@ -4,6 +4,7 @@
 
 #ifndef _WIN32
 #include "Serial/connection.hpp"
+#include "MB/modbusStats.hpp"
 
 using namespace MB::Serial;
 
@@ -51,7 +52,14 @@ std::vector<uint8_t> Connection::sendException(const MB::ModbusException &except
 }
 
 std::vector<uint8_t> Connection::awaitRawMessage() {
-    std::vector<uint8_t> data(1024);
+    // Reads are at most 1024 bytes, copying them keeps a single read path
+    auto data = awaitRawMessage(std::pmr::get_default_resource());
+    return std::vector<uint8_t>(data.begin(), data.end());
+}
+
+std::pmr::vector<uint8_t>
+Connection::awaitRawMessage(std::pmr::memory_resource *resource) {
+    std::pmr::vector<uint8_t> data(1024, resource);
 
     pollfd waitingFD = {.fd = _fd, .events = POLLIN, .revents = POLLIN};
 
@@ -59,14 +67,20 @@ std::vector<uint8_t> Connection::awaitRawMessage() {
         throw MB::ModbusException(MB::utils::Timeout);
     }
 
-    auto size = ::read(_fd, data.begin().base(), 1024);
+    ssize_t size;
+    {
+        MODBUS_STATS_SCOPE(MB::Stats::Receive);
+        size = ::read(_fd, data.data(), data.size());
+    }
 
     if (size < 0) {
         throw MB::ModbusException(MB::utils::SlaveDeviceFailure);
     }
 
+    if (_recorder)
+        _recorder->record(FlightRecorder::Rx, std::span(data.data(), static_cast<std::size_t>(size)));
+
     data.resize(size);
-    data.shrink_to_fit();
 
     return data;
 }
@@ -89,7 +103,10 @@ std::tuple<MB::ModbusResponse, std::vector<uint8_t>> Connection::awaitResponse()
             break;
         }
         catch (const MB::ModbusException& ex) {
-            if (MB::utils::isStandardErrorCode(ex.getErrorCode()) || ex.getErrorCode() == MB::utils::Timeout || ex.getErrorCode() == MB::utils::SlaveDeviceFailure) throw ex;
+            if (MB::utils::isStandardErrorCode(ex.getErrorCode()) || ex.getErrorCode() == MB::utils::Timeout || ex.getErrorCode() == MB::utils::SlaveDeviceFailure) {
+                if (_recorder) _recorder->failure(ex);
+                throw ex;
+            }
             continue;
         }
     }
@@ -112,7 +129,10 @@ std::tuple<MB::ModbusRequest, std::vector<uint8_t>> Connection::awaitRequest() {
             break;
         }
         catch (const MB::ModbusException& ex) {
-            if (ex.getErrorCode() == MB::utils::Timeout || ex.getErrorCode() == MB::utils::SlaveDeviceFailure) throw ex;
+            if (ex.getErrorCode() == MB::utils::Timeout || ex.getErrorCode() == MB::utils::SlaveDeviceFailure) {
+                if (_recorder) _recorder->failure(ex);
+                throw ex;
+            }
             continue;
         }
     }
@@ -121,18 +141,27 @@ std::tuple<MB::ModbusRequest, std::vector<uint8_t>> Connection::awaitRequest() {
 }
 
 std::vector<uint8_t> Connection::send(std::vector<uint8_t> data) {
-    data.reserve(data.size() + 2);
-    const auto crc = utils::calculateCRC(data.begin().base(), data.size());
+    {
+        MODBUS_STATS_SCOPE(MB::Stats::Framing);
+        data.reserve(data.size() + 2);
+        const auto crc = utils::calculateCRC(data.begin().base(), data.size());
 
-    data.push_back(reinterpret_cast<const uint8_t *>(&crc)[0]);
-    data.push_back(reinterpret_cast<const uint8_t *>(&crc)[1]);
+        data.push_back(reinterpret_cast<const uint8_t *>(&crc)[0]);
+        data.push_back(reinterpret_cast<const uint8_t *>(&crc)[1]);
+    }
+
+    if (_recorder)
+        _recorder->record(FlightRecorder::Tx, data);
 
     // Ensure that nothing will intervene in our communication
     // WARNING: It may conflict with something (although it may also help in
     // most cases)
     tcflush(_fd, TCOFLUSH);
     // Write
-    write(_fd, data.begin().base(), data.size());
+    {
+        MODBUS_STATS_SCOPE(MB::Stats::Send);
+        write(_fd, data.begin().base(), data.size());
+    }
     // It may be a good idea to use tcdrain, although it has tendency to not
     // work as expected tcdrain(_fd);
     
@@ -142,6 +171,7 @@ std::vector<uint8_t> Connection::send(std::vector<uint8_t> data) {
 Connection::Connection(Connection &&moved) noexcept {
     _fd = moved._fd;
     _termios = moved._termios;
+    _recorder = std::move(moved._recorder);
     moved._fd = -1;
 }
 
@@ -150,6 +180,7 @@ Connection &Connection::operator=(Connection &&moved) {
 
     _fd = moved._fd;
     memcpy(&_termios, &(moved._termios), sizeof(moved._termios));
+    _recorder = std::move(moved._recorder);
     moved._fd = -1;
     return *this;
 }
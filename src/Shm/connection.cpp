@@ -0,0 +1,237 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Shm/connection.hpp"
+#include "modbusProtocol.hpp"
+#include "segment.hpp"
+
+using namespace MB::Shm;
+
+namespace {
+using MB::Protocol::MBAPSize;
+// Every record starts with generation of the client it belongs to
+constexpr std::size_t GenerationSize = sizeof(uint32_t);
+
+// 1 minute without request means the connection has died
+constexpr int RequestTimeout = 60 * 1000;
+} // namespace
+
+std::pair<Segment *, std::size_t> MB::Shm::mapSegment(const std::string &name) {
+  const int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+  if (fd == -1)
+    throw std::runtime_error("Cannot open shared memory " + name +
+                             ", errno = " + std::to_string(errno));
+
+  struct stat status = {};
+  if (::fstat(fd, &status) == -1 ||
+      static_cast<std::size_t>(status.st_size) < Segment::sizeFor(0)) {
+    ::close(fd);
+    throw std::runtime_error("Invalid shared memory segment " + name);
+  }
+
+  const auto size = static_cast<std::size_t>(status.st_size);
+  void *memory =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (memory == MAP_FAILED)
+    throw std::runtime_error("Cannot map shared memory " + name +
+                             ", errno = " + std::to_string(errno));
+
+  auto *segment = static_cast<Segment *>(memory);
+  if (std::atomic_ref<uint32_t>(segment->magic)
+              .load(std::memory_order_acquire) != Segment::Magic ||
+      Segment::sizeFor(segment->capacity) != size) {
+    ::munmap(memory, size);
+    throw std::runtime_error("Invalid shared memory segment " + name);
+  }
+  return {segment, size};
+}
+
+Connection::Connection(Segment *segment, std::size_t size, bool client) noexcept
+    : _segment(segment), _size(size), _client(client),
+      _input(client ? segment->responseRing() : segment->requestRing()),
+      _output(client ? segment->requestRing() : segment->responseRing()) {}
+
+Connection::Connection(Connection &&moved) noexcept
+    : _segment(moved._segment), _size(moved._size), _client(moved._client),
+      _generation(moved._generation), _input(moved._input), _output(moved._output),
+      _messageID(moved._messageID), _timeout(moved._timeout),
+      _spin(moved._spin) {
+  moved._segment = nullptr;
+}
+
+Connection &Connection::operator=(Connection &&other) noexcept {
+  if (this == &other)
+    return *this;
+
+  unmap();
+  _segment = other._segment;
+  _size = other._size;
+  _client = other._client;
+  _generation = other._generation;
+  _input = other._input;
+  _output = other._output;
+  _messageID = other._messageID;
+  _timeout = other._timeout;
+  _spin = other._spin;
+  other._segment = nullptr;
+  return *this;
+}
+
+Connection::~Connection() { unmap(); }
+
+void Connection::unmap() noexcept {
+  if (_segment == nullptr)
+    return;
+  if (_client) {
+    // Segment may already belong to a client that replaced this one
+    auto owner = static_cast<int32_t>(::getpid());
+    _segment->owner.compare_exchange_strong(owner, 0,
+                                            std::memory_order_release);
+  }
+  ::munmap(_segment, _size);
+  _segment = nullptr;
+}
+
+Connection Connection::with(const std::string &name) {
+  auto [segment, size] = mapSegment(name);
+
+  const auto self = static_cast<int32_t>(::getpid());
+  int32_t owner = 0;
+  while (!segment->owner.compare_exchange_strong(owner, self)) {
+    // Client killed without detaching leaves its pid behind. Its process
+    // has to be reaped first, zombies still count as alive.
+    if (owner == self || ::kill(owner, 0) == 0 || errno != ESRCH) {
+      ::munmap(segment, size);
+      throw std::runtime_error("Shared memory " + name +
+                               " already has a client");
+    }
+  }
+
+  Connection connection(segment, size, true);
+  // Responses meant for the previous client
+  connection._input.clear();
+  // Published before any request of this client, so server knows requests
+  // of older generations are stale
+  connection._generation =
+      segment->generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+  return connection;
+}
+
+template <typename Message> void Connection::send(const Message &message) {
+  // Response to a request of a client that went away
+  if (!_client &&
+      _segment->generation.load(std::memory_order_acquire) != _generation)
+    return;
+
+  std::array<uint8_t, GenerationSize + MBAPSize> header = {};
+  std::memcpy(header.data(), &_generation, GenerationSize);
+  // Fits every growth step of the largest frame, so encoding never touches
+  // the heap
+  std::array<std::byte, 1024> arena;
+  std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size(),
+                                               std::pmr::null_memory_resource());
+
+  const auto write = [&](std::span<const uint8_t> frame) {
+    auto *mbap = header.data() + GenerationSize;
+    mbap[0] = static_cast<uint8_t>(_messageID >> 8);
+    mbap[1] = static_cast<uint8_t>(_messageID);
+    mbap[4] = static_cast<uint8_t>(frame.size() >> 8);
+    mbap[5] = static_cast<uint8_t>(frame.size());
+    if (!_output.write(header, frame, _timeout, _spin))
+      throw MB::ModbusException(MB::utils::Timeout);
+  };
+
+  if constexpr (requires { message.toRaw(&resource); })
+    write(message.toRaw(&resource));
+  else
+    write(message.toRaw());
+}
+
+void Connection::sendRequest(const MB::ModbusRequest &req) { send(req); }
+
+void Connection::sendResponse(const MB::ModbusResponse &res) { send(res); }
+
+void Connection::sendException(const MB::ModbusException &ex) { send(ex); }
+
+std::span<const uint8_t> Connection::receive(int timeout,
+                                             utils::MBErrorCode timeoutError) {
+  while (true) {
+    auto frame = _input.read(timeout, _spin);
+    if (frame.empty())
+      throw MB::ModbusException(timeoutError);
+    if (frame.size() < GenerationSize + MBAPSize) {
+      _input.release();
+      throw MB::ModbusException(MB::utils::InvalidByteOrder);
+    }
+
+    uint32_t generation;
+    std::memcpy(&generation, frame.data(), GenerationSize);
+    if (!_client) {
+      // Loaded after the read, so generation of the client that wrote frame
+      // is already visible. Responses are tagged with the request's one.
+      if (generation == _segment->generation.load(std::memory_order_acquire)) {
+        _generation = generation;
+        return frame.subspan(GenerationSize);
+      }
+    } else if (generation == _generation) {
+      return frame.subspan(GenerationSize);
+    }
+    // Frame of a client that went away
+    _input.release();
+  }
+}
+
+MB::ModbusRequest Connection::awaitRequest(std::pmr::memory_resource *resource) {
+  auto frame = receive(RequestTimeout, MB::utils::Timeout);
+  _messageID = utils::bigEndianConv(frame.data());
+
+  try {
+    auto request = MB::ModbusRequest::fromRaw(frame.subspan(MBAPSize), resource);
+    _input.release();
+    return request;
+  } catch (...) {
+    _input.release();
+    throw;
+  }
+}
+
+MB::ModbusResponse
+Connection::awaitResponse(std::pmr::memory_resource *resource) {
+  auto frame = receive(_timeout, MB::utils::Timeout);
+
+  try {
+    if (utils::bigEndianConv(frame.data()) != _messageID)
+      throw MB::ModbusException(MB::utils::InvalidMessageID);
+
+    auto pdu = frame.subspan(MBAPSize);
+    if (MB::ModbusException::exist(pdu))
+      throw MB::ModbusException(pdu);
+
+    auto response = MB::ModbusResponse::fromRaw(pdu, resource);
+    _input.release();
+    return response;
+  } catch (...) {
+    _input.release();
+    throw;
+  }
+}
+
+std::vector<uint8_t> Connection::awaitRawMessage() {
+  auto frame = receive(RequestTimeout, MB::utils::ConnectionClosed);
+  std::vector<uint8_t> r(frame.begin(), frame.end());
+  _input.release();
+  return r;
+}
@@ -0,0 +1,166 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Shm/ring.hpp"
+
+using namespace MB::Shm;
+
+namespace {
+// Marks end of data before the ring wraps
+constexpr uint32_t WrapMarker = UINT32_MAX;
+
+using Clock = std::chrono::steady_clock;
+
+void pause() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Futexes are shared between processes, so no FUTEX_PRIVATE_FLAG
+void futexWait(std::atomic<uint32_t> &word, uint32_t expected,
+               Clock::time_point deadline, bool forever) noexcept {
+  timespec timeout = {};
+  if (!forever) {
+    auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        deadline - Clock::now());
+    if (remaining.count() <= 0)
+      return;
+    timeout.tv_sec = static_cast<time_t>(remaining.count() / 1'000'000'000);
+    timeout.tv_nsec = static_cast<long>(remaining.count() % 1'000'000'000);
+  }
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT,
+            expected, forever ? nullptr : &timeout, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t> &word) noexcept {
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE,
+            INT_MAX, nullptr, nullptr, 0);
+}
+
+/*
+ * Spins, then sleeps on sequence until ready() returns true or timeout
+ * passes. Waiting flag is raised before ready() is checked for the last
+ * time, so the other side either sees it or its change is seen here.
+ */
+template <typename Ready>
+bool wait(Ready &&ready, std::atomic<uint32_t> &sequence,
+          std::atomic<uint32_t> &waiting, int timeout, unsigned spin) {
+  for (unsigned i = 0; i < spin; i++) {
+    if (ready())
+      return true;
+    pause();
+  }
+
+  const bool forever = timeout < 0;
+  const auto deadline = Clock::now() + std::chrono::milliseconds(timeout);
+  while (true) {
+    waiting.store(1, std::memory_order_seq_cst);
+    const auto expected = sequence.load(std::memory_order_seq_cst);
+    if (ready()) {
+      waiting.store(0, std::memory_order_relaxed);
+      return true;
+    }
+    if (!forever && Clock::now() >= deadline) {
+      waiting.store(0, std::memory_order_relaxed);
+      return false;
+    }
+    futexWait(sequence, expected, deadline, forever);
+  }
+}
+
+void notify(std::atomic<uint32_t> &sequence, std::atomic<uint32_t> &waiting) {
+  if (waiting.load(std::memory_order_seq_cst) != 0) {
+    sequence.fetch_add(1, std::memory_order_seq_cst);
+    futexWake(sequence);
+  }
+}
+} // namespace
+
+bool Ring::write(std::span<const uint8_t> first,
+                 std::span<const uint8_t> second, int timeout, unsigned spin) {
+  const auto size = first.size() + second.size();
+  const auto record = recordSize(size);
+  if (record > _capacity / 2)
+    return false;
+
+  const auto head = _header->head.load(std::memory_order_relaxed);
+  const auto offset = head & (_capacity - 1);
+  // Frame must be contiguous, end of the ring is skipped if it does not fit
+  const auto skip = _capacity - offset < record ? _capacity - offset : 0;
+
+  const auto ready = [&] {
+    const auto tail = _header->tail.load(std::memory_order_acquire);
+    return _capacity - (head - tail) >= skip + record;
+  };
+  if (!wait(ready, _header->spaceSequence, _header->producerWaiting, timeout,
+            spin))
+    return false;
+
+  if (skip != 0)
+    std::memcpy(_data + offset, &WrapMarker, sizeof(uint32_t));
+
+  auto *out = _data + ((head + skip) & (_capacity - 1));
+  const auto length = static_cast<uint32_t>(size);
+  std::memcpy(out, &length, sizeof(length));
+  if (!first.empty())
+    std::memcpy(out + sizeof(length), first.data(), first.size());
+  if (!second.empty())
+    std::memcpy(out + sizeof(length) + first.size(), second.data(),
+                second.size());
+
+  _header->head.store(head + skip + record, std::memory_order_seq_cst);
+  notify(_header->dataSequence, _header->consumerWaiting);
+  return true;
+}
+
+std::span<const uint8_t> Ring::read(int timeout, unsigned spin) {
+  const auto ready = [this] {
+    return _header->head.load(std::memory_order_acquire) !=
+           _header->tail.load(std::memory_order_relaxed);
+  };
+  if (!wait(ready, _header->dataSequence, _header->consumerWaiting, timeout,
+            spin))
+    return {};
+
+  auto tail = _header->tail.load(std::memory_order_relaxed);
+  uint32_t length;
+  std::memcpy(&length, _data + (tail & (_capacity - 1)), sizeof(length));
+  if (length == WrapMarker) {
+    // Producer always writes the frame right after the marker
+    tail += _capacity - (tail & (_capacity - 1));
+    _header->tail.store(tail, std::memory_order_relaxed);
+    std::memcpy(&length, _data, sizeof(length));
+  }
+
+  _reading = recordSize(length);
+  return {_data + (tail & (_capacity - 1)) + sizeof(length), length};
+}
+
+void Ring::release() noexcept {
+  if (_reading == 0)
+    return;
+
+  const auto tail = _header->tail.load(std::memory_order_relaxed);
+  _header->tail.store(tail + _reading, std::memory_order_seq_cst);
+  _reading = 0;
+  notify(_header->spaceSequence, _header->producerWaiting);
+}
+
+void Ring::clear() noexcept {
+  _reading = 0;
+  _header->tail.store(_header->head.load(std::memory_order_acquire),
+                      std::memory_order_seq_cst);
+  notify(_header->spaceSequence, _header->producerWaiting);
+}
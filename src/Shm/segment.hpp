@@ -0,0 +1,54 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include "Shm/ring.hpp"
+
+namespace MB::Shm {
+//! Layout of shared memory, data of both rings follows it
+struct Segment {
+  static constexpr uint32_t Magic = 0x4D425348; // "MBSH"
+
+  uint32_t magic;
+  uint32_t capacity;
+  //! Pid of attached client, 0 when none. Client that died without
+  //! detaching is replaced by the next one.
+  std::atomic<int32_t> owner{0};
+  //! Bumped by every client that attaches, frames are tagged with it
+  std::atomic<uint32_t> generation{0};
+
+  RingHeader requests;
+  RingHeader responses;
+
+  static constexpr std::size_t dataOffset() noexcept {
+    return (sizeof(Segment) + 63) & ~std::size_t(63);
+  }
+
+  static constexpr std::size_t sizeFor(std::size_t capacity) noexcept {
+    return dataOffset() + 2 * capacity;
+  }
+
+  Ring requestRing() noexcept {
+    return Ring(&requests, reinterpret_cast<uint8_t *>(this) + dataOffset(),
+                capacity);
+  }
+
+  Ring responseRing() noexcept {
+    return Ring(&responses,
+                reinterpret_cast<uint8_t *>(this) + dataOffset() + capacity,
+                capacity);
+  }
+};
+
+/**
+ * @brief Maps existing segment.
+ * @return Segment and size of the mapping.
+ * @throws std::runtime_error - When segment does not exist or is not valid.
+ */
+std::pair<Segment *, std::size_t> mapSegment(const std::string &name);
+} // namespace MB::Shm
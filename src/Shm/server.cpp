@@ -0,0 +1,76 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include <cerrno>
+#include <chrono>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Shm/server.hpp"
+#include "segment.hpp"
+
+using namespace MB::Shm;
+
+Server::Server(const std::string &name, std::size_t capacity) : _name(name) {
+  std::size_t ringSize = 1024;
+  while (ringSize < capacity)
+    ringSize <<= 1;
+  _size = Segment::sizeFor(ringSize);
+
+  // Segment left by a server that has not been shut down cleanly
+  ::shm_unlink(name.c_str());
+  const int fd =
+      ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd == -1)
+    throw std::runtime_error("Cannot create shared memory " + name +
+                             ", errno = " + std::to_string(errno));
+
+  if (::ftruncate(fd, static_cast<off_t>(_size)) == -1) {
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    throw std::runtime_error("Cannot resize shared memory " + name);
+  }
+
+  void *memory =
+      ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (memory == MAP_FAILED) {
+    ::shm_unlink(name.c_str());
+    throw std::runtime_error("Cannot map shared memory " + name);
+  }
+
+  _segment = new (memory) Segment();
+  _segment->capacity = static_cast<uint32_t>(ringSize);
+  // Published last, clients check it before using the segment
+  std::atomic_ref<uint32_t>(_segment->magic)
+      .store(Segment::Magic, std::memory_order_release);
+}
+
+Server::~Server() {
+  if (_segment != nullptr) {
+    ::munmap(_segment, _size);
+    ::shm_unlink(_name.c_str());
+  }
+  _segment = nullptr;
+}
+
+Connection Server::awaitConnection(int timeout) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+  // Connecting is rare, so plain polling is enough
+  while (_segment->owner.load(std::memory_order_acquire) == 0) {
+    if (timeout >= 0 && std::chrono::steady_clock::now() >= deadline)
+      throw MB::ModbusException(MB::utils::Timeout);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  auto [segment, size] = mapSegment(_name);
+  return Connection(segment, size, false);
+}
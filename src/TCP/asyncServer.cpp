@@ -0,0 +1,382 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include <array>
+#include <cerrno>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "TCP/asyncServer.hpp"
+
+#ifdef _WIN32
+#include <Winsock2.h>
+#include <Ws2tcpip.h>
+#define poll(a, b, c)  WSAPoll((a), (b), (c))
+#else
+#define SOCKET int
+#include <fcntl.h>
+#include <libnet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+using namespace MB::TCP;
+
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+constexpr int SendFlags = 0;
+#endif
+
+#ifdef _WIN32
+// Without wakeup descriptor completions are picked up by polling
+constexpr int PollTimeout = 10;
+#else
+// Completions and stop() wake the loop, timeout is only a safety net
+constexpr int PollTimeout = 100;
+#endif
+
+void closeSocket(int fd) {
+#ifdef _WIN32
+  closesocket(fd);
+#else
+  ::close(fd);
+#endif
+}
+
+bool setNonBlocking(int fd) {
+#ifdef _WIN32
+  u_long mode = 1;
+  return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+  const int flags = ::fcntl(fd, F_GETFL, 0);
+  return flags != -1 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+#endif
+}
+
+// Bounds time spent on a single connection before completions are handled
+constexpr int MaxReceivesPerPoll = 16;
+
+// Server whose run() executes on this thread
+thread_local AsyncServer *loopServer = nullptr;
+
+bool wouldBlock() {
+#ifdef _WIN32
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+} // namespace
+
+AsyncServer::Completions::Completions(std::size_t capacity) : queue(capacity) {
+#if defined(__linux__)
+  readFd = writeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (readFd < 0)
+    throw std::runtime_error("Cannot create eventfd, errno = " +
+                             std::to_string(errno));
+#elif !defined(_WIN32)
+  int fds[2];
+  if (::pipe(fds) != 0)
+    throw std::runtime_error("Cannot create pipe, errno = " +
+                             std::to_string(errno));
+  readFd = fds[0];
+  writeFd = fds[1];
+  setNonBlocking(readFd);
+  setNonBlocking(writeFd);
+#endif
+}
+
+AsyncServer::Completions::~Completions() {
+#ifndef _WIN32
+  if (readFd >= 0)
+    ::close(readFd);
+  if (writeFd >= 0 && writeFd != readFd)
+    ::close(writeFd);
+#endif
+}
+
+void AsyncServer::Completions::push(Completion &&completion) {
+  while (!queue.tryPush(std::move(completion))) {
+    if (closed.load(std::memory_order_acquire))
+      return;
+    // Loop thread is behind, make sure it is awake and let it catch up
+    wake();
+    std::this_thread::yield();
+  }
+  wake();
+}
+
+void AsyncServer::Completions::wake() const noexcept {
+#ifndef _WIN32
+  if (writeFd < 0)
+    return;
+  // Full pipe or counter already means that loop will wake up
+  const uint64_t one = 1;
+  [[maybe_unused]] auto written =
+      ::write(writeFd, &one, writeFd == readFd ? sizeof(one) : 1);
+#endif
+}
+
+void AsyncServer::Responder::complete(std::optional<ModbusResponse> response,
+                                      std::optional<ModbusException> error) {
+  if (!_completions)
+    return;
+  // Moved out first, so only the first call completes
+  const auto completions = std::move(_completions);
+
+  Completion completion{_connection, _transactionId, std::move(response),
+                        std::move(error)};
+  // Only the loop thread drains the queue, so it must never wait for it
+  if (loopServer && loopServer->_completions == completions)
+    loopServer->respond(completion);
+  else
+    completions->push(std::move(completion));
+}
+
+AsyncServer::Responder &
+AsyncServer::Responder::operator=(Responder &&other) noexcept {
+  if (this != &other) {
+    ignore();
+    _completions = std::move(other._completions);
+    _connection = other._connection;
+    _transactionId = other._transactionId;
+  }
+  return *this;
+}
+
+AsyncServer::Responder::~Responder() { ignore(); }
+
+void AsyncServer::Responder::respond(const ModbusResponse &response) {
+  complete(response, std::nullopt);
+}
+
+void AsyncServer::Responder::respond(const ModbusException &exception) {
+  complete(std::nullopt, exception);
+}
+
+void AsyncServer::Responder::ignore() { complete(std::nullopt, std::nullopt); }
+
+AsyncServer::AsyncServer(int port, Handler handler,
+                         std::size_t completionCapacity)
+    : _server(port), _handler(std::move(handler)),
+      _completions(std::make_shared<Completions>(completionCapacity)) {
+  if (!_handler)
+    throw std::runtime_error("AsyncServer needs a request handler");
+  setNonBlocking(_server.nativeHandle());
+}
+
+AsyncServer::~AsyncServer() {
+  // Responders that outlive the server must not wait for the queue
+  _completions->closed.store(true, std::memory_order_release);
+  for (auto &[id, session] : _sessions)
+    closeSocket(session.fd);
+}
+
+void AsyncServer::stop() noexcept {
+  _stop = true;
+  _completions->wake();
+}
+
+void AsyncServer::accept() {
+  while (true) {
+    const auto fd = ::accept(_server.nativeHandle(), nullptr, nullptr);
+    if (fd < 0)
+      return;
+    if (!setNonBlocking((int)fd)) {
+      closeSocket((int)fd);
+      continue;
+    }
+    _sessions.emplace(_nextConnection++,
+                      Session{(int)fd, Protocol::TCPServer()});
+  }
+}
+
+bool AsyncServer::read(uint64_t id, Session &session) {
+  std::array<uint8_t, 4096> buffer;
+  // Rest of the input is read on next poll, after pending completions, or
+  // once the connection drains
+  for (int receives = 0;
+       receives < MaxReceivesPerPoll && !session.throttled(); receives++) {
+    const auto size =
+        ::recv((SOCKET)session.fd, (char *)buffer.data(), (int)buffer.size(), 0);
+    if (size == 0)
+      return false;
+    if (size < 0)
+      return wouldBlock();
+
+    session.protocol.receive(
+        std::span<const uint8_t>(buffer.data(), (std::size_t)size));
+    if (!dispatch(id, session))
+      return false;
+  }
+  return true;
+}
+
+bool AsyncServer::dispatch(uint64_t id, Session &session) {
+  // Requests left in the protocol are dispatched once the connection drains
+  while (!session.throttled()) {
+    auto incoming = session.protocol.nextEvent();
+    if (!incoming)
+      return true;
+
+    if (!incoming->request) {
+      if (incoming->error->getErrorCode() == utils::ProtocolError)
+        return false;
+      session.protocol.respond(incoming->transactionId, *incoming->error);
+      continue;
+    }
+
+    session.inFlight++;
+    _dispatching = Dispatching{id, incoming->transactionId};
+    std::optional<ModbusException> error;
+    try {
+      _handler(*incoming->request,
+               Responder(_completions, id, incoming->transactionId));
+    } catch (const ModbusException &ex) {
+      error = ex;
+    } catch (const std::exception &) {
+      error = ModbusException(utils::SlaveDeviceFailure,
+                              incoming->request->slaveID(),
+                              incoming->request->functionCode());
+    }
+
+    // Responder is gone by now. Error is sent only if it released the
+    // request without answering, a responder moved elsewhere answers later.
+    const auto dispatching = *_dispatching;
+    _dispatching.reset();
+    if (error && dispatching.ignored && !dispatching.answered)
+      session.protocol.respond(incoming->transactionId, *error);
+  }
+  return true;
+}
+
+bool AsyncServer::write(Session &session) {
+  while (true) {
+    const auto output = session.protocol.pendingOutput();
+    if (output.empty())
+      return true;
+
+    const auto sent = ::send((SOCKET)session.fd, (const char *)output.data(),
+                             (int)output.size(), SendFlags);
+    if (sent < 0)
+      return wouldBlock();
+    session.protocol.consumeOutput((std::size_t)sent);
+  }
+}
+
+void AsyncServer::complete() {
+#ifndef _WIN32
+  // Reset wakeup before draining, so no completion is left unnoticed
+  std::array<uint8_t, 64> drain;
+  while (::read(_completions->readFd, drain.data(),
+                _completions->readFd == _completions->writeFd ? sizeof(uint64_t)
+                                                              : drain.size()) >
+         0) {
+  }
+#endif
+
+  while (auto completion = _completions->queue.tryPop())
+    respond(*completion);
+}
+
+void AsyncServer::respond(const Completion &completion) {
+  // Connection may have been closed while request was handled
+  auto session = _sessions.find(completion.connection);
+  if (session == _sessions.end())
+    return;
+
+  session->second.inFlight--;
+  const bool answered = completion.response || completion.error;
+  if (_dispatching && _dispatching->connection == completion.connection &&
+      _dispatching->transactionId == completion.transactionId) {
+    if (answered)
+      _dispatching->answered = true;
+    else
+      _dispatching->ignored = true;
+  }
+
+  if (completion.response)
+    session->second.protocol.respond(completion.transactionId,
+                                     *completion.response);
+  else if (completion.error)
+    session->second.protocol.respond(completion.transactionId,
+                                     *completion.error);
+}
+
+void AsyncServer::run() {
+  std::vector<pollfd> fds;
+  std::vector<uint64_t> ids;
+
+  struct LoopThread {
+    explicit LoopThread(AsyncServer *server) { loopServer = server; }
+    ~LoopThread() { loopServer = nullptr; }
+  } loopThread(this);
+
+  while (!_stop.load(std::memory_order_relaxed)) {
+    fds.clear();
+    ids.clear();
+    fds.push_back({(SOCKET)_server.nativeHandle(), POLLIN, 0});
+#ifndef _WIN32
+    fds.push_back({_completions->readFd, POLLIN, 0});
+#endif
+    const auto sessionsBegin = fds.size();
+    for (auto &[id, session] : _sessions) {
+      // Peer that does not read its responses is not read from either
+      short events = session.throttled() ? 0 : POLLIN;
+      if (!session.protocol.pendingOutput().empty())
+        events |= POLLOUT;
+      fds.push_back({(SOCKET)session.fd, events, 0});
+      ids.push_back(id);
+    }
+
+    if (::poll(fds.data(), (unsigned long)fds.size(), PollTimeout) < 0) {
+      if (wouldBlock())
+        continue;
+      throw std::runtime_error("Cannot poll, errno = " + std::to_string(errno));
+    }
+
+    if (fds[0].revents & POLLIN)
+      accept();
+
+    for (std::size_t i = 0; i < ids.size(); i++) {
+      const auto revents = fds[sessionsBegin + i].revents;
+      if (revents == 0)
+        continue;
+
+      auto &session = _sessions.at(ids[i]);
+      bool open = !(revents & (POLLERR | POLLNVAL));
+      // Hang up is reported even without POLLIN, responses of a throttled
+      // session can not be delivered anymore then
+      if (open && (revents & POLLHUP) && session.throttled())
+        open = false;
+      else if (open && (revents & (POLLIN | POLLHUP)))
+        open = read(ids[i], session);
+      if (!open) {
+        closeSocket(session.fd);
+        _sessions.erase(ids[i]);
+      }
+    }
+
+    // Handlers may complete synchronously, so completions are always checked
+    complete();
+
+    for (auto it = _sessions.begin(); it != _sessions.end();) {
+      if (dispatch(it->first, it->second) && write(it->second)) {
+        ++it;
+      } else {
+        closeSocket(it->second.fd);
+        it = _sessions.erase(it);
+      }
+    }
+  }
+}
@@ -5,14 +5,17 @@
 #include <memory>
 #include <type_traits>
 #include <cerrno>
+#include <cstring>
 #include "TCP/connection.hpp"
+#include "modbusProtocol.hpp"
+#include "modbusStats.hpp"
 
 #ifdef _WIN32
 #include <Winsock2.h>
 #include <Ws2tcpip.h>
 #define poll(a, b, c)  WSAPoll((a), (b), (c))
 #else
-#define SOCKET (int)
+#define SOCKET int
 #include <libnet.h>
 #include <netinet/in.h>
 #include <poll.h>
@@ -21,6 +24,78 @@
 
 using namespace MB::TCP;
 
+namespace {
+using MB::Protocol::MBAPSize;
+// MBAP header with the largest length field accepted
+constexpr std::size_t MaxFrameSize = MBAPSize + MB::Protocol::MaxMBAPLength;
+// Fits many pipelined frames, so a single recv picks them all up
+constexpr std::size_t InputBufferSize = 4096;
+
+template <typename Buffer>
+void writeMBAP(Buffer &rawReq, uint16_t messageID,
+               std::span<const uint8_t> dat) {
+  MODBUS_STATS_SCOPE(MB::Stats::Framing);
+  rawReq.reserve(6 + dat.size());
+
+  rawReq.push_back(reinterpret_cast<const uint8_t *>(&messageID)[1]);
+  rawReq.push_back(reinterpret_cast<const uint8_t *>(&messageID)[0]);
+  rawReq.push_back(0x00);
+  rawReq.push_back(0x00);
+
+  uint32_t size = (uint32_t)dat.size();
+  rawReq.push_back((uint8_t)reinterpret_cast<uint16_t *>(&size)[1]);
+  rawReq.push_back((uint8_t)reinterpret_cast<uint16_t *>(&size)[0]);
+
+  rawReq.insert(rawReq.end(), dat.begin(), dat.end());
+}
+
+std::vector<uint8_t> withMBAP(uint16_t messageID,
+                              const std::vector<uint8_t> &dat) {
+  std::vector<uint8_t> rawReq;
+  writeMBAP(rawReq, messageID, dat);
+  return rawReq;
+}
+
+std::pmr::vector<uint8_t> withMBAP(uint16_t messageID,
+                                   const std::pmr::vector<uint8_t> &dat,
+                                   std::pmr::memory_resource *resource) {
+  std::pmr::vector<uint8_t> rawReq(resource);
+  writeMBAP(rawReq, messageID, dat);
+  return rawReq;
+}
+
+#ifdef MSG_NOSIGNAL
+// Held responses are flushed on close, peer may be gone by then
+constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+constexpr int SendFlags = 0;
+#endif
+
+void sendRaw(int sockfd, std::span<const uint8_t> raw) {
+  MODBUS_STATS_SCOPE(MB::Stats::Send);
+  std::size_t offset = 0;
+  while (offset < raw.size()) {
+    const auto sent = ::send(sockfd, (const char *)raw.data() + offset,
+                             (int)(raw.size() - offset), SendFlags);
+    if (sent <= 0)
+      break;
+    offset += static_cast<std::size_t>(sent);
+  }
+}
+
+// Passes exceptions thrown by body to recorder before rethrowing them
+template <typename Body>
+auto recorded(MB::FlightRecorder *recorder, Body &&body) {
+  try {
+    return body();
+  } catch (const MB::ModbusException &ex) {
+    if (recorder)
+      recorder->failure(ex);
+    throw;
+  }
+}
+} // namespace
+
 Connection::Connection(const int sockfd) noexcept {
   _sockfd = sockfd;
   _messageID = 0;
@@ -31,17 +106,28 @@ Connection& Connection::operator=(Connection&& other) noexcept {
       return *this;
 
   if (_sockfd != -1 && _sockfd != other._sockfd) {
+      flush();
       closeSockfd();
   }
 
   _sockfd = other._sockfd;
   _messageID = other._messageID;
+  _timeout = other._timeout;
+  _recorder = std::move(other._recorder);
+  _input = std::move(other._input);
+  _inputBegin = other._inputBegin;
+  _inputEnd = other._inputEnd;
+  _output = std::move(other._output);
   other._sockfd = -1;
+  other._inputBegin = other._inputEnd = 0;
 
   return *this;
 }
 
 Connection::~Connection() {
+  // Responses held back for pipelined requests still belong to the peer
+  if (_sockfd != -1)
+    flush();
   closeSockfd();
 }
 
@@ -56,82 +142,77 @@ void Connection::closeSockfd(void) {
   _sockfd = -1;
 }
 
-std::vector<uint8_t> Connection::sendRequest(const MB::ModbusRequest &req) {
-  std::vector<uint8_t> rawReq;
-  rawReq.reserve(6);
-
-  rawReq.push_back(reinterpret_cast<const uint8_t *>(&_messageID)[1]);
-  rawReq.push_back(reinterpret_cast<const uint8_t *>(&_messageID)[0]);
-  rawReq.push_back(0x00);
-  rawReq.push_back(0x00);
-
-  std::vector<uint8_t> dat = req.toRaw();
+void Connection::queue(std::span<const uint8_t> frame) {
+  if (_recorder)
+    _recorder->record(FlightRecorder::Tx, frame);
+  _output.insert(_output.end(), frame.begin(), frame.end());
+}
 
-  uint32_t size = (uint32_t)dat.size();
-  rawReq.push_back((uint8_t)reinterpret_cast<uint16_t *>(&size)[1]);
-  rawReq.push_back((uint8_t)reinterpret_cast<uint16_t *>(&size)[0]);
+void Connection::flush() {
+  if (_output.empty())
+    return;
+  sendRaw(_sockfd, _output);
+  _output.clear();
+}
 
-  rawReq.insert(rawReq.end(), dat.begin(), dat.end());
+void Connection::queueResponse(std::span<const uint8_t> frame) {
+  queue(frame);
+  // Responses to pipelined requests are sent together, after the last one
+  if (!hasBufferedRequest())
+    flush();
+}
 
-  ::send(_sockfd, (const char*)rawReq.data(), (int)rawReq.size(), 0);
+bool Connection::hasBufferedRequest() const noexcept {
+  const auto available = _inputEnd - _inputBegin;
+  return available >= MBAPSize &&
+         available >= MBAPSize + utils::bigEndianConv(&_input[_inputBegin + 4]);
+}
 
+std::vector<uint8_t> Connection::sendRequest(const MB::ModbusRequest &req) {
+  auto rawReq = withMBAP(_messageID, req.toRaw());
+  queue(rawReq);
+  flush();
   return rawReq;
 }
 
 std::vector<uint8_t> Connection::sendResponse(const MB::ModbusResponse &res) {
-  std::vector<uint8_t> rawReq;
-  rawReq.reserve(6);
-
-  rawReq.push_back(reinterpret_cast<const uint8_t *>(&_messageID)[1]);
-  rawReq.push_back(reinterpret_cast<const uint8_t *>(&_messageID)[0]);
-  rawReq.push_back(0x00);
-  rawReq.push_back(0x00);
-
-  std::vector<uint8_t> dat = res.toRaw();
-
-  uint32_t size = (uint32_t)dat.size();
-  rawReq.push_back((uint8_t)reinterpret_cast<uint16_t *>(&size)[1]);
-  rawReq.push_back((uint8_t)reinterpret_cast<uint16_t *>(&size)[0]);
-
-  rawReq.insert(rawReq.end(), dat.begin(), dat.end());
-
-  ::send(_sockfd, (const char*)rawReq.data(), (int)rawReq.size(), 0);
-
+  auto rawReq = withMBAP(_messageID, res.toRaw());
+  queueResponse(rawReq);
   return rawReq;
 }
 
 std::vector<uint8_t> Connection::sendException(const MB::ModbusException &ex) {
-  std::vector<uint8_t> rawReq;
-  rawReq.reserve(6);
-
-  rawReq.push_back(reinterpret_cast<const uint8_t *>(&_messageID)[1]);
-  rawReq.push_back(reinterpret_cast<const uint8_t *>(&_messageID)[0]);
-  rawReq.push_back(0x00);
-  rawReq.push_back(0x00);
-
-  std::vector<uint8_t> dat = ex.toRaw();
-
-  uint32_t size = (uint32_t)dat.size();
-  rawReq.push_back((uint8_t)reinterpret_cast<uint16_t *>(&size)[1]);
-  rawReq.push_back((uint8_t)reinterpret_cast<uint16_t *>(&size)[0]);
-
-  rawReq.insert(rawReq.end(), dat.begin(), dat.end());
+  auto rawReq = withMBAP(_messageID, ex.toRaw());
+  queueResponse(rawReq);
+  return rawReq;
+}
 
-  ::send(_sockfd, (const char*)rawReq.data(), (int)rawReq.size(), 0);
+std::pmr::vector<uint8_t>
+Connection::sendRequest(const MB::ModbusRequest &req,
+                        std::pmr::memory_resource *resource) {
+  auto rawReq = withMBAP(_messageID, req.toRaw(resource), resource);
+  queue(rawReq);
+  flush();
+  return rawReq;
+}
 
+std::pmr::vector<uint8_t>
+Connection::sendResponse(const MB::ModbusResponse &res,
+                         std::pmr::memory_resource *resource) {
+  auto rawReq = withMBAP(_messageID, res.toRaw(resource), resource);
+  queueResponse(rawReq);
   return rawReq;
 }
 
-std::vector<uint8_t> Connection::awaitRawMessage() {
+std::size_t Connection::receive(uint8_t *buffer, std::size_t capacity,
+                                int timeout, utils::MBErrorCode timeoutError) {
   pollfd _pfd = {.fd = (SOCKET)_sockfd, .events = POLLIN, .revents = POLLIN};
-  if (::poll(&_pfd, 1,
-             60 * 1000 /* 1 minute means the connection has died */) <= 0) {
-    throw MB::ModbusException(MB::utils::ConnectionClosed);
+  if (::poll(&_pfd, 1, timeout) <= 0) {
+    throw MB::ModbusException(timeoutError);
   }
 
-  std::vector<uint8_t> r(1024);
-
-  auto size = ::recv(_sockfd, (char*)r.data(), (int)r.size(), 0);
+  MODBUS_STATS_SCOPE(MB::Stats::Receive);
+  auto size = ::recv(_sockfd, (char*)buffer, (int)capacity, 0);
 
   if (size == -1)
     throw MB::ModbusException(MB::utils::ProtocolError);
@@ -139,70 +220,123 @@ std::vector<uint8_t> Connection::awaitRawMessage() {
     throw MB::ModbusException(MB::utils::ConnectionClosed);
   }
 
-  r.resize(size); // Set vector to proper shape
-  r.shrink_to_fit();
-
-  return r;
+  if (_recorder)
+    _recorder->record(FlightRecorder::Rx,
+                      std::span<const uint8_t>(buffer, size));
+  return static_cast<std::size_t>(size);
 }
 
-MB::ModbusRequest Connection::awaitRequest() {
-  pollfd _pfd = {.fd = (SOCKET)_sockfd, .events = POLLIN, .revents = POLLIN};
-  if (::poll(&_pfd, 1,
-             60 * 1000 /* 1 minute means the connection has died */) <= 0) {
-    throw MB::ModbusException(MB::utils::Timeout);
+std::span<const uint8_t> Connection::awaitFrame(int timeout,
+                                                utils::MBErrorCode timeoutError) {
+  while (true) {
+    const auto available = _inputEnd - _inputBegin;
+    if (available >= MBAPSize) {
+      const std::size_t size =
+          MBAPSize + utils::bigEndianConv(&_input[_inputBegin + 4]);
+      if (size < MBAPSize + 2 || size > MaxFrameSize ||
+          utils::bigEndianConv(&_input[_inputBegin + 2]) != 0) {
+        // Framing is lost, nothing buffered can be trusted
+        _inputBegin = _inputEnd = 0;
+        throw MB::ModbusException(MB::utils::InvalidByteOrder);
+      }
+      if (available >= size) {
+        auto frame = std::span<const uint8_t>(&_input[_inputBegin], size);
+        _inputBegin += size;
+        return frame;
+      }
+    }
+
+    // Responses to pipelined requests go out before waiting for more data
+    flush();
+
+    if (_input.empty())
+      _input.resize(InputBufferSize);
+    if (_inputBegin == _inputEnd) {
+      _inputBegin = _inputEnd = 0;
+    } else if (_input.size() - _inputEnd < MaxFrameSize) {
+      std::memmove(_input.data(), &_input[_inputBegin], available);
+      _inputBegin = 0;
+      _inputEnd = available;
+    }
+
+    _inputEnd += receive(&_input[_inputEnd], _input.size() - _inputEnd,
+                         timeout, timeoutError);
   }
+}
 
-  std::vector<uint8_t> r(1024);
-
-  auto size = ::recv(_sockfd, (char*)r.data(), (int)r.size(), 0);
-
-  if (size == -1)
-    throw MB::ModbusException(MB::utils::ProtocolError);
-  else if (size == 0) {
-    throw MB::ModbusException(MB::utils::ConnectionClosed);
-  }
+std::vector<uint8_t> Connection::awaitRawMessage() {
+  return recorded(_recorder.get(), [&] {
+    flush();
+    // Data read ahead by awaitRequest() or awaitResponse()
+    if (_inputBegin != _inputEnd) {
+      std::vector<uint8_t> r(&_input[_inputBegin], &_input[_inputEnd]);
+      _inputBegin = _inputEnd = 0;
+      return r;
+    }
+
+    std::vector<uint8_t> r(1024);
+
+    auto size = receive(r.data(), r.size(),
+                        60 * 1000 /* 1 minute means the connection has died */,
+                        MB::utils::ConnectionClosed);
+
+    r.resize(size); // Set vector to proper shape
+    r.shrink_to_fit();
+
+    return r;
+  });
+}
 
-  r.resize(size); // Set vector to proper shape
-  r.shrink_to_fit();
+std::pmr::vector<uint8_t>
+Connection::awaitRawMessage(std::pmr::memory_resource *resource) {
+  return recorded(_recorder.get(), [&] {
+    flush();
+    // Data read ahead by awaitRequest() or awaitResponse()
+    if (_inputBegin != _inputEnd) {
+      std::pmr::vector<uint8_t> r(&_input[_inputBegin], &_input[_inputEnd],
+                                  resource);
+      _inputBegin = _inputEnd = 0;
+      return r;
+    }
 
-  const auto resultMessageID = *reinterpret_cast<uint16_t *>(&r[0]);
+    std::pmr::vector<uint8_t> r(1024, resource);
 
-  _messageID = resultMessageID;
+    auto size = receive(r.data(), r.size(),
+                        60 * 1000 /* 1 minute means the connection has died */,
+                        MB::utils::ConnectionClosed);
 
-  r.erase(r.begin(), r.begin() + 6);
+    r.resize(size); // No shrink_to_fit, arenas do not reuse freed memory anyway
 
-  return MB::ModbusRequest::fromRaw(r);
+    return r;
+  });
 }
 
-MB::ModbusResponse Connection::awaitResponse() {
-  pollfd _pfd = {.fd = (SOCKET)_sockfd, .events = POLLIN, .revents = POLLIN};
-  if (::poll(&_pfd, 1, _timeout) <= 0) {
-    throw MB::ModbusException(MB::utils::Timeout);
-  }
+MB::ModbusRequest Connection::awaitRequest(std::pmr::memory_resource *resource) {
+  return recorded(_recorder.get(), [&] {
+    auto frame = awaitFrame(60 * 1000 /* 1 minute means the connection has died */,
+                            MB::utils::Timeout);
 
-  std::vector<uint8_t> r(1024);
-  auto size = ::recv(_sockfd, (char*)r.data(), (int)r.size(), 0);
+    _messageID = utils::bigEndianConv(frame.data());
 
-  if (size == -1)
-    throw MB::ModbusException(MB::utils::ProtocolError);
-  else if (size == 0) {
-    throw MB::ModbusException(MB::utils::ConnectionClosed);
-  }
-
-  r.resize(size); // Set vector to proper shape
-  r.shrink_to_fit();
+    return MB::ModbusRequest::fromRaw(frame.subspan(MBAPSize), resource);
+  });
+}
 
-  const auto resultMessageID = *reinterpret_cast<uint16_t *>(&r[0]);
+MB::ModbusResponse
+Connection::awaitResponse(std::pmr::memory_resource *resource) {
+  return recorded(_recorder.get(), [&] {
+    auto frame = awaitFrame(_timeout, MB::utils::Timeout);
 
-  if (resultMessageID != _messageID)
-    throw MB::ModbusException(MB::utils::InvalidMessageID);
+    if (utils::bigEndianConv(frame.data()) != _messageID)
+      throw MB::ModbusException(MB::utils::InvalidMessageID);
 
-  r.erase(r.begin(), r.begin() + 6);
+    auto pdu = frame.subspan(MBAPSize);
 
-  if (MB::ModbusException::exist(r))
-    throw MB::ModbusException(r);
+    if (MB::ModbusException::exist(pdu))
+      throw MB::ModbusException(pdu);
 
-  return MB::ModbusResponse::fromRaw(r);
+    return MB::ModbusResponse::fromRaw(pdu, resource);
+  });
 }
 
 Connection::Connection(Connection &&moved) noexcept {
@@ -212,7 +346,14 @@ Connection::Connection(Connection &&moved) noexcept {
 
   _sockfd = moved._sockfd;
   _messageID = moved._messageID;
+  _timeout = moved._timeout;
+  _recorder = std::move(moved._recorder);
+  _input = std::move(moved._input);
+  _inputBegin = moved._inputBegin;
+  _inputEnd = moved._inputEnd;
+  _output = std::move(moved._output);
   moved._sockfd = -1;
+  moved._inputBegin = moved._inputEnd = 0;
 }
 
 Connection Connection::with(const std::string &addr, int port) {
@@ -0,0 +1,404 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include <algorithm>
+#include <cerrno>
+#include <list>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "TCP/discovery.hpp"
+#include "modbusProtocol.hpp"
+
+#ifdef _WIN32
+#include <Winsock2.h>
+#include <Ws2tcpip.h>
+#define poll(a, b, c)  WSAPoll((a), (b), (c))
+#else
+#define SOCKET int
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <libnet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace MB::TCP;
+using MB::Protocol::Clock;
+
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+constexpr int SendFlags = 0;
+#endif
+
+void closeSocket(int fd) {
+#ifdef _WIN32
+  closesocket(fd);
+#else
+  ::close(fd);
+#endif
+}
+
+bool setNonBlocking(int fd) {
+#ifdef _WIN32
+  u_long mode = 1;
+  return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+  const int flags = ::fcntl(fd, F_GETFL, 0);
+  return flags != -1 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+#endif
+}
+
+bool connectInProgress() {
+#ifdef _WIN32
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EINPROGRESS;
+#endif
+}
+
+in_addr parseAddress(const std::string &address) {
+  in_addr result = {};
+  if (::inet_pton(AF_INET, address.c_str(), &result) != 1)
+    throw std::runtime_error("Invalid IPv4 address: " + address);
+  return result;
+}
+
+uint16_t readLimit(MB::utils::MBFunctionCode functionCode) {
+  switch (functionCode) {
+  case MB::utils::ReadDiscreteOutputCoils:
+  case MB::utils::ReadDiscreteInputContacts:
+    return 2000;
+  default:
+    return 125;
+  }
+}
+
+// Exceptions that gateways send in place of missing devices
+bool deviceMissing(MB::utils::MBErrorCode errorCode) {
+  return !MB::utils::isStandardErrorCode(errorCode) ||
+         errorCode == MB::utils::GatewayPathUnavailable ||
+         errorCode == MB::utils::GatewayTargetDeviceFailedToRespond;
+}
+
+struct Unit {
+  uint8_t id = 0;
+  bool done = false;
+  bool bisecting = false;
+  // Counts known to succeed and to fail
+  uint16_t good = 0;
+  uint16_t bad = 0;
+  Clock::time_point sent;
+  std::optional<DiscoveredDevice> device;
+};
+
+struct Session {
+  std::size_t host;
+  int fd;
+  bool connected = false;
+  Clock::time_point connectDeadline;
+  MB::Protocol::TCPClient client;
+  std::vector<Unit> units;
+  std::size_t nextUnit = 0;
+  std::size_t active = 0;
+  std::unordered_map<uint16_t, std::size_t> transactions;
+  bool closed = false;
+};
+} // namespace
+
+Discovery::Discovery(DiscoveryOptions options) : _options(std::move(options)) {
+  if (_options.maxConnections == 0 || _options.pipelineDepth == 0)
+    throw std::runtime_error("Discovery needs at least one connection and "
+                             "one probe in flight");
+}
+
+std::vector<std::string> Discovery::hostsOf(const std::string &network) {
+  const auto slash = network.find('/');
+  const auto base = parseAddress(network.substr(0, slash));
+  int prefix = 32;
+  if (slash != std::string::npos) {
+    try {
+      std::size_t parsed = 0;
+      prefix = std::stoi(network.substr(slash + 1), &parsed);
+      if (parsed != network.size() - slash - 1)
+        prefix = -1;
+    } catch (const std::exception &) {
+      prefix = -1;
+    }
+    if (prefix < 0 || prefix > 32)
+      throw std::runtime_error("Invalid network prefix: " + network);
+  }
+
+  const uint32_t mask =
+      prefix == 0 ? 0 : ~uint32_t(0) << (32 - static_cast<uint32_t>(prefix));
+  const uint32_t first = ntohl(base.s_addr) & mask;
+  const uint32_t last = first | ~mask;
+
+  std::vector<std::string> hosts;
+  for (uint64_t host = first; host <= last; host++) {
+    if (prefix < 31 && (host == first || host == last))
+      continue;
+
+    in_addr address = {};
+    address.s_addr = htonl(static_cast<uint32_t>(host));
+    char text[INET_ADDRSTRLEN];
+    ::inet_ntop(AF_INET, &address, text, sizeof(text));
+    hosts.emplace_back(text);
+  }
+  return hosts;
+}
+
+std::vector<DiscoveredDevice>
+Discovery::scan(const std::vector<std::string> &hosts) {
+#ifdef _WIN32
+  WSADATA wsaData;
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+    throw std::runtime_error("WSAStartup failure, errno = " +
+                             std::to_string(errno));
+  }
+#endif
+
+  std::vector<sockaddr_in> addresses;
+  addresses.reserve(hosts.size());
+  for (const auto &host : hosts) {
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(_options.port));
+    address.sin_addr = parseAddress(host);
+    addresses.push_back(address);
+  }
+
+  const auto limit = readLimit(_options.probeFunction);
+  std::vector<std::vector<DiscoveredDevice>> found(hosts.size());
+  std::list<Session> sessions;
+  std::size_t nextHost = 0;
+
+  const auto probe = [this](Session &session, std::size_t unitIndex,
+                            uint16_t count, Clock::time_point now) {
+    auto &unit = session.units[unitIndex];
+    unit.sent = now;
+    const auto id = session.client.send(
+        MB::ModbusRequest(unit.id, _options.probeFunction,
+                          _options.probeAddress, count),
+        now, _options.requestTimeout);
+    session.transactions[id] = unitIndex;
+  };
+
+  const auto finishUnit = [&](Session &session, Unit &unit,
+                              Clock::time_point now) {
+    unit.done = true;
+    session.active--;
+    if (unit.device)
+      found[session.host].push_back(std::move(*unit.device));
+
+    while (session.active < _options.pipelineDepth &&
+           session.nextUnit < session.units.size()) {
+      session.active++;
+      probe(session, session.nextUnit++, 1, now);
+    }
+  };
+
+  const auto complete = [&](Session &session,
+                            const MB::Protocol::Completion &completion,
+                            Clock::time_point now) {
+    auto transaction = session.transactions.find(completion.transactionId);
+    if (transaction == session.transactions.end())
+      return;
+    auto &unit = session.units[transaction->second];
+    const auto unitIndex = transaction->second;
+    session.transactions.erase(transaction);
+
+    if (!unit.bisecting) {
+      if (completion.error && deviceMissing(completion.error->getErrorCode())) {
+        finishUnit(session, unit, now);
+        return;
+      }
+
+      unit.device = DiscoveredDevice{
+          hosts[session.host], unit.id,
+          std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                                unit.sent),
+          0, std::nullopt};
+      if (completion.error) {
+        unit.device->error = completion.error->getErrorCode();
+        finishUnit(session, unit, now);
+        return;
+      }
+      if (!_options.findMaxRegisters) {
+        finishUnit(session, unit, now);
+        return;
+      }
+      unit.bisecting = true;
+      unit.good = 1;
+      unit.bad = static_cast<uint16_t>(limit + 1);
+    } else {
+      const auto count = static_cast<uint16_t>((unit.good + unit.bad) / 2);
+      if (completion.response)
+        unit.good = count;
+      else
+        unit.bad = count;
+    }
+
+    if (unit.bad - unit.good <= 1) {
+      unit.device->maxRegisters = unit.good;
+      finishUnit(session, unit, now);
+    } else {
+      probe(session, unitIndex,
+            static_cast<uint16_t>((unit.good + unit.bad) / 2), now);
+    }
+  };
+
+  const auto closeSession = [&](Session &session) {
+    // Units in flight got no answer, responsive ones are still reported
+    for (auto &unit : session.units) {
+      if (unit.done)
+        continue;
+      if (unit.device && unit.bisecting)
+        unit.device->maxRegisters = unit.good;
+      unit.done = true;
+      if (unit.device)
+        found[session.host].push_back(std::move(*unit.device));
+    }
+    closeSocket(session.fd);
+    session.closed = true;
+  };
+
+  const auto start = [&](Session &session, Clock::time_point now) {
+    session.connected = true;
+    for (auto unitId : _options.unitIds)
+      session.units.emplace_back().id = unitId;
+    while (session.active < _options.pipelineDepth &&
+           session.nextUnit < session.units.size()) {
+      session.active++;
+      probe(session, session.nextUnit++, 1, now);
+    }
+  };
+
+  std::vector<pollfd> fds;
+  std::vector<uint8_t> buffer(4096);
+  while (nextHost < hosts.size() || !sessions.empty()) {
+    auto now = Clock::now();
+
+    while (sessions.size() < _options.maxConnections &&
+           nextHost < hosts.size()) {
+      const auto host = nextHost++;
+      auto fd = (int)::socket(AF_INET, SOCK_STREAM, 0);
+      if (fd == -1)
+        throw std::runtime_error("Cannot open socket, errno = " +
+                                 std::to_string(errno));
+      if (!setNonBlocking(fd)) {
+        closeSocket(fd);
+        throw std::runtime_error("Cannot make socket non blocking, errno = " +
+                                 std::to_string(errno));
+      }
+
+      const auto result =
+          ::connect(fd, reinterpret_cast<const sockaddr *>(&addresses[host]),
+                    sizeof(sockaddr_in));
+      if (result < 0 && !connectInProgress()) {
+        closeSocket(fd);
+        continue;
+      }
+
+      auto &session = sessions.emplace_back();
+      session.host = host;
+      session.fd = fd;
+      session.connectDeadline = now + _options.connectTimeout;
+      if (result == 0)
+        start(session, now);
+    }
+
+    fds.clear();
+    std::optional<Clock::time_point> deadline;
+    for (auto &session : sessions) {
+      short events = POLLOUT;
+      std::optional<Clock::time_point> sessionDeadline =
+          session.connectDeadline;
+      if (session.connected) {
+        events = POLLIN;
+        if (!session.client.pendingOutput().empty())
+          events |= POLLOUT;
+        sessionDeadline = session.client.nextDeadline();
+      }
+      fds.push_back(pollfd{(SOCKET)session.fd, events, 0});
+      if (sessionDeadline && (!deadline || *sessionDeadline < *deadline))
+        deadline = sessionDeadline;
+    }
+    if (fds.empty())
+      continue;
+
+    int timeout = -1;
+    if (deadline) {
+      const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+          *deadline - Clock::now());
+      timeout = static_cast<int>(std::max<std::chrono::milliseconds::rep>(
+          remaining.count(), 0));
+    }
+    if (::poll(fds.data(), (unsigned long)fds.size(), timeout) < 0 &&
+        errno != EINTR)
+      throw std::runtime_error("Poll failed, errno = " + std::to_string(errno));
+
+    now = Clock::now();
+    std::size_t index = 0;
+    for (auto &session : sessions) {
+      const auto revents = fds[index++].revents;
+
+      if (!session.connected) {
+        if (revents != 0) {
+          int error = 0;
+          socklen_t length = sizeof(error);
+          ::getsockopt(session.fd, SOL_SOCKET, SO_ERROR, (char *)&error,
+                       &length);
+          if (error == 0)
+            start(session, now);
+          else
+            closeSession(session);
+        } else if (now >= session.connectDeadline) {
+          closeSession(session);
+        }
+        continue;
+      }
+
+      if (revents & POLLOUT) {
+        const auto output = session.client.pendingOutput();
+        const auto sent = ::send(session.fd, (const char *)output.data(),
+                                 (int)output.size(), SendFlags);
+        if (sent > 0)
+          session.client.consumeOutput(static_cast<std::size_t>(sent));
+      }
+
+      if (revents & (POLLIN | POLLERR | POLLHUP)) {
+        const auto size =
+            ::recv(session.fd, (char *)buffer.data(), (int)buffer.size(), 0);
+        if (size <= 0) {
+          closeSession(session);
+          continue;
+        }
+        session.client.receive(
+            std::span<const uint8_t>(buffer.data(), (std::size_t)size));
+      }
+
+      session.client.onTimer(now);
+      while (auto completion = session.client.nextEvent())
+        complete(session, *completion, now);
+
+      if (session.active == 0)
+        closeSession(session);
+    }
+
+    sessions.remove_if([](const Session &session) { return session.closed; });
+  }
+
+  std::vector<DiscoveredDevice> result;
+  for (auto &devices : found) {
+    std::sort(devices.begin(), devices.end(),
+              [](const auto &a, const auto &b) { return a.unitId < b.unitId; });
+    std::move(devices.begin(), devices.end(), std::back_inserter(result));
+  }
+  return result;
+}
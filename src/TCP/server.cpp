@@ -19,7 +19,6 @@ Server::Server(int port) {
   setsockopt(_serverfd, SOL_SOCKET, SO_REUSEADDR, (char*)&reuseaddr, sizeof(reuseaddr));
 #ifdef SO_REUSEPORT
   setsockopt(_serverfd, SOL_SOCKET, SO_REUSEPORT, (const char*)&reuseaddr, sizeof(reuseaddr));
-  (const char*)&reuseaddr
 #endif
 
   _server = {};
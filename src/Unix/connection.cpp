@@ -0,0 +1,261 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Unix/connection.hpp"
+#include "modbusProtocol.hpp"
+
+using namespace MB::Unix;
+
+namespace {
+using MB::Protocol::MBAPSize;
+
+// 1 minute without request means the connection has died
+constexpr int RequestTimeout = 60 * 1000;
+
+std::vector<uint8_t> withMBAP(uint16_t messageID,
+                              const std::vector<uint8_t> &frame) {
+  std::vector<uint8_t> raw;
+  raw.reserve(MBAPSize + frame.size());
+  MB::utils::pushUint16(raw, messageID);
+  MB::utils::pushUint16(raw, 0);
+  MB::utils::pushUint16(raw, static_cast<uint16_t>(frame.size()));
+  raw.insert(raw.end(), frame.begin(), frame.end());
+  return raw;
+}
+} // namespace
+
+Connection::Connection(int sockfd) noexcept : _sockfd(sockfd) {}
+
+Connection::Connection(Connection &&moved) noexcept
+    : _sockfd(moved._sockfd), _messageID(moved._messageID),
+      _timeout(moved._timeout), _fds(std::move(moved._fds)) {
+  moved._sockfd = -1;
+  moved._fds.clear();
+}
+
+Connection &Connection::operator=(Connection &&other) noexcept {
+  if (this == &other)
+    return *this;
+
+  closeSockfd();
+  closeFds();
+  _sockfd = other._sockfd;
+  _messageID = other._messageID;
+  _timeout = other._timeout;
+  _fds = std::move(other._fds);
+  other._sockfd = -1;
+  other._fds.clear();
+  return *this;
+}
+
+Connection::~Connection() {
+  closeSockfd();
+  closeFds();
+}
+
+void Connection::closeSockfd() {
+  if (_sockfd >= 0)
+    ::close(_sockfd);
+  _sockfd = -1;
+}
+
+void Connection::closeFds() {
+  for (auto fd : _fds)
+    ::close(fd);
+  _fds.clear();
+}
+
+Connection Connection::with(const std::string &path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+    throw std::runtime_error("Socket path is too long: " + path);
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  auto sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sock == -1)
+    throw std::runtime_error("Cannot open socket, errno = " +
+                             std::to_string(errno));
+
+  if (::connect(sock, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) < 0) {
+    const auto error = errno;
+    ::close(sock);
+    throw std::runtime_error("Cannot connect, errno = " +
+                             std::to_string(error));
+  }
+
+  return Connection(sock);
+}
+
+std::vector<uint8_t> Connection::send(const std::vector<uint8_t> &frame,
+                                      std::span<const int> fds) {
+  if (fds.size() > MaxFds)
+    throw std::runtime_error("Too many descriptors in a single frame");
+
+  auto raw = withMBAP(_messageID, frame);
+
+  iovec vector = {raw.data(), raw.size()};
+  msghdr message = {};
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MaxFds)];
+  if (!fds.empty()) {
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+    auto *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    std::memcpy(CMSG_DATA(header), fds.data(), sizeof(int) * fds.size());
+  }
+
+  // Descriptors go with the first chunk, the rest is plain data
+  std::size_t sent = 0;
+  while (sent < raw.size()) {
+    auto size = ::sendmsg(_sockfd, &message, MSG_NOSIGNAL);
+    if (size < 0) {
+      if (errno == EINTR)
+        continue;
+      throw MB::ModbusException(MB::utils::ConnectionClosed);
+    }
+    sent += static_cast<std::size_t>(size);
+    vector = {raw.data() + sent, raw.size() - sent};
+    message.msg_control = nullptr;
+    message.msg_controllen = 0;
+  }
+
+  return raw;
+}
+
+std::vector<uint8_t> Connection::sendRequest(const MB::ModbusRequest &req,
+                                             std::span<const int> fds) {
+  return send(req.toRaw(), fds);
+}
+
+std::vector<uint8_t> Connection::sendResponse(const MB::ModbusResponse &res,
+                                              std::span<const int> fds) {
+  return send(res.toRaw(), fds);
+}
+
+std::vector<uint8_t> Connection::sendException(const MB::ModbusException &ex,
+                                               std::span<const int> fds) {
+  return send(ex.toRaw(), fds);
+}
+
+void Connection::receive(uint8_t *buffer, std::size_t size, int timeout,
+                         utils::MBErrorCode timeoutError) {
+  std::size_t received = 0;
+  while (received < size) {
+    pollfd pfd = {.fd = _sockfd, .events = POLLIN, .revents = 0};
+    if (::poll(&pfd, 1, timeout) <= 0)
+      throw MB::ModbusException(timeoutError);
+
+    iovec vector = {buffer + received, size - received};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MaxFds)];
+    msghdr message = {};
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    auto count = ::recvmsg(_sockfd, &message, MSG_CMSG_CLOEXEC);
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      throw MB::ModbusException(MB::utils::ProtocolError);
+    } else if (count == 0) {
+      throw MB::ModbusException(MB::utils::ConnectionClosed);
+    }
+    received += static_cast<std::size_t>(count);
+
+    for (auto *header = CMSG_FIRSTHDR(&message); header != nullptr;
+         header = CMSG_NXTHDR(&message, header)) {
+      if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+        continue;
+      const auto fds = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (std::size_t i = 0; i < fds; i++) {
+        int fd;
+        std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+        _fds.push_back(fd);
+      }
+    }
+    if (message.msg_flags & MSG_CTRUNC)
+      throw MB::ModbusException(MB::utils::ProtocolError);
+  }
+}
+
+template <typename Buffer>
+std::size_t Connection::receiveFrame(Buffer &buffer, int timeout,
+                                     utils::MBErrorCode timeoutError) {
+  buffer.resize(MBAPSize);
+  receive(buffer.data(), MBAPSize, timeout, timeoutError);
+
+  const auto length = utils::bigEndianConv(&buffer[4]);
+  // Bounded like TCP, so a peer can not make the buffer grow to 64 KiB
+  if (utils::bigEndianConv(&buffer[2]) != 0 || length < 2 ||
+      length > Protocol::MaxMBAPLength)
+    throw MB::ModbusException(MB::utils::ProtocolError);
+
+  // Rest of the frame is already on its way
+  buffer.resize(MBAPSize + length);
+  receive(buffer.data() + MBAPSize, length, _timeout, timeoutError);
+  return buffer.size();
+}
+
+std::vector<uint8_t> Connection::awaitRawMessage() {
+  std::vector<uint8_t> r;
+  receiveFrame(r, RequestTimeout, MB::utils::ConnectionClosed);
+  return r;
+}
+
+std::pmr::vector<uint8_t>
+Connection::awaitRawMessage(std::pmr::memory_resource *resource) {
+  std::pmr::vector<uint8_t> r(resource);
+  receiveFrame(r, RequestTimeout, MB::utils::ConnectionClosed);
+  return r;
+}
+
+MB::ModbusRequest Connection::awaitRequest(std::pmr::memory_resource *resource) {
+  std::pmr::vector<uint8_t> r(resource);
+  auto size = receiveFrame(r, RequestTimeout, MB::utils::Timeout);
+
+  _messageID = utils::bigEndianConv(r.data());
+
+  return MB::ModbusRequest::fromRaw(
+      std::span<const uint8_t>(r.data() + MBAPSize, size - MBAPSize),
+      resource);
+}
+
+MB::ModbusResponse
+Connection::awaitResponse(std::pmr::memory_resource *resource) {
+  std::pmr::vector<uint8_t> r(resource);
+  auto size = receiveFrame(r, _timeout, MB::utils::Timeout);
+
+  if (utils::bigEndianConv(r.data()) != _messageID)
+    throw MB::ModbusException(MB::utils::InvalidMessageID);
+
+  auto frame = std::span<const uint8_t>(r.data() + MBAPSize, size - MBAPSize);
+
+  if (MB::ModbusException::exist(frame))
+    throw MB::ModbusException(frame);
+
+  return MB::ModbusResponse::fromRaw(frame, resource);
+}
+
+std::vector<int> Connection::takeFds() {
+  std::vector<int> fds;
+  fds.swap(_fds);
+  return fds;
+}
@@ -0,0 +1,75 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Unix/server.hpp"
+
+using namespace MB::Unix;
+
+Server::Server(const std::string &path) : _path(path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+    throw std::runtime_error("Socket path is too long: " + path);
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  // Socket left by a server that has not been shut down cleanly
+  struct stat status = {};
+  if (::stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+    ::unlink(path.c_str());
+
+  _serverfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (_serverfd == -1)
+    throw std::runtime_error("Cannot create socket");
+
+  if (::bind(_serverfd, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) < 0) {
+    ::close(_serverfd);
+    throw std::runtime_error("Cannot bind socket, errno = " +
+                             std::to_string(errno));
+  }
+
+  ::listen(_serverfd, 255);
+}
+
+Server::~Server() {
+  if (_serverfd >= 0) {
+    ::close(_serverfd);
+    ::unlink(_path.c_str());
+  }
+  _serverfd = -1;
+}
+
+Server &Server::operator=(Server &&moved) noexcept {
+  if (this == &moved)
+    return *this;
+
+  if (_serverfd >= 0) {
+    ::close(_serverfd);
+    ::unlink(_path.c_str());
+  }
+  _serverfd = moved._serverfd;
+  _path = std::move(moved._path);
+  moved._serverfd = -1;
+  moved._path.clear();
+  return *this;
+}
+
+Connection Server::awaitConnection() {
+  auto connfd = ::accept4(_serverfd, nullptr, nullptr, SOCK_CLOEXEC);
+
+  if (connfd < 0)
+    throw std::runtime_error("Cannot accept connection, errno = " +
+                             std::to_string(errno));
+
+  return Connection(connfd);
+}
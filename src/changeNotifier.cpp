@@ -0,0 +1,211 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "changeNotifier.hpp"
+
+#include <algorithm>
+
+using namespace MB;
+
+namespace {
+uint64_t pack(uint16_t first, uint16_t last) {
+  return uint64_t(first) << 16 | last;
+}
+} // namespace
+
+void ChangeNotifier::Signal::prepare() noexcept {
+  _waiting.store(true, std::memory_order_relaxed);
+  // Pairs with fence in notify(), either producer sees the flag or consumer
+  // sees the change in its next check
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void ChangeNotifier::Signal::cancel() noexcept {
+  _waiting.store(false, std::memory_order_relaxed);
+}
+
+void ChangeNotifier::Signal::wait(std::chrono::steady_clock::time_point deadline) {
+  std::unique_lock lock(_mutex);
+  _condition.wait_until(lock, deadline, [this] { return _signalled; });
+  _signalled = false;
+  _waiting.store(false, std::memory_order_relaxed);
+}
+
+void ChangeNotifier::Signal::wait() {
+  std::unique_lock lock(_mutex);
+  _condition.wait(lock, [this] { return _signalled; });
+  _signalled = false;
+  _waiting.store(false, std::memory_order_relaxed);
+}
+
+void ChangeNotifier::Signal::notify() noexcept {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_waiting.load(std::memory_order_relaxed))
+    wake();
+}
+
+void ChangeNotifier::Signal::wake() noexcept {
+  {
+    std::lock_guard lock(_mutex);
+    _signalled = true;
+  }
+  _condition.notify_one();
+}
+
+void ChangeNotifier::Subscription::push(const Change &change) noexcept {
+  // Once coalescing started, changes are merged until consumer takes them,
+  // so queued changes are always older than the coalesced one
+  if (_coalesced.load(std::memory_order_acquire) == Empty) {
+    Change copy = change;
+    if (_queue.tryPush(std::move(copy)))
+      return;
+  }
+
+  auto current = _coalesced.load(std::memory_order_relaxed);
+  while (true) {
+    const auto merged =
+        current == Empty
+            ? pack(change.first, change.last)
+            : pack(std::min(uint16_t(current >> 16), change.first),
+                   std::max(uint16_t(current), change.last));
+    if (_coalesced.compare_exchange_weak(current, merged,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed))
+      return;
+  }
+}
+
+std::optional<Change> ChangeNotifier::Subscription::next() {
+  if (auto change = _queue.tryPop())
+    return change;
+
+  const auto coalesced = _coalesced.exchange(Empty, std::memory_order_acquire);
+  if (coalesced == Empty)
+    return std::nullopt;
+
+  return Change{_range.unit.value_or(0), _range.table,
+                static_cast<uint16_t>(coalesced >> 16),
+                static_cast<uint16_t>(coalesced), true};
+}
+
+std::optional<Change>
+ChangeNotifier::Subscription::next(std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    if (auto change = next())
+      return change;
+
+    _signal.prepare();
+    if (auto change = next()) {
+      _signal.cancel();
+      return change;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      _signal.cancel();
+      return std::nullopt;
+    }
+    _signal.wait(deadline);
+  }
+}
+
+ChangeNotifier::ChangeNotifier(std::size_t capacity)
+    : _capacity(capacity),
+      _subscriptions(std::make_shared<const Subscriptions>()) {}
+
+ChangeNotifier::~ChangeNotifier() {
+  _stop = true;
+  _dispatcherSignal.wake();
+  if (_dispatcher.joinable())
+    _dispatcher.join();
+}
+
+void ChangeNotifier::add(const std::shared_ptr<Subscription> &subscription) {
+  std::lock_guard lock(_mutex);
+  auto updated = std::make_shared<Subscriptions>(*_subscriptions.load());
+  updated->push_back(subscription);
+  _subscriptions.store(std::move(updated));
+
+  if (subscription->_callback && !_dispatcher.joinable())
+    _dispatcher = std::thread([this] { dispatch(); });
+}
+
+std::shared_ptr<ChangeNotifier::Subscription>
+ChangeNotifier::subscribe(const ChangeRange &range) {
+  auto subscription = std::make_shared<Subscription>(range, _capacity, nullptr);
+  add(subscription);
+  return subscription;
+}
+
+std::shared_ptr<ChangeNotifier::Subscription>
+ChangeNotifier::subscribe(const ChangeRange &range, Callback callback) {
+  auto subscription =
+      std::make_shared<Subscription>(range, _capacity, std::move(callback));
+  add(subscription);
+  return subscription;
+}
+
+void ChangeNotifier::unsubscribe(
+    const std::shared_ptr<Subscription> &subscription) {
+  std::lock_guard lock(_mutex);
+  auto updated = std::make_shared<Subscriptions>(*_subscriptions.load());
+  std::erase(*updated, subscription);
+  _subscriptions.store(std::move(updated));
+}
+
+void ChangeNotifier::publish(uint8_t unit, utils::MBFunctionRegisters table,
+                             uint16_t address, uint16_t count) noexcept {
+  if (count == 0)
+    return;
+  const uint32_t end = uint32_t(address) + count;
+
+  bool dispatch = false;
+  const auto subscriptions = _subscriptions.load(std::memory_order_acquire);
+  for (const auto &subscription : *subscriptions) {
+    const auto &range = subscription->_range;
+    if (range.table != table || (range.unit && *range.unit != unit) ||
+        range.first >= end || range.last < address)
+      continue;
+
+    // Only the part of the write that subscription asked for
+    const auto first = std::max(range.first, address);
+    const auto last =
+        static_cast<uint16_t>(std::min<uint32_t>(range.last, end - 1));
+    subscription->push(Change{unit, table, first, last});
+    if (subscription->_callback)
+      dispatch = true;
+    else
+      subscription->_signal.notify();
+  }
+
+  if (dispatch)
+    _dispatcherSignal.notify();
+}
+
+void ChangeNotifier::dispatch() {
+  const auto deliver = [this] {
+    bool delivered = false;
+    const auto subscriptions = _subscriptions.load(std::memory_order_acquire);
+    for (const auto &subscription : *subscriptions) {
+      if (!subscription->_callback)
+        continue;
+      while (auto change = subscription->next()) {
+        subscription->_callback(*change);
+        delivered = true;
+      }
+    }
+    return delivered;
+  };
+
+  while (!_stop.load(std::memory_order_relaxed)) {
+    if (deliver())
+      continue;
+
+    _dispatcherSignal.prepare();
+    if (deliver() || _stop.load(std::memory_order_relaxed)) {
+      _dispatcherSignal.cancel();
+      continue;
+    }
+    _dispatcherSignal.wait();
+  }
+}
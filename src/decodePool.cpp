@@ -0,0 +1,238 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "decodePool.hpp"
+
+#include <algorithm>
+#include <optional>
+
+using namespace MB;
+
+namespace {
+// Lets submit() called from inside a callback push to the local worker
+thread_local const void *currentPool = nullptr;
+thread_local std::size_t currentWorker = 0;
+} // namespace
+
+DecodePool::DecodePool(std::size_t threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (std::size_t i = 0; i < threads; i++)
+    _workers.push_back(std::make_unique<Worker>());
+  for (auto &strands : _shards)
+    strands.free.reserve(FreeStrands);
+
+  for (std::size_t i = 0; i < threads; i++)
+    _threads.emplace_back([this, i]() { work(i); });
+}
+
+DecodePool::~DecodePool() {
+  drain();
+
+  _stopping.store(true, std::memory_order_seq_cst);
+  _wakeSequence.fetch_add(1, std::memory_order_release);
+  _wakeSequence.notify_all();
+
+  for (auto &thread : _threads)
+    thread.join();
+}
+
+DecodePool::StrandShard &DecodePool::shard(uint32_t device) noexcept {
+  // Device keys are often sequential, so they are mixed first and the top
+  // 6 bits pick the shard
+  static_assert(StrandShards == 64);
+  return _shards[(device * 0x9E3779B1u) >> 26];
+}
+
+void DecodePool::submit(uint32_t device, std::vector<uint8_t> frame,
+                        Decoded callback, bool CRC) {
+  _outstanding.fetch_add(1, std::memory_order_relaxed);
+
+  Strand *strand;
+  bool needsSchedule;
+  {
+    // Held until task is queued, so strand can not be released meanwhile
+    auto &strands = shard(device);
+    std::lock_guard strandsLock(strands.mutex);
+    auto found = strands.strands.find(device);
+    if (found == strands.strands.end()) {
+      if (strands.free.empty()) {
+        found = strands.strands.emplace(device, std::make_unique<Strand>())
+                    .first;
+      } else {
+        // Devices are idle between frames most of the time, so their
+        // strands are recycled instead of allocated on every burst
+        auto node = std::move(strands.free.back());
+        strands.free.pop_back();
+        node.key() = device;
+        found = strands.strands.insert(std::move(node)).position;
+      }
+      found->second->device = device;
+    }
+    strand = found->second.get();
+
+    std::lock_guard lock(strand->mutex);
+    strand->tasks.push_back(
+        Task{device, std::move(frame), CRC, std::move(callback)});
+    needsSchedule = !strand->scheduled;
+    strand->scheduled = true;
+  }
+
+  if (needsSchedule)
+    schedule(strand);
+}
+
+void DecodePool::drain() {
+  auto outstanding = _outstanding.load(std::memory_order_acquire);
+  while (outstanding != 0) {
+    _outstanding.wait(outstanding, std::memory_order_acquire);
+    outstanding = _outstanding.load(std::memory_order_acquire);
+  }
+}
+
+void DecodePool::schedule(Strand *strand) {
+  std::size_t index;
+  if (currentPool == this)
+    index = currentWorker;
+  else
+    index = _nextWorker.fetch_add(1, std::memory_order_relaxed) %
+            _workers.size();
+
+  {
+    std::lock_guard lock(_workers[index]->mutex);
+    _workers[index]->strands.push_back(strand);
+    // Counted before anyone can take the strand, so it never goes below 0.
+    // Pairs with _sleepers increment in work(), either the worker sees this
+    // strand or this sees the worker.
+    _queued.fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  if (_sleepers.load(std::memory_order_seq_cst) != 0) {
+    _wakeSequence.fetch_add(1, std::memory_order_release);
+    _wakeSequence.notify_one();
+  }
+}
+
+DecodePool::Strand *DecodePool::take(std::size_t index) {
+  Strand *strand = nullptr;
+
+  // Own queue is used as a stack, for cache locality
+  {
+    auto &own = *_workers[index];
+    std::lock_guard lock(own.mutex);
+    if (!own.strands.empty()) {
+      strand = own.strands.back();
+      own.strands.pop_back();
+    }
+  }
+
+  // Steal oldest work from others
+  for (std::size_t i = 1; strand == nullptr && i < _workers.size(); i++) {
+    auto &victim = *_workers[(index + i) % _workers.size()];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.strands.empty()) {
+      strand = victim.strands.front();
+      victim.strands.pop_front();
+    }
+  }
+
+  if (strand != nullptr)
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+
+  return strand;
+}
+
+void DecodePool::runStrand(Strand *strand) {
+  for (std::size_t n = 0; n < StrandBatch; n++) {
+    std::optional<Task> task;
+    {
+      std::lock_guard lock(strand->mutex);
+      if (!strand->tasks.empty()) {
+        task.emplace(std::move(strand->tasks.front()));
+        strand->tasks.pop_front();
+      }
+    }
+    if (!task) {
+      if (release(strand))
+        return;
+      continue;
+    }
+
+    std::optional<ModbusResponse> response;
+    std::exception_ptr error;
+    try {
+      if (ModbusException::exist(task->frame))
+        throw ModbusException(task->frame, task->CRC);
+      response.emplace(task->frame, task->CRC);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    try {
+      if (task->callback)
+        task->callback(task->device, response ? &*response : nullptr, error);
+    } catch (...) {
+      // Nobody to report to, worker and the rest of the strand go on
+    }
+
+    if (_outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      _outstanding.notify_all();
+  }
+
+  // Batch is done, give other workers chance to steal rest of the strand
+  if (!release(strand))
+    schedule(strand);
+}
+
+bool DecodePool::release(Strand *strand) {
+  auto &strands = shard(strand->device);
+  std::lock_guard strandsLock(strands.mutex);
+  {
+    std::lock_guard lock(strand->mutex);
+    if (!strand->tasks.empty())
+      return false;
+  }
+  // Scheduled strand is referenced only by this worker, nobody else can
+  // reach it without the shard mutex
+  auto node = strands.strands.extract(strand->device);
+  if (strands.free.size() < FreeStrands) {
+    node.mapped()->scheduled = false;
+    strands.free.push_back(std::move(node));
+  }
+  return true;
+}
+
+std::size_t DecodePool::strandsCount() {
+  std::size_t count = 0;
+  for (auto &strands : _shards) {
+    std::lock_guard lock(strands.mutex);
+    count += strands.strands.size();
+  }
+  return count;
+}
+
+void DecodePool::work(std::size_t index) {
+  currentPool = this;
+  currentWorker = index;
+
+  while (true) {
+    auto strand = take(index);
+    if (strand != nullptr) {
+      runStrand(strand);
+      continue;
+    }
+
+    const auto sequence = _wakeSequence.load(std::memory_order_acquire);
+    _sleepers.fetch_add(1, std::memory_order_seq_cst);
+    if (_queued.load(std::memory_order_seq_cst) == 0 &&
+        !_stopping.load(std::memory_order_seq_cst))
+      _wakeSequence.wait(sequence, std::memory_order_acquire);
+    _sleepers.fetch_sub(1, std::memory_order_relaxed);
+
+    if (_stopping.load(std::memory_order_acquire) &&
+        _queued.load(std::memory_order_acquire) == 0)
+      return;
+  }
+}
@@ -0,0 +1,429 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "durableRegisterBank.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace MB;
+
+namespace {
+constexpr std::array<char, 8> SnapshotMagic = {'M', 'B', 'S', 'N',
+                                               'A', 'P', '\0', '\1'};
+constexpr std::array<char, 8> LogMagic = {'M', 'B', 'W', 'A',
+                                          'L', '\0', '\0', '\1'};
+
+// Values are stored in host byte order, files are not meant to be moved
+// between machines
+struct SnapshotHeader {
+  std::array<char, 8> magic;
+  uint64_t generation;
+  std::array<uint32_t, 4> sizes;
+};
+
+struct LogHeader {
+  std::array<char, 8> magic;
+  uint64_t generation;
+};
+
+// Record: table (1), address (2), count (2), values (2 * count), CRC (2)
+constexpr std::size_t RecordHeaderSize = 5;
+
+constexpr std::array<utils::MBFunctionRegisters, 4> Tables = {
+    utils::OutputCoils, utils::InputContacts, utils::HoldingRegisters,
+    utils::InputRegisters};
+
+bool isCoilTable(utils::MBFunctionRegisters table) {
+  return table == utils::OutputCoils || table == utils::InputContacts;
+}
+
+template <typename T> void append(std::vector<uint8_t> &out, T value) {
+  const auto offset = out.size();
+  out.resize(offset + sizeof(T));
+  std::memcpy(&out[offset], &value, sizeof(T));
+}
+
+template <typename T> T load(const uint8_t *data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+[[noreturn]] void fail(const std::string &what,
+                       const std::filesystem::path &path) {
+  throw std::runtime_error(what + " " + path.string() +
+                           ", errno = " + std::to_string(errno));
+}
+
+void writeAll(int fd, const uint8_t *data, std::size_t size,
+              const std::filesystem::path &path) {
+  while (size > 0) {
+    const auto written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      fail("Cannot write", path);
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+
+// Makes renames in directory durable
+void syncDirectory(const std::filesystem::path &directory) {
+  const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    fail("Cannot open", directory);
+  const int result = ::fsync(fd);
+  ::close(fd);
+  if (result != 0)
+    fail("Cannot sync", directory);
+}
+
+int createLog(const std::filesystem::path &path, uint64_t generation) {
+  const int fd =
+      ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+             0644);
+  if (fd < 0)
+    fail("Cannot create", path);
+
+  std::vector<uint8_t> header;
+  append(header, LogHeader{LogMagic, generation});
+  writeAll(fd, header.data(), header.size(), path);
+  if (::fdatasync(fd) != 0) {
+    ::close(fd);
+    fail("Cannot sync", path);
+  }
+  return fd;
+}
+} // namespace
+
+DurableRegisterBank::DurableRegisterBank(std::filesystem::path directory,
+                                         DurableOptions options)
+    : _directory(std::move(directory)), _options(options),
+      _bank(options.outputCoils, options.inputContacts,
+            options.holdingRegisters, options.inputRegisters) {
+  recover();
+  _committer = std::thread([this] { commitLoop(); });
+}
+
+DurableRegisterBank::~DurableRegisterBank() {
+  {
+    std::lock_guard lock(_mutex);
+    _stopping = true;
+  }
+  _wake.notify_all();
+  _committer.join();
+  if (_logFd >= 0)
+    ::close(_logFd);
+}
+
+void DurableRegisterBank::recover() {
+  std::filesystem::create_directories(_directory);
+
+  const auto snapshot = _directory / "snapshot";
+  const int fd = ::open(snapshot.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    struct stat info = {};
+    ::fstat(fd, &info);
+    const auto size = static_cast<std::size_t>(info.st_size);
+    void *memory = size > 0 ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                            : MAP_FAILED;
+    ::close(fd);
+    if (memory == MAP_FAILED)
+      fail("Cannot map", snapshot);
+
+    const auto *data = static_cast<const uint8_t *>(memory);
+    std::size_t expected = sizeof(SnapshotHeader);
+    for (auto table : Tables)
+      expected += _bank.size(table) * (isCoilTable(table) ? 1 : 2);
+
+    const auto header =
+        size >= sizeof(SnapshotHeader) ? load<SnapshotHeader>(data)
+                                       : SnapshotHeader{};
+    bool valid = header.magic == SnapshotMagic && size == expected;
+    for (std::size_t i = 0; valid && i < Tables.size(); i++)
+      valid = header.sizes[i] == _bank.size(Tables[i]);
+    if (!valid) {
+      ::munmap(memory, size);
+      throw std::runtime_error("Snapshot " + snapshot.string() +
+                               " does not match register bank layout");
+    }
+
+    _generation = header.generation;
+    data += sizeof(SnapshotHeader);
+    for (auto table : Tables) {
+      if (isCoilTable(table)) {
+        auto &bits = _bank.coils(table);
+        for (std::size_t i = 0; i < bits.size(); i++)
+          bits[i] = data[i] != 0;
+        data += bits.size();
+      } else {
+        auto words = _bank.registers(table);
+        std::memcpy(words.data(), data, words.size_bytes());
+        data += words.size_bytes();
+      }
+    }
+    ::munmap(memory, size);
+  }
+
+  // Next log exists only if compaction was interrupted
+  replay(_directory / "wal");
+  replay(_directory / "wal.next");
+
+  // Start from a clean snapshot, so logs left by crash are never read again
+  captureImage();
+  compact();
+}
+
+void DurableRegisterBank::replay(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return;
+  const std::vector<uint8_t> log((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+
+  if (log.size() < sizeof(LogHeader))
+    return;
+  const auto header = load<LogHeader>(log.data());
+  // Logs older than snapshot are already contained in it
+  if (header.magic != LogMagic || header.generation < _generation)
+    return;
+
+  ModbusCells cells;
+  std::size_t offset = sizeof(LogHeader);
+  while (log.size() - offset >= RecordHeaderSize) {
+    const uint8_t *record = &log[offset];
+    const auto count = load<uint16_t>(record + 3);
+    const std::size_t size = RecordHeaderSize + 2 * std::size_t(count) + 2;
+    // Torn tail of the last group, it was never reported durable
+    if (log.size() - offset < size || record[0] >= Tables.size() ||
+        load<uint16_t>(record + size - 2) !=
+            utils::calculateCRC(record, size - 2))
+      return;
+
+    const auto table = static_cast<utils::MBFunctionRegisters>(record[0]);
+    cells.clear();
+    for (std::size_t i = 0; i < count; i++) {
+      const auto value = load<uint16_t>(record + RecordHeaderSize + 2 * i);
+      cells.push_back(isCoilTable(table) ? ModbusCell(value != 0)
+                                         : ModbusCell(value));
+    }
+    try {
+      _bank.write(table, load<uint16_t>(record + 1),
+                  std::span<const ModbusCell>(cells.data(), cells.size()));
+    } catch (const ModbusException &) {
+      return;
+    }
+    offset += size;
+  }
+}
+
+void DurableRegisterBank::captureImage() {
+  _image.clear();
+  SnapshotHeader header{SnapshotMagic, _generation + 1, {}};
+  for (std::size_t i = 0; i < Tables.size(); i++)
+    header.sizes[i] = static_cast<uint32_t>(_bank.size(Tables[i]));
+  append(_image, header);
+
+  for (auto table : Tables) {
+    if (isCoilTable(table)) {
+      for (const bool bit : _bank.coils(table))
+        _image.push_back(bit ? 1 : 0);
+    } else {
+      const auto words = _bank.registers(table);
+      const auto offset = _image.size();
+      _image.resize(offset + words.size_bytes());
+      std::memcpy(&_image[offset], words.data(), words.size_bytes());
+    }
+  }
+}
+
+void DurableRegisterBank::writeSnapshot() {
+  const auto temporary = _directory / "snapshot.tmp";
+  const int fd =
+      ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    fail("Cannot create", temporary);
+  if (::ftruncate(fd, static_cast<off_t>(_image.size())) != 0) {
+    ::close(fd);
+    fail("Cannot resize", temporary);
+  }
+
+  void *memory =
+      ::mmap(nullptr, _image.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    ::close(fd);
+    fail("Cannot map", temporary);
+  }
+  std::memcpy(memory, _image.data(), _image.size());
+  const bool synced = ::msync(memory, _image.size(), MS_SYNC) == 0;
+  ::munmap(memory, _image.size());
+  ::close(fd);
+  if (!synced)
+    fail("Cannot sync", temporary);
+
+  std::filesystem::rename(temporary, _directory / "snapshot");
+  syncDirectory(_directory);
+}
+
+void DurableRegisterBank::appendLog(std::span<const uint8_t> data, bool sync) {
+  const auto path = _directory / "wal";
+  writeAll(_logFd, data.data(), data.size(), path);
+  _logSize += data.size();
+  if (sync && ::fdatasync(_logFd) != 0)
+    fail("Cannot sync", path);
+}
+
+void DurableRegisterBank::compact() {
+  // Writes made after image was captured go to the next log. Until the new
+  // snapshot replaces the old one, the next log is replayed after the
+  // current one; afterwards the current log is older than snapshot.
+  const auto next = _directory / "wal.next";
+  const int fd = createLog(next, _generation + 1);
+  try {
+    writeSnapshot();
+    std::filesystem::rename(next, _directory / "wal");
+    syncDirectory(_directory);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+
+  if (_logFd >= 0)
+    ::close(_logFd);
+  _logFd = fd;
+  _logSize = sizeof(LogHeader);
+  _generation++;
+}
+
+void DurableRegisterBank::commitLoop() {
+  std::unique_lock lock(_mutex);
+  while (true) {
+    const auto urgent = [this] {
+      return _stopping || _flushRequested || _compactRequested;
+    };
+    _wake.wait(lock, [&] { return urgent() || !_pending.empty(); });
+    // Group collects writes until it is old or large enough
+    _wake.wait_until(lock, _pendingSince + _options.commitInterval, [&] {
+      return urgent() || _pending.size() >= _options.commitBytes;
+    });
+
+    _batch.clear();
+    _batch.swap(_pending);
+    const auto sequence = _appended;
+    const bool compacting = _compactRequested ||
+                            _logSize + _batch.size() >= _options.compactBytes;
+    _flushRequested = _compactRequested = false;
+    if (compacting)
+      captureImage();
+    const bool stopping = _stopping;
+    lock.unlock();
+
+    bool committed = true;
+    try {
+      // When compacting, snapshot makes the group durable
+      if (!_batch.empty())
+        appendLog(_batch, !compacting);
+      if (compacting)
+        compact();
+    } catch (const std::exception &) {
+      committed = false;
+    }
+
+    lock.lock();
+    _failed = _failed || !committed;
+    _durable = sequence;
+    if (compacting)
+      _compactions++;
+
+    std::vector<Waiting> ready;
+    std::erase_if(_waiting, [&](Waiting &waiting) {
+      if (waiting.sequence > sequence)
+        return false;
+      ready.push_back(std::move(waiting));
+      return true;
+    });
+    const bool durable = !_failed;
+    lock.unlock();
+    for (auto &waiting : ready)
+      waiting.callback(durable);
+    lock.lock();
+
+    _committed.notify_all();
+    if (stopping && _pending.empty())
+      return;
+  }
+}
+
+void DurableRegisterBank::read(utils::MBFunctionRegisters table,
+                               uint16_t address,
+                               std::span<ModbusCell> out) const {
+  std::lock_guard lock(_mutex);
+  _bank.read(table, address, out);
+}
+
+void DurableRegisterBank::write(utils::MBFunctionRegisters table,
+                                uint16_t address,
+                                std::span<const ModbusCell> values) {
+  std::lock_guard lock(_mutex);
+  if (_failed)
+    throw ModbusException(utils::SlaveDeviceFailure);
+  _bank.write(table, address, values);
+
+  const auto start = _pending.size();
+  if (start == 0)
+    _pendingSince = std::chrono::steady_clock::now();
+  _pending.push_back(static_cast<uint8_t>(table));
+  append(_pending, address);
+  append(_pending, static_cast<uint16_t>(values.size()));
+  for (const auto &value : values)
+    append(_pending, isCoilTable(table) ? uint16_t(value.coil()) : value.reg());
+  append(_pending, utils::calculateCRC(&_pending[start], _pending.size() - start));
+  _appended++;
+
+  if (start == 0 || _pending.size() >= _options.commitBytes)
+    _wake.notify_one();
+}
+
+void DurableRegisterBank::whenDurable(DurableCallback callback) {
+  std::unique_lock lock(_mutex);
+  if (_failed || _durable == _appended) {
+    const bool durable = !_failed;
+    lock.unlock();
+    callback(durable);
+    return;
+  }
+  _waiting.push_back(Waiting{_appended, std::move(callback)});
+}
+
+void DurableRegisterBank::sync() {
+  std::unique_lock lock(_mutex);
+  const auto target = _appended;
+  _flushRequested = true;
+  _wake.notify_one();
+  _committed.wait(lock, [&] { return _durable >= target || _failed; });
+  if (_failed)
+    throw std::runtime_error("Register bank log could not be written");
+}
+
+void DurableRegisterBank::compactNow() {
+  std::unique_lock lock(_mutex);
+  const auto target = _compactions + 1;
+  _compactRequested = true;
+  _wake.notify_one();
+  _committed.wait(lock, [&] { return _compactions >= target || _failed; });
+  if (_failed)
+    throw std::runtime_error("Register bank snapshot could not be written");
+}
@@ -0,0 +1,147 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "flightRecorder.hpp"
+
+using namespace MB;
+
+namespace {
+// Meta layout: direction in bits 0-7, error code in 8-15, length in 16-31
+uint32_t packMeta(FlightRecorder::Direction direction, uint8_t errorCode,
+                  std::size_t length) noexcept {
+  return static_cast<uint32_t>(direction) |
+         static_cast<uint32_t>(errorCode) << 8 |
+         static_cast<uint32_t>(std::min<std::size_t>(length, 0xFFFF)) << 16;
+}
+
+const char *toString(FlightRecorder::Direction direction) {
+  switch (direction) {
+  case FlightRecorder::Tx:
+    return "TX";
+  case FlightRecorder::Rx:
+    return "RX";
+  default:
+    return "ERR";
+  }
+}
+} // namespace
+
+FlightRecorder::FlightRecorder(std::size_t capacity)
+    : _slots(new Slot[std::bit_ceil(std::max<std::size_t>(capacity, 1))]),
+      _mask(std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1) {}
+
+void FlightRecorder::record(Direction direction,
+                            std::span<const uint8_t> frame,
+                            uint8_t errorCode) noexcept {
+  const auto position = _head.fetch_add(1, std::memory_order_relaxed);
+  auto &slot = _slots[position & _mask];
+
+  slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.time.store(std::chrono::system_clock::now().time_since_epoch().count(),
+                  std::memory_order_relaxed);
+  slot.meta.store(packMeta(direction, errorCode, frame.size()),
+                  std::memory_order_relaxed);
+
+  const auto kept = std::min(frame.size(), MaxFrameSize);
+  for (std::size_t offset = 0; offset < kept; offset += sizeof(uint64_t)) {
+    uint64_t word = 0;
+    std::memcpy(&word, frame.data() + offset,
+                std::min(sizeof(uint64_t), kept - offset));
+    slot.data[offset / sizeof(uint64_t)].store(word,
+                                               std::memory_order_relaxed);
+  }
+
+  slot.sequence.store(2 * position + 2, std::memory_order_release);
+}
+
+void FlightRecorder::failure(const ModbusException &error) {
+  const auto code = error.getErrorCode();
+  record(Error, {}, code);
+  if (utils::isStandardErrorCode(code))
+    return;
+
+  if (_dumpHandler) {
+    _dumpHandler(*this, error);
+  } else {
+    std::clog << "Modbus flight recorder, " << error.toString() << '\n';
+    dump(std::clog);
+  }
+}
+
+std::vector<FlightRecorder::Record> FlightRecorder::records() const {
+  const auto head = _head.load(std::memory_order_acquire);
+  const auto first = head > capacity() ? head - capacity() : 0;
+
+  std::vector<Record> result;
+  result.reserve(head - first);
+
+  std::array<uint64_t, Words> words;
+  for (auto position = first; position < head; position++) {
+    const auto &slot = _slots[position & _mask];
+    const auto sequence = slot.sequence.load(std::memory_order_acquire);
+    // Not finished yet or already overwritten
+    if (sequence != 2 * position + 2)
+      continue;
+
+    const auto time = slot.time.load(std::memory_order_relaxed);
+    const auto meta = slot.meta.load(std::memory_order_relaxed);
+    const std::size_t length = meta >> 16;
+    const auto kept = std::min(length, MaxFrameSize);
+    for (std::size_t i = 0; i * sizeof(uint64_t) < kept; i++)
+      words[i] = slot.data[i].load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+      continue;
+
+    Record &record = result.emplace_back();
+    record.time = std::chrono::system_clock::time_point(
+        std::chrono::system_clock::duration(time));
+    record.direction = static_cast<Direction>(meta & 0xFF);
+    record.errorCode = static_cast<uint8_t>(meta >> 8);
+    record.length = length;
+    record.frame.resize(kept);
+    std::memcpy(record.frame.data(), words.data(), kept);
+  }
+
+  return result;
+}
+
+void FlightRecorder::dump(std::ostream &out) const {
+  const auto flags = out.flags();
+  const auto fill = out.fill();
+
+  for (const auto &record : records()) {
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                            record.time.time_since_epoch())
+                            .count();
+    out << std::dec << micros / 1000000 << '.' << std::setfill('0')
+        << std::setw(6) << micros % 1000000 << ' ' << toString(record.direction);
+
+    if (record.errorCode != 0)
+      out << ' '
+          << utils::mbErrorCodeToStr(
+                 static_cast<utils::MBErrorCode>(record.errorCode));
+
+    if (record.direction != Error) {
+      out << " [" << record.length << ']' << std::hex;
+      for (const auto byte : record.frame)
+        out << ' ' << std::setw(2) << static_cast<int>(byte);
+      if (record.length > record.frame.size())
+        out << " ...";
+    }
+    out << '\n';
+  }
+
+  out.flags(flags);
+  out.fill(fill);
+}
@@ -0,0 +1,104 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "modbusBatch.hpp"
+
+#include <algorithm>
+
+using namespace MB;
+
+std::size_t MB::decodeResponses(std::span<const std::span<const uint8_t>> frames,
+                                ResponseBatch &batch, bool CRC) {
+  const auto n = frames.size();
+  batch.resize(n);
+
+  // Gather headers into columns. Until validation, addresses hold bytes 2-3,
+  // counts hold bytes 4-5 and payloadOffsets hold (clamped) frame size
+  for (std::size_t i = 0; i < n; i++) {
+    const auto &frame = frames[i];
+    const auto size = frame.size();
+    uint8_t header[6] = {};
+    std::copy_n(frame.begin(), std::min<std::size_t>(size, 6), header);
+
+    batch.slaveIDs[i] = header[0];
+    batch.functionCodes[i] = static_cast<utils::MBFunctionCode>(header[1]);
+    batch.addresses[i] = utils::bigEndianConv(&header[2]);
+    batch.counts[i] = utils::bigEndianConv(&header[4]);
+    batch.payloadOffsets[i] =
+        static_cast<uint16_t>(std::min<std::size_t>(size, 0xFFFF));
+  }
+
+  // Validate, branch free so that it can be vectorized. Columns are accessed
+  // through restrict pointers, otherwise uint8_t stores alias everything
+  auto *__restrict functionCodes =
+      reinterpret_cast<uint8_t *>(batch.functionCodes.data());
+  auto *__restrict addresses = batch.addresses.data();
+  auto *__restrict counts = batch.counts.data();
+  auto *__restrict payloadOffsets = batch.payloadOffsets.data();
+  auto *__restrict statuses = batch.statuses.data();
+
+  const uint32_t crcBytes = CRC ? 2 : 0;
+  for (std::size_t i = 0; i < n; i++) {
+    const uint32_t size = payloadOffsets[i];
+    const uint32_t raw = functionCodes[i];
+    const uint32_t byteCount = addresses[i] >> 8;
+
+    const uint32_t exception = raw >> 7;
+    const uint32_t code = raw & 0x7F;
+    const uint32_t readBits = (code == 0x01) | (code == 0x02);
+    const uint32_t readRegs = (code == 0x03) | (code == 0x04);
+    const uint32_t writeSingle = (code == 0x05) | (code == 0x06);
+    const uint32_t writeMultiple = (code == 0x0F) | (code == 0x10);
+    const uint32_t read = readBits | readRegs;
+    const uint32_t write = writeSingle | writeMultiple;
+
+    const uint32_t expected =
+        exception * 3 +
+        (1 - exception) * (read * (3 + byteCount) + (1 - read) * 6) + crcBytes;
+
+    const uint32_t invalid =
+        (size < 3) | (size < expected) | (exception & (byteCount == 0)) |
+        ((1 - exception) & ((1 - (read | write)) | (readRegs & byteCount)));
+    const uint32_t ok = (1 - invalid) & (1 - exception);
+
+    statuses[i] = static_cast<uint8_t>(invalid * utils::InvalidByteOrder +
+                                       (1 - invalid) * exception * byteCount);
+    functionCodes[i] = static_cast<uint8_t>(code);
+    counts[i] = static_cast<uint16_t>(
+        ok * (readBits * byteCount * 8 + readRegs * (byteCount / 2) +
+              writeSingle + writeMultiple * counts[i]));
+    addresses[i] = static_cast<uint16_t>(ok * write * addresses[i]);
+    payloadOffsets[i] = static_cast<uint16_t>(ok * (read * 3 + writeSingle * 4));
+  }
+
+  if (CRC) {
+    for (std::size_t i = 0; i < n; i++) {
+      if (batch.statuses[i] == utils::InvalidByteOrder)
+        continue;
+
+      const auto &frame = frames[i];
+      const bool exception = frame[1] & 0b10000000;
+      std::size_t crcIndex;
+      if (exception)
+        crcIndex = 3;
+      else if (batch.payloadOffsets[i] == 3)
+        crcIndex = 3 + frame[2];
+      else
+        crcIndex = 6;
+
+      const uint16_t received = static_cast<uint16_t>(
+          frame[crcIndex] | (frame[crcIndex + 1] << 8));
+      if (received != utils::calculateCRC(frame.data(), crcIndex)) {
+        batch.statuses[i] =
+            exception ? utils::ErrorCodeCRCError : utils::InvalidCRC;
+        batch.counts[i] = 0;
+        batch.addresses[i] = 0;
+        batch.payloadOffsets[i] = 0;
+      }
+    }
+  }
+
+  return static_cast<std::size_t>(
+      std::count(batch.statuses.begin(), batch.statuses.end(), ResponseBatch::Ok));
+}
@@ -0,0 +1,186 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "modbusBits.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__BMI2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace MB;
+
+void utils::unpackBits(const uint8_t *wire, std::size_t count,
+                       uint8_t *out) noexcept {
+  std::size_t i = 0;
+#if defined(__BMI2__) && defined(__x86_64__)
+  // Every byte deposits its bits into lowest bits of 8 bytes
+  for (; i + 8 <= count; i += 8) {
+    uint64_t spread = _pdep_u64(wire[i / 8], 0x0101010101010101ULL);
+    std::memcpy(out + i, &spread, 8);
+  }
+#elif defined(__SSE2__)
+  // Two bytes are broadcasted into 16 lanes and tested against lane bit
+  const auto select = _mm_set1_epi64x(static_cast<long long>(0x8040201008040201ULL));
+  const auto one = _mm_set1_epi8(1);
+  for (; i + 16 <= count; i += 16) {
+    auto data = _mm_set_epi64x(
+        static_cast<long long>(wire[i / 8 + 1] * 0x0101010101010101ULL),
+        static_cast<long long>(wire[i / 8] * 0x0101010101010101ULL));
+    auto bits = _mm_cmpeq_epi8(_mm_and_si128(data, select), select);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                     _mm_and_si128(bits, one));
+  }
+#endif
+  for (; i < count; i++)
+    out[i] = (wire[i / 8] >> (i % 8)) & 1;
+}
+
+void utils::packBits(const uint8_t *bytes, std::size_t count,
+                     uint8_t *wire) noexcept {
+  std::size_t i = 0;
+#if defined(__SSE2__)
+  // Non zero bytes are turned into sign bits and gathered with movemask
+  const auto zero = _mm_setzero_si128();
+  for (; i + 16 <= count; i += 16) {
+    auto data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+    auto mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(data, zero));
+    wire[i / 8] = static_cast<uint8_t>(mask);
+    wire[i / 8 + 1] = static_cast<uint8_t>(mask >> 8);
+  }
+#endif
+  for (; i < count; i += 8) {
+    uint8_t byte = 0;
+    for (std::size_t b = 0; b < 8 && i + b < count; b++)
+      byte |= static_cast<uint8_t>((bytes[i + b] != 0) << b);
+    wire[i / 8] = byte;
+  }
+}
+
+void utils::unpackCoils(const uint8_t *wire, std::size_t count,
+                        ModbusCell *cells) {
+  uint8_t chunk[256];
+  for (std::size_t i = 0; i < count; i += sizeof(chunk)) {
+    auto length = std::min(sizeof(chunk), count - i);
+    unpackBits(wire + i / 8, length, chunk);
+    for (std::size_t k = 0; k < length; k++)
+      cells[i + k] = ModbusCell::initCoil(chunk[k]);
+  }
+}
+
+void utils::packCoils(const ModbusCell *cells, std::size_t count,
+                      uint8_t *wire) {
+  uint8_t chunk[256];
+  for (std::size_t i = 0; i < count; i += sizeof(chunk)) {
+    auto length = std::min(sizeof(chunk), count - i);
+    for (std::size_t k = 0; k < length; k++)
+      chunk[k] = cells[i + k].coil();
+    packBits(chunk, length, wire + i / 8);
+  }
+}
+
+BitArray BitArray::fromWire(std::span<const uint8_t> wire, std::size_t count) {
+  if (wire.size() < utils::bitsBytes(count))
+    throw std::out_of_range("Not enough bytes for requested coils");
+
+  BitArray result(count);
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(result._words.data(), wire.data(), utils::bitsBytes(count));
+  } else {
+    for (std::size_t i = 0; i < utils::bitsBytes(count); i++)
+      result._words[i / 8] |= uint64_t(wire[i]) << (8 * (i % 8));
+  }
+  result.clearTail();
+  return result;
+}
+
+BitArray BitArray::fromBytes(std::span<const uint8_t> bytes) {
+  BitArray result(bytes.size());
+  utils::packBits(bytes.data(), bytes.size(),
+                  reinterpret_cast<uint8_t *>(result._words.data()));
+  if constexpr (std::endian::native != std::endian::little) {
+    for (auto &word : result._words)
+      word = __builtin_bswap64(word);
+  }
+  return result;
+}
+
+void BitArray::toWire(uint8_t *wire) const noexcept {
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(wire, _words.data(), utils::bitsBytes(_size));
+  } else {
+    for (std::size_t i = 0; i < utils::bitsBytes(_size); i++)
+      wire[i] = static_cast<uint8_t>(_words[i / 8] >> (8 * (i % 8)));
+  }
+}
+
+void BitArray::toBytes(uint8_t *bytes) const noexcept {
+  if constexpr (std::endian::native == std::endian::little) {
+    utils::unpackBits(reinterpret_cast<const uint8_t *>(_words.data()), _size,
+                      bytes);
+  } else {
+    for (std::size_t i = 0; i < _size; i++)
+      bytes[i] = test(i);
+  }
+}
+
+std::size_t BitArray::count() const noexcept {
+  std::size_t result = 0;
+  for (auto word : _words)
+    result += static_cast<std::size_t>(std::popcount(word));
+  return result;
+}
+
+std::size_t BitArray::count(std::size_t first,
+                            std::size_t length) const noexcept {
+  if (length == 0)
+    return 0;
+
+  const auto last = first + length - 1;
+  const auto firstWord = first / 64;
+  const auto lastWord = last / 64;
+  const auto headMask = ~uint64_t(0) << (first % 64);
+  const auto tailMask = ~uint64_t(0) >> (63 - last % 64);
+
+  if (firstWord == lastWord)
+    return static_cast<std::size_t>(
+        std::popcount(_words[firstWord] & headMask & tailMask));
+
+  std::size_t result = static_cast<std::size_t>(
+      std::popcount(_words[firstWord] & headMask) +
+      std::popcount(_words[lastWord] & tailMask));
+  for (auto w = firstWord + 1; w < lastWord; w++)
+    result += static_cast<std::size_t>(std::popcount(_words[w]));
+  return result;
+}
+
+BitArray BitArray::range(std::size_t first, std::size_t length) const {
+  if (first + length > _size)
+    throw std::out_of_range("Range exceeds array size");
+
+  BitArray result(length);
+  const auto shift = first % 64;
+  for (std::size_t w = 0; w < result._words.size(); w++) {
+    const auto source = first / 64 + w;
+    auto word = _words[source] >> shift;
+    if (shift != 0 && source + 1 < _words.size())
+      word |= _words[source + 1] << (64 - shift);
+    result._words[w] = word;
+  }
+  result.clearTail();
+  return result;
+}
+
+BitArray BitArray::diff(const BitArray &other) const {
+  if (other._size != _size)
+    throw std::invalid_argument("Arrays have different sizes");
+
+  BitArray result(_size);
+  for (std::size_t w = 0; w < _words.size(); w++)
+    result._words[w] = _words[w] ^ other._words[w];
+  return result;
+}
@@ -0,0 +1,305 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "modbusCodec.hpp"
+
+#include <algorithm>
+
+using namespace MB;
+using namespace MB::Codec;
+
+namespace {
+// Limits of values count from Modbus specification
+uint16_t maxCount(utils::MBFunctionCode functionCode) noexcept {
+  switch (functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+    return 2000;
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters:
+    return 125;
+  case utils::WriteMultipleDiscreteOutputCoils:
+    return 1968;
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    return 123;
+  default:
+    return 1;
+  }
+}
+
+bool validCount(utils::MBFunctionCode functionCode, uint16_t count) noexcept {
+  return count != 0 && count <= maxCount(functionCode);
+}
+
+std::size_t payloadSize(utils::MBFunctionCode functionCode,
+                        uint16_t count) noexcept {
+  switch (functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+  case utils::WriteSingleDiscreteOutputCoil:
+  case utils::WriteMultipleDiscreteOutputCoils:
+    return (count + 7u) / 8u;
+  default:
+    return count * 2u;
+  }
+}
+
+void putUint16(uint8_t *buffer, uint16_t value) noexcept {
+  buffer[0] = static_cast<uint8_t>(value >> 8);
+  buffer[1] = static_cast<uint8_t>(value);
+}
+
+// Checks that raw contains whole frame of length bytes (and its CRC)
+Status checkLength(std::span<const uint8_t> raw, std::size_t length,
+                   bool CRC) noexcept {
+  if (raw.size() < length + (CRC ? 2 : 0))
+    return utils::InvalidByteOrder;
+
+  if (CRC) {
+    auto received = static_cast<uint16_t>(raw[length] | raw[length + 1] << 8);
+    if (received != utils::calculateCRC(raw.data(), length))
+      return utils::InvalidCRC;
+  }
+  return Ok;
+}
+
+// Appends CRC if needed, returns size of the whole frame
+std::size_t finish(std::span<uint8_t> out, std::size_t length,
+                   bool CRC) noexcept {
+  if (CRC) {
+    auto crc = utils::calculateCRC(out.data(), length);
+    out[length] = static_cast<uint8_t>(crc);
+    out[length + 1] = static_cast<uint8_t>(crc >> 8);
+    length += 2;
+  }
+  return length;
+}
+
+// Write single coil/register request and response look the same
+Status decodeWriteSingle(std::span<const uint8_t> raw, Frame &out,
+                         bool CRC) noexcept {
+  if (auto status = checkLength(raw, 6, CRC); status != Ok)
+    return status;
+
+  out.address = utils::bigEndianConv(&raw[2]);
+  out.count = 1;
+  if (out.functionCode == utils::WriteSingleDiscreteOutputCoil) {
+    auto value = utils::bigEndianConv(&raw[4]);
+    if (value != 0xFF00 && value != 0x0000)
+      return utils::IllegalDataValue;
+    out.payload[0] = value == 0xFF00 ? 1 : 0;
+  } else {
+    out.payload[0] = raw[4];
+    out.payload[1] = raw[5];
+  }
+  return Ok;
+}
+
+void encodeWriteSingle(const Frame &frame, uint8_t *out) noexcept {
+  putUint16(out + 2, frame.address);
+  if (frame.functionCode == utils::WriteSingleDiscreteOutputCoil) {
+    putUint16(out + 4, frame.coil(0) ? 0xFF00 : 0x0000);
+  } else {
+    out[4] = frame.payload[0];
+    out[5] = frame.payload[1];
+  }
+}
+} // namespace
+
+Status Codec::decodeRequest(std::span<const uint8_t> raw, Frame &out,
+                            bool CRC) noexcept {
+  if (raw.size() < 2)
+    return utils::InvalidByteOrder;
+
+  out.slaveId = raw[0];
+  out.functionCode = static_cast<utils::MBFunctionCode>(raw[1]);
+
+  switch (out.functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters:
+    if (auto status = checkLength(raw, 6, CRC); status != Ok)
+      return status;
+    out.address = utils::bigEndianConv(&raw[2]);
+    out.count = utils::bigEndianConv(&raw[4]);
+    if (!validCount(out.functionCode, out.count))
+      return utils::IllegalDataValue;
+    return Ok;
+  case utils::WriteSingleDiscreteOutputCoil:
+  case utils::WriteSingleAnalogOutputRegister:
+    return decodeWriteSingle(raw, out, CRC);
+  case utils::WriteMultipleDiscreteOutputCoils:
+  case utils::WriteMultipleAnalogOutputHoldingRegisters: {
+    if (raw.size() < 7)
+      return utils::InvalidByteOrder;
+    const uint8_t bytes = raw[6];
+    out.address = utils::bigEndianConv(&raw[2]);
+    out.count = utils::bigEndianConv(&raw[4]);
+    if (!validCount(out.functionCode, out.count) ||
+        bytes != payloadSize(out.functionCode, out.count))
+      return utils::IllegalDataValue;
+
+    if (auto status = checkLength(raw, 7u + bytes, CRC); status != Ok)
+      return status;
+    std::copy_n(&raw[7], bytes, out.payload.begin());
+    return Ok;
+  }
+  default:
+    return utils::IllegalFunction;
+  }
+}
+
+Status Codec::decodeResponse(std::span<const uint8_t> raw, Frame &out,
+                             bool CRC) noexcept {
+  if (raw.size() < 2)
+    return utils::InvalidByteOrder;
+
+  out.slaveId = raw[0];
+  out.functionCode = static_cast<utils::MBFunctionCode>(raw[1] & 0x7F);
+
+  if (raw[1] & 0x80) {
+    if (auto status = checkLength(raw, 3, CRC); status != Ok)
+      return status;
+    if (raw[2] == Ok)
+      return utils::InvalidByteOrder;
+    return raw[2];
+  }
+
+  switch (out.functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters: {
+    if (raw.size() < 3)
+      return utils::InvalidByteOrder;
+    const uint8_t bytes = raw[2];
+    if (auto status = checkLength(raw, 3u + bytes, CRC); status != Ok)
+      return status;
+
+    const bool coils = out.functionCode == utils::ReadDiscreteOutputCoils ||
+                       out.functionCode == utils::ReadDiscreteInputContacts;
+    // Coil responses do not say how many coils were requested
+    out.address = 0;
+    out.count = static_cast<uint16_t>(coils ? bytes * 8 : bytes / 2);
+    if (bytes == 0 || bytes > MaxPayloadSize || (!coils && bytes % 2 != 0))
+      return utils::IllegalDataValue;
+    std::copy_n(&raw[3], bytes, out.payload.begin());
+    return Ok;
+  }
+  case utils::WriteSingleDiscreteOutputCoil:
+  case utils::WriteSingleAnalogOutputRegister:
+    return decodeWriteSingle(raw, out, CRC);
+  case utils::WriteMultipleDiscreteOutputCoils:
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    if (auto status = checkLength(raw, 6, CRC); status != Ok)
+      return status;
+    out.address = utils::bigEndianConv(&raw[2]);
+    out.count = utils::bigEndianConv(&raw[4]);
+    if (!validCount(out.functionCode, out.count))
+      return utils::IllegalDataValue;
+    return Ok;
+  default:
+    return utils::IllegalFunction;
+  }
+}
+
+std::size_t Codec::encodeRequest(const Frame &frame, std::span<uint8_t> out,
+                                 bool CRC) noexcept {
+  std::size_t length;
+  switch (frame.functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters:
+  case utils::WriteSingleDiscreteOutputCoil:
+  case utils::WriteSingleAnalogOutputRegister:
+    length = 6;
+    break;
+  case utils::WriteMultipleDiscreteOutputCoils:
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    length = 7 + payloadSize(frame.functionCode, frame.count);
+    break;
+  default:
+    return 0;
+  }
+  if (!validCount(frame.functionCode, frame.count) ||
+      out.size() < length + (CRC ? 2 : 0))
+    return 0;
+
+  out[0] = frame.slaveId;
+  out[1] = frame.functionCode;
+  switch (frame.functionCode) {
+  case utils::WriteSingleDiscreteOutputCoil:
+  case utils::WriteSingleAnalogOutputRegister:
+    encodeWriteSingle(frame, out.data());
+    break;
+  case utils::WriteMultipleDiscreteOutputCoils:
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    out[6] = static_cast<uint8_t>(length - 7);
+    std::copy_n(frame.payload.begin(), length - 7, &out[7]);
+    [[fallthrough]];
+  default:
+    putUint16(&out[2], frame.address);
+    putUint16(&out[4], frame.count);
+    break;
+  }
+  return finish(out, length, CRC);
+}
+
+std::size_t Codec::encodeResponse(const Frame &frame, std::span<uint8_t> out,
+                                  bool CRC) noexcept {
+  std::size_t length;
+  switch (frame.functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters:
+    length = 3 + payloadSize(frame.functionCode, frame.count);
+    break;
+  case utils::WriteSingleDiscreteOutputCoil:
+  case utils::WriteSingleAnalogOutputRegister:
+  case utils::WriteMultipleDiscreteOutputCoils:
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    length = 6;
+    break;
+  default:
+    return 0;
+  }
+  if (!validCount(frame.functionCode, frame.count) ||
+      out.size() < length + (CRC ? 2 : 0))
+    return 0;
+
+  out[0] = frame.slaveId;
+  out[1] = frame.functionCode;
+  switch (frame.functionCode) {
+  case utils::WriteSingleDiscreteOutputCoil:
+  case utils::WriteSingleAnalogOutputRegister:
+    encodeWriteSingle(frame, out.data());
+    break;
+  case utils::WriteMultipleDiscreteOutputCoils:
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    putUint16(&out[2], frame.address);
+    putUint16(&out[4], frame.count);
+    break;
+  default:
+    out[2] = static_cast<uint8_t>(length - 3);
+    std::copy_n(frame.payload.begin(), length - 3, &out[3]);
+    break;
+  }
+  return finish(out, length, CRC);
+}
+
+std::size_t Codec::encodeException(uint8_t slaveId,
+                                   utils::MBFunctionCode functionCode,
+                                   utils::MBErrorCode errorCode,
+                                   std::span<uint8_t> out, bool CRC) noexcept {
+  if (out.size() < 3u + (CRC ? 2 : 0))
+    return 0;
+
+  out[0] = slaveId;
+  out[1] = static_cast<uint8_t>(functionCode | 0x80);
+  out[2] = errorCode;
+  return finish(out, 3, CRC);
+}
@@ -3,17 +3,22 @@
 // Licensed under: MIT License <http://opensource.org/licenses/MIT>
 
 #include "modbusException.hpp"
+#include "modbusStats.hpp"
+
+#include <algorithm>
+#include <charconv>
 
 using namespace MB;
 
 // Construct Modbus exception from raw data
-ModbusException::ModbusException(const std::vector<uint8_t> &inputData,
+ModbusException::ModbusException(std::span<const uint8_t> inputData,
                                  bool CRC) noexcept {
   if (inputData.size() != ((CRC) ? 5 : 3)) {
     _slaveId = 0xFF;
     _functionCode = utils::Undefined;
     _validSlave = false;
     _errorCode = utils::InvalidByteOrder;
+    formatMessage();
     return;
   }
 
@@ -30,27 +35,43 @@ ModbusException::ModbusException(const std::vector<uint8_t> &inputData,
       _errorCode = utils::ErrorCodeCRCError;
     }
   }
+  formatMessage();
 }
 
-// Returns string representation of exception
-std::string ModbusException::toString() const noexcept {
-  std::string res;
-  res += "Error on slave ";
-  if (_validSlave)
-    res += std::to_string(_slaveId);
-  else
-    res += "Unknown";
-  res += " - ";
-  res += utils::mbErrorCodeToStr(_errorCode);
+std::size_t ModbusException::format(std::span<char> buffer) const noexcept {
+  std::size_t size = 0;
+  const auto append = [&](std::string_view text) {
+    const auto count = std::min(text.size(), buffer.size() - size);
+    std::memcpy(buffer.data() + size, text.data(), count);
+    size += count;
+  };
+
+  append("Error on slave ");
+  if (_validSlave) {
+    char number[3];
+    const auto end = std::to_chars(number, number + sizeof(number), _slaveId).ptr;
+    append(std::string_view(number, end - number));
+  } else {
+    append("Unknown");
+  }
+  append(" - ");
+  append(utils::mbErrorCodeName(_errorCode));
   if (_functionCode != MB::utils::Undefined) {
-    res += " ( on function: ";
-    res += utils::mbFunctionToStr(_functionCode);
-    res += " )";
+    append(" ( on function: ");
+    append(utils::mbFunctionName(_functionCode));
+    append(" )");
   }
-  return res;
+  return size;
+}
+
+// Returns string representation of exception
+std::string ModbusException::toString() const noexcept {
+  std::array<char, MaxMessageSize> buffer;
+  return std::string(buffer.data(), format(buffer));
 }
 
 std::vector<uint8_t> ModbusException::toRaw() const noexcept {
+  MODBUS_STATS_SCOPE(Stats::Encode);
   std::vector<uint8_t> result(3);
 
   result[0] = _slaveId;
@@ -0,0 +1,243 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "modbusLogger.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory_resource>
+
+using namespace MB;
+
+namespace {
+std::string_view toString(Logger::Level level) {
+  switch (level) {
+  case Logger::Debug:
+    return "DEBUG";
+  case Logger::Info:
+    return "INFO";
+  case Logger::Warning:
+    return "WARNING";
+  default:
+    return "ERROR";
+  }
+}
+
+// Appends to fixed buffer, truncating what does not fit
+class LineBuilder {
+private:
+  std::array<char, 1024> _buffer;
+  std::size_t _size = 0;
+
+public:
+  LineBuilder &operator<<(std::string_view text) {
+    const auto count = std::min(text.size(), _buffer.size() - _size);
+    std::memcpy(_buffer.data() + _size, text.data(), count);
+    _size += count;
+    return *this;
+  }
+
+  template <typename Integer>
+  void number(Integer value, int base = 10, int width = 0) {
+    char digits[24];
+    const auto end = std::to_chars(digits, digits + sizeof(digits), value, base).ptr;
+    for (auto length = end - digits; length < width; length++)
+      *this << "0";
+    *this << std::string_view(digits, end - digits);
+  }
+
+  //! Gives remaining space to fn, which returns number of written chars
+  template <typename Fn> void fill(Fn &&fn) {
+    _size += fn(std::span<char>(_buffer.data() + _size, _buffer.size() - _size));
+  }
+
+  [[nodiscard]] std::string_view view() const { return {_buffer.data(), _size}; }
+};
+} // namespace
+
+Logger::Logger(Sink sink, Level level, std::size_t capacity)
+    : _sink(std::move(sink)), _level(level), _queue(capacity) {
+  if (!_sink)
+    _sink = [](Level, std::string_view line) { std::clog << line << '\n'; };
+  _thread = std::thread([this] { run(); });
+}
+
+Logger::~Logger() {
+  _stop.store(true, std::memory_order_seq_cst);
+  _wakeSequence.fetch_add(1, std::memory_order_release);
+  _wakeSequence.notify_one();
+  _thread.join();
+}
+
+void Logger::push(Level level, Kind kind, Direction direction,
+                  std::span<const uint8_t> data) noexcept {
+  Record record;
+  record.time = std::chrono::system_clock::now().time_since_epoch().count();
+  record.level = level;
+  record.kind = kind;
+  record.direction = direction;
+  record.size = static_cast<uint16_t>(std::min(data.size(), MaxFrameSize));
+  std::memcpy(record.data.data(), data.data(), record.size);
+
+  if (!_queue.tryPush(std::move(record))) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Pairs with _sleeping store in run(), either the background thread sees
+  // this record or this sees it sleeping. Busy thread costs a single load.
+  _pushed.fetch_add(1, std::memory_order_seq_cst);
+  if (_sleeping.load(std::memory_order_seq_cst)) {
+    _wakeSequence.fetch_add(1, std::memory_order_release);
+    _wakeSequence.notify_one();
+  }
+}
+
+void Logger::request(Level level, Direction direction,
+                     std::span<const uint8_t> pdu) noexcept {
+  if (enabled(level))
+    push(level, Request, direction, pdu);
+}
+
+void Logger::response(Level level, Direction direction,
+                      std::span<const uint8_t> pdu) noexcept {
+  if (enabled(level))
+    push(level, Response, direction, pdu);
+}
+
+void Logger::request(Level level, Direction direction,
+                     const ModbusRequest &request) noexcept {
+  if (!enabled(level))
+    return;
+
+  std::array<std::byte, 1024> arena;
+  std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size(),
+                                               std::pmr::null_memory_resource());
+  try {
+    push(level, Request, direction, request.toRaw(&resource));
+  } catch (...) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Logger::response(Level level, Direction direction,
+                      const ModbusResponse &response) noexcept {
+  if (!enabled(level))
+    return;
+
+  std::array<std::byte, 1024> arena;
+  std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size(),
+                                               std::pmr::null_memory_resource());
+  try {
+    push(level, Response, direction, response.toRaw(&resource));
+  } catch (...) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Logger::exception(Level level, const ModbusException &exception) noexcept {
+  if (!enabled(level))
+    return;
+
+  const std::array<uint8_t, 3> data = {
+      exception.slaveID(), static_cast<uint8_t>(exception.functionCode()),
+      static_cast<uint8_t>(exception.getErrorCode())};
+  push(level, Exception, None, data);
+}
+
+void Logger::message(Level level, std::string_view text) noexcept {
+  if (enabled(level))
+    push(level, Text, None,
+         std::span(reinterpret_cast<const uint8_t *>(text.data()), text.size()));
+}
+
+void Logger::flush() const {
+  const auto target = _pushed.load(std::memory_order_acquire);
+  _flushers.fetch_add(1, std::memory_order_seq_cst);
+  auto written = _written.load(std::memory_order_seq_cst);
+  while (written < target) {
+    _written.wait(written, std::memory_order_acquire);
+    written = _written.load(std::memory_order_acquire);
+  }
+  _flushers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Logger::run() {
+  uint64_t written = 0;
+  while (true) {
+    // Stop is checked before draining, so records pushed before stop are
+    // always written
+    const bool stop = _stop.load(std::memory_order_seq_cst);
+    while (auto record = _queue.tryPop()) {
+      write(*record);
+      // Pairs with _flushers increment in flush()
+      _written.store(++written, std::memory_order_seq_cst);
+      if (_flushers.load(std::memory_order_seq_cst) != 0)
+        _written.notify_all();
+    }
+    if (stop)
+      return;
+
+    // Record may be popped before push() counts it, so the queue is empty
+    // unless more records were counted than written
+    const auto sequence = _wakeSequence.load(std::memory_order_acquire);
+    _sleeping.store(true, std::memory_order_seq_cst);
+    if (_pushed.load(std::memory_order_seq_cst) <= written &&
+        !_stop.load(std::memory_order_seq_cst))
+      _wakeSequence.wait(sequence, std::memory_order_acquire);
+    _sleeping.store(false, std::memory_order_relaxed);
+  }
+}
+
+void Logger::write(const Record &record) {
+  LineBuilder line;
+  const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::system_clock::duration(record.time))
+                          .count();
+  line.number(micros / 1000000);
+  line << ".";
+  line.number(micros % 1000000, 10, 6);
+  line << " " << toString(record.level);
+  if (record.direction != None)
+    line << (record.direction == Tx ? " TX" : " RX");
+
+  const auto data = std::span<const uint8_t>(record.data.data(), record.size);
+  switch (record.kind) {
+  case Text:
+    line << " "
+         << std::string_view(reinterpret_cast<const char *>(data.data()),
+                             data.size());
+    break;
+  case Exception: {
+    const ModbusException exception(static_cast<utils::MBErrorCode>(data[2]),
+                                    data[0],
+                                    static_cast<utils::MBFunctionCode>(data[1]));
+    line << " ";
+    line.fill([&](std::span<char> out) { return exception.format(out); });
+    break;
+  }
+  default:
+    try {
+      const auto text =
+          record.kind == Request ? ModbusRequest::fromRaw(data).toString()
+          : ModbusException::exist(data)
+              ? ModbusException(data).toString()
+              : ModbusResponse::fromRaw(data).toString();
+      line << (record.kind == Request ? " request: " : " response: ") << text;
+    } catch (const std::exception &) {
+      line << (record.kind == Request ? " invalid request:"
+                                      : " invalid response:");
+      for (const auto byte : data) {
+        line << " ";
+        line.number(byte, 16, 2);
+      }
+    }
+    break;
+  }
+
+  _sink(record.level, line.view());
+}
@@ -0,0 +1,388 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "modbusProtocol.hpp"
+#include "modbusUtils.hpp"
+
+#include <stdexcept>
+
+using namespace MB;
+using namespace MB::Protocol;
+
+namespace {
+void appendMBAP(std::vector<uint8_t> &output, uint16_t transactionId,
+                const std::vector<uint8_t> &frame) {
+  utils::pushUint16(output, transactionId);
+  utils::pushUint16(output, 0);
+  utils::pushUint16(output, static_cast<uint16_t>(frame.size()));
+  output.insert(output.end(), frame.begin(), frame.end());
+}
+
+// Calls handle(transactionId, frame) for every complete frame in input and
+// removes them, returns false if stream does not follow MBAP
+template <typename Handler>
+bool parseMBAP(std::vector<uint8_t> &input, Handler &&handle) {
+  std::size_t offset = 0;
+  bool valid = true;
+  while (input.size() - offset > MBAPSize) {
+    const auto *header = input.data() + offset;
+    const auto transactionId = utils::bigEndianConv(header);
+    const auto length = utils::bigEndianConv(header + 4);
+    if (utils::bigEndianConv(header + 2) != 0 || length < 2 ||
+        length > MaxMBAPLength) {
+      valid = false;
+      break;
+    }
+    if (input.size() - offset < MBAPSize + length)
+      break;
+
+    handle(transactionId, std::span<const uint8_t>(header + MBAPSize, length));
+    offset += MBAPSize + length;
+  }
+
+  if (!valid)
+    input.clear();
+  else
+    input.erase(input.begin(), input.begin() + static_cast<long>(offset));
+  return valid;
+}
+
+bool knownFunction(utils::MBFunctionCode functionCode) {
+  switch (functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters:
+  case utils::WriteSingleDiscreteOutputCoil:
+  case utils::WriteSingleAnalogOutputRegister:
+  case utils::WriteMultipleDiscreteOutputCoils:
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Length of RTU response (with CRC) at the front of input, 0 if not known yet
+std::size_t rtuResponseLength(const std::vector<uint8_t> &input) {
+  if (input.size() < 2)
+    return 0;
+  if (input[1] & 0x80)
+    return 5;
+
+  switch (input[1]) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters:
+    return input.size() < 3 ? 0 : 5u + input[2];
+  default:
+    return 8;
+  }
+}
+
+// Length of RTU request (with CRC) at the front of input, 0 if not known yet
+std::size_t rtuRequestLength(std::span<const uint8_t> input) {
+  if (input.size() < 2)
+    return 0;
+
+  switch (input[1]) {
+  case utils::WriteMultipleDiscreteOutputCoils:
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    return input.size() < 7 ? 0 : 9u + input[6];
+  default:
+    return 8;
+  }
+}
+
+void appendCRC(std::vector<uint8_t> &frame) {
+  const auto crc = utils::calculateCRC(frame);
+  frame.push_back(static_cast<uint8_t>(crc));
+  frame.push_back(static_cast<uint8_t>(crc >> 8));
+}
+} // namespace
+
+uint16_t TCPClient::send(const ModbusRequest &request, Clock::time_point now,
+                         Clock::duration timeout) {
+  if (_transactions.size() > UINT16_MAX)
+    throw std::runtime_error("All transaction ids are in use");
+  while (_transactions.contains(_nextId))
+    _nextId++;
+
+  // Idle wheel is moved to now, so it does not have to catch up later
+  if (_timers.empty())
+    _timers.advance(now, [](uint16_t) {});
+
+  const auto transactionId = _nextId++;
+  appendMBAP(_output.data(), transactionId, request.toRaw());
+  _transactions.emplace(
+      transactionId,
+      Transaction{request, _timers.schedule(now + timeout, transactionId)});
+  return transactionId;
+}
+
+void TCPClient::receive(std::span<const uint8_t> data) {
+  _input.insert(_input.end(), data.begin(), data.end());
+
+  bool valid = parseMBAP(_input, [this](uint16_t id, auto frame) {
+    handleFrame(id, frame);
+  });
+  if (!valid)
+    failAll(utils::ProtocolError);
+}
+
+void TCPClient::handleFrame(uint16_t transactionId,
+                            std::span<const uint8_t> frame) {
+  auto transaction = _transactions.find(transactionId);
+  if (transaction == _transactions.end())
+    return;
+
+  Completion completion{transactionId, std::nullopt, std::nullopt};
+  try {
+    if (ModbusException::exist(frame)) {
+      completion.error = ModbusException(frame);
+    } else {
+      auto response = ModbusResponse::fromRaw(frame);
+      response.from(transaction->second.request);
+      completion.response = std::move(response);
+    }
+  } catch (const ModbusException &ex) {
+    completion.error = ex;
+  }
+
+  _timers.cancel(transaction->second.timer);
+  _transactions.erase(transaction);
+  _events.push_back(std::move(completion));
+}
+
+void TCPClient::failAll(utils::MBErrorCode errorCode) {
+  for (const auto &[id, transaction] : _transactions) {
+    _events.push_back(Completion{
+        id, std::nullopt,
+        ModbusException(errorCode, transaction.request.slaveID(),
+                        transaction.request.functionCode())});
+  }
+  _transactions.clear();
+  _timers.clear();
+}
+
+std::optional<Clock::time_point> TCPClient::nextDeadline() const {
+  return _timers.nextDeadline();
+}
+
+void TCPClient::onTimer(Clock::time_point now) {
+  _timers.advance(now, [this](uint16_t transactionId) {
+    auto transaction = _transactions.find(transactionId);
+    const auto &request = transaction->second.request;
+    _events.push_back(Completion{transactionId, std::nullopt,
+                                 ModbusException(utils::Timeout,
+                                                 request.slaveID(),
+                                                 request.functionCode())});
+    _transactions.erase(transaction);
+  });
+}
+
+std::optional<Completion> TCPClient::nextEvent() {
+  if (_events.empty())
+    return std::nullopt;
+  auto event = std::move(_events.front());
+  _events.pop_front();
+  return event;
+}
+
+void TCPServer::receive(std::span<const uint8_t> data) {
+  _input.insert(_input.end(), data.begin(), data.end());
+
+  bool valid = parseMBAP(_input, [this](uint16_t id, auto frame) {
+    Incoming incoming{id, std::nullopt, std::nullopt};
+    try {
+      incoming.request = ModbusRequest::fromRaw(frame);
+    } catch (const ModbusException &) {
+      // Error is meant to be sent back, so it uses standard codes only
+      const auto functionCode = static_cast<utils::MBFunctionCode>(frame[1]);
+      incoming.error = ModbusException(knownFunction(functionCode)
+                                           ? utils::IllegalDataValue
+                                           : utils::IllegalFunction,
+                                       frame[0], functionCode);
+    }
+    _events.push_back(std::move(incoming));
+  });
+  if (!valid)
+    _events.push_back(Incoming{0, std::nullopt,
+                               ModbusException(utils::ProtocolError)});
+}
+
+std::optional<Incoming> TCPServer::nextEvent() {
+  if (_events.empty())
+    return std::nullopt;
+  auto event = std::move(_events.front());
+  _events.pop_front();
+  return event;
+}
+
+void TCPServer::write(uint16_t transactionId,
+                      const std::vector<uint8_t> &frame) {
+  appendMBAP(_output.data(), transactionId, frame);
+}
+
+void TCPServer::respond(uint16_t transactionId,
+                        const ModbusResponse &response) {
+  write(transactionId, response.toRaw());
+}
+
+void TCPServer::respond(uint16_t transactionId,
+                        const ModbusException &exception) {
+  write(transactionId, exception.toRaw());
+}
+
+uint16_t RTUClient::send(const ModbusRequest &request, Clock::time_point now,
+                         Clock::duration timeout) {
+  const auto id = _nextId++;
+  _queue.push_back(Transaction{id, request, timeout});
+  startNext(now);
+  return id;
+}
+
+void RTUClient::startNext(Clock::time_point now) {
+  if (_active || _queue.empty())
+    return;
+
+  auto frame = _queue.front().request.toRaw();
+  appendCRC(frame);
+
+  auto &output = _output.data();
+  output.insert(output.end(), frame.begin(), frame.end());
+  _active = true;
+  _deadline = now + _queue.front().timeout;
+  _input.clear();
+}
+
+void RTUClient::complete(Completion completion, Clock::time_point now) {
+  _events.push_back(std::move(completion));
+  _queue.pop_front();
+  _active = false;
+  startNext(now);
+}
+
+void RTUClient::receive(std::span<const uint8_t> data, Clock::time_point now) {
+  if (!_active)
+    return;
+
+  _input.insert(_input.end(), data.begin(), data.end());
+  const auto length = rtuResponseLength(_input);
+  if (length == 0 || _input.size() < length)
+    return;
+
+  const auto &transaction = _queue.front();
+  const auto &request = transaction.request;
+  const auto frame = std::span<const uint8_t>(_input.data(), length);
+  Completion completion{transaction.id, std::nullopt, std::nullopt};
+  try {
+    if (frame[0] != request.slaveID())
+      throw ModbusException(utils::InvalidByteOrder, frame[0]);
+
+    if (ModbusException::exist(frame)) {
+      completion.error = ModbusException(frame, true);
+    } else {
+      auto response = ModbusResponse::fromRawCRC(frame);
+      response.from(request);
+      completion.response = std::move(response);
+    }
+  } catch (const ModbusException &ex) {
+    completion.error = ex;
+  }
+  complete(std::move(completion), now);
+}
+
+std::optional<Clock::time_point> RTUClient::nextDeadline() const {
+  if (!_active)
+    return std::nullopt;
+  return _deadline;
+}
+
+void RTUClient::onTimer(Clock::time_point now) {
+  if (!_active || now < _deadline)
+    return;
+
+  const auto &transaction = _queue.front();
+  Completion completion{transaction.id, std::nullopt, std::nullopt};
+  if (transaction.request.slaveID() != 0)
+    completion.error = ModbusException(utils::Timeout,
+                                       transaction.request.slaveID(),
+                                       transaction.request.functionCode());
+  complete(std::move(completion), now);
+}
+
+std::optional<Completion> RTUClient::nextEvent() {
+  if (_events.empty())
+    return std::nullopt;
+  auto event = std::move(_events.front());
+  _events.pop_front();
+  return event;
+}
+
+void RTUServer::receive(std::span<const uint8_t> data) {
+  _input.insert(_input.end(), data.begin(), data.end());
+
+  std::size_t offset = 0;
+  while (_input.size() - offset >= 2) {
+    const auto *frame = _input.data() + offset;
+    const auto functionCode = static_cast<utils::MBFunctionCode>(frame[1]);
+    if (!knownFunction(functionCode)) {
+      _events.push_back(Incoming{
+          0, std::nullopt,
+          ModbusException(utils::IllegalFunction, frame[0], functionCode)});
+      _input.clear();
+      return;
+    }
+
+    const auto length = rtuRequestLength(
+        std::span<const uint8_t>(frame, _input.size() - offset));
+    if (length == 0 || _input.size() - offset < length)
+      break;
+
+    const auto crc = static_cast<uint16_t>(frame[length - 2] |
+                                           frame[length - 1] << 8);
+    if (crc != utils::calculateCRC(frame, length - 2)) {
+      // Framing is lost, line resynchronizes on the next silence
+      _input.clear();
+      return;
+    }
+
+    Incoming incoming{0, std::nullopt, std::nullopt};
+    try {
+      incoming.request = ModbusRequest::fromRaw(
+          std::span<const uint8_t>(frame, length - 2));
+    } catch (const ModbusException &) {
+      incoming.error =
+          ModbusException(utils::IllegalDataValue, frame[0], functionCode);
+    }
+    _events.push_back(std::move(incoming));
+    offset += length;
+  }
+
+  _input.erase(_input.begin(), _input.begin() + static_cast<long>(offset));
+}
+
+std::optional<Incoming> RTUServer::nextEvent() {
+  if (_events.empty())
+    return std::nullopt;
+  auto event = std::move(_events.front());
+  _events.pop_front();
+  return event;
+}
+
+void RTUServer::write(std::vector<uint8_t> frame) {
+  appendCRC(frame);
+  auto &output = _output.data();
+  output.insert(output.end(), frame.begin(), frame.end());
+}
+
+void RTUServer::respond(const ModbusResponse &response) {
+  write(response.toRaw());
+}
+
+void RTUServer::respond(const ModbusException &exception) {
+  write(exception.toRaw());
+}
@@ -3,9 +3,10 @@
 // Licensed under: MIT License <http://opensource.org/licenses/MIT>
 
 #include "modbusRequest.hpp"
+#include "modbusBits.hpp"
+#include "modbusStats.hpp"
 #include "modbusUtils.hpp"
 
-#include <sstream>
 #include <algorithm>
 
 using namespace MB;
@@ -13,9 +14,10 @@ using namespace MB;
 ModbusRequest::ModbusRequest(uint8_t slaveId,
                              utils::MBFunctionCode functionCode,
                              uint16_t address, uint16_t registersNumber,
-                             std::vector<ModbusCell> values) noexcept
+                             ModbusCells values,
+                             std::pmr::memory_resource *resource) noexcept
     : _slaveID(slaveId), _functionCode(functionCode), _address(address),
-      _registersNumber(registersNumber), _values(std::move(values)) {
+      _registersNumber(registersNumber), _values(std::move(values), resource) {
   // Force proper modbuscell type
   switch (functionRegisters()) {
   case utils::OutputCoils:
@@ -31,7 +33,10 @@ ModbusRequest::ModbusRequest(uint8_t slaveId,
   }
 }
 
-ModbusRequest::ModbusRequest(const std::vector<uint8_t> &inputData, bool CRC) {
+ModbusRequest::ModbusRequest(std::span<const uint8_t> inputData, bool CRC,
+                             std::pmr::memory_resource *resource)
+    : _values(resource) {
+  MODBUS_STATS_SCOPE(Stats::Parse);
   try {
     if (inputData.size() < 3)
       throw ModbusException(utils::InvalidByteOrder);
@@ -41,7 +46,7 @@ ModbusRequest::ModbusRequest(const std::vector<uint8_t> &inputData, bool CRC) {
     _address = utils::bigEndianConv(&inputData[2]);
 
     int crcIndex = -1;
-    int8_t follow;
+    uint8_t follow;
 
     switch (_functionCode) {
     case utils::ReadDiscreteOutputCoils:
@@ -65,17 +70,19 @@ ModbusRequest::ModbusRequest(const std::vector<uint8_t> &inputData, bool CRC) {
     case utils::WriteMultipleDiscreteOutputCoils:
       _registersNumber = utils::bigEndianConv(&inputData[4]);
       follow = inputData[6];
-      _values = std::vector<ModbusCell>(_registersNumber);
-      for (int8_t i = 0; i < _registersNumber; i++) {
-        _values[i].coil() = inputData[7 + (i / 8)] & (1 << (i % 8));
-      }
+      if (inputData.size() < 7 + utils::bitsBytes(_registersNumber))
+        throw ModbusException(utils::InvalidByteOrder);
+      _values.resize(_registersNumber);
+      utils::unpackCoils(&inputData[7], _registersNumber, _values.data());
       crcIndex = 6 + follow + 1;
       break;
     case utils::WriteMultipleAnalogOutputHoldingRegisters:
       _registersNumber = utils::bigEndianConv(&inputData[4]);
       follow = inputData[6];
-      _values = std::vector<ModbusCell>(_registersNumber);
-      for (int8_t i = 0; i < _registersNumber; i++) {
+      if (inputData.size() < 7u + _registersNumber * 2u)
+        throw ModbusException(utils::InvalidByteOrder);
+      _values.resize(_registersNumber);
+      for (std::size_t i = 0; i < _registersNumber; i++) {
         _values[i].reg() = utils::bigEndianConv(&inputData[i * 2 + 7]);
       }
       crcIndex = 6 + follow + 1;
@@ -106,35 +113,41 @@ ModbusRequest::ModbusRequest(const std::vector<uint8_t> &inputData, bool CRC) {
 }
 
 std::string ModbusRequest::toString() const noexcept {
-  std::stringstream result;
+  std::string result;
+  result.reserve(128);
 
-  result << utils::mbFunctionToStr(_functionCode)
-         << ", from slave " + std::to_string(_slaveID);
+  result += utils::mbFunctionName(_functionCode);
+  result += ", from slave ";
+  utils::appendNumber(result, _slaveID);
 
+  result += ", starting from address ";
+  utils::appendNumber(result, _address);
   if (functionType() != utils::WriteSingle) {
-    result << ", starting from address " + std::to_string(_address)
-           << ", on " + std::to_string(_registersNumber) + " registers";
+    result += ", on ";
+    utils::appendNumber(result, _registersNumber);
+    result += " registers";
     if (functionType() == utils::WriteMultiple) {
-      result << "\n values = { ";
+      result += "\n values = { ";
       for (std::size_t i = 0; i < _values.size(); i++) {
-        result << _values[i].toString() + " , ";
+        _values[i].appendTo(result);
+        result += " , ";
         if (i >= 3) {
-          result << " , ... ";
+          result += " , ... ";
           break;
         }
       }
-      result << "}";
+      result += "}";
     }
   } else {
-    result << ", starting from address " + std::to_string(_address)
-           << "\nvalue = " + (*_values.begin()).toString();
+    result += "\nvalue = ";
+    _values.begin()->appendTo(result);
   }
 
-  return result.str();
+  return result;
 }
 
-std::vector<uint8_t> ModbusRequest::toRaw() const noexcept {
-  std::vector<uint8_t> result;
+template <typename Buffer> void ModbusRequest::writeRaw(Buffer &result) const {
+  MODBUS_STATS_SCOPE(Stats::Encode);
   result.reserve(6);
 
   result.push_back(_slaveID);
@@ -158,14 +171,9 @@ std::vector<uint8_t> ModbusRequest::toRaw() const noexcept {
         utils::pushUint16(result, value.reg());
       }
     } else {
-      size_t end = result.size() - 1;
-      for (std::size_t i = 0; i < _values.size(); i++) {
-        if (i % 8 == 0) {
-          result.push_back(0x00);
-          end++;
-        }
-        result[end] |= _values[i].coil() << (i % 8);
-      }
+      auto offset = result.size();
+      result.resize(offset + utils::bitsBytes(_values.size()));
+      utils::packCoils(_values.data(), _values.size(), &result[offset]);
     }
   } else if (functionType() == utils::WriteSingle) {
     if (_values[0].isReg()) {
@@ -175,6 +183,17 @@ std::vector<uint8_t> ModbusRequest::toRaw() const noexcept {
       result.push_back(0x00);
     }
   }
+}
+
+std::vector<uint8_t> ModbusRequest::toRaw() const noexcept {
+  std::vector<uint8_t> result;
+  writeRaw(result);
+  return result;
+}
 
+std::pmr::vector<uint8_t>
+ModbusRequest::toRaw(std::pmr::memory_resource *resource) const {
+  std::pmr::vector<uint8_t> result(resource);
+  writeRaw(result);
   return result;
 }
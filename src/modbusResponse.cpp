@@ -3,9 +3,10 @@
 // Licensed under: MIT License <http://opensource.org/licenses/MIT>
 
 #include "modbusResponse.hpp"
+#include "modbusBits.hpp"
+#include "modbusStats.hpp"
 #include "modbusUtils.hpp"
 
-#include <sstream>
 #include <algorithm>
 
 using namespace MB;
@@ -13,9 +14,10 @@ using namespace MB;
 ModbusResponse::ModbusResponse(uint8_t slaveId,
                                utils::MBFunctionCode functionCode,
                                uint16_t address, uint16_t registersNumber,
-                               const std::vector<ModbusCell> &values)
+                               const ModbusCells &values,
+                               std::pmr::memory_resource *resource)
     : _slaveID(slaveId), _functionCode(functionCode), _address(address),
-      _registersNumber(registersNumber), _values(values) {
+      _registersNumber(registersNumber), _values(values, resource) {
   // Force proper modbuscell type
   switch (functionRegisters()) {
   case utils::OutputCoils:
@@ -31,7 +33,10 @@ ModbusResponse::ModbusResponse(uint8_t slaveId,
   }
 }
 
-ModbusResponse::ModbusResponse(const std::vector<uint8_t> &inputData, bool CRC) {
+ModbusResponse::ModbusResponse(std::span<const uint8_t> inputData, bool CRC,
+                               std::pmr::memory_resource *resource)
+    : _values(resource) {
+  MODBUS_STATS_SCOPE(Stats::Parse);
   try {
     if (inputData.size() < 3)
       throw ModbusException(utils::InvalidByteOrder);
@@ -49,16 +54,18 @@ ModbusResponse::ModbusResponse(const std::vector<uint8_t> &inputData, bool CRC)
     case utils::ReadDiscreteOutputCoils:
     case utils::ReadDiscreteInputContacts:
       bytes = inputData[2];
+      if (inputData.size() < 3u + bytes)
+        throw ModbusException(utils::InvalidByteOrder);
       _registersNumber = bytes * 8;
-      _values = std::vector<ModbusCell>(_registersNumber);
-      for (auto i = 0; i < _registersNumber; i++) {
-        _values[i].coil() = inputData[3 + (i / 8)] & (1 << (i % 8));
-      }
+      _values.resize(_registersNumber);
+      utils::unpackCoils(&inputData[3], _registersNumber, _values.data());
       crcIndex = 2 + bytes + 1;
       break;
     case utils::ReadAnalogOutputHoldingRegisters:
     case utils::ReadAnalogInputRegisters:
       bytes = inputData[2];
+      if (inputData.size() < 3u + bytes)
+        throw ModbusException(utils::InvalidByteOrder);
       _registersNumber = bytes / 2;
       for (auto i = 0; i < bytes / 2; i++) {
         _values.emplace_back(utils::bigEndianConv(&inputData[3 + (i * 2)]));
@@ -110,35 +117,41 @@ ModbusResponse::ModbusResponse(const std::vector<uint8_t> &inputData, bool CRC)
 }
 
 std::string ModbusResponse::toString() const {
-  std::stringstream result;
+  std::string result;
+  result.reserve(128);
 
-  result << utils::mbFunctionToStr(_functionCode)
-         << ", from slave " + std::to_string(_slaveID);
+  result += utils::mbFunctionName(_functionCode);
+  result += ", from slave ";
+  utils::appendNumber(result, _slaveID);
 
+  result += ", starting from address ";
+  utils::appendNumber(result, _address);
   if (functionType() != utils::WriteSingle) {
-    result << ", starting from address " + std::to_string(_address)
-           << ", on " + std::to_string(_registersNumber) + " registers";
+    result += ", on ";
+    utils::appendNumber(result, _registersNumber);
+    result += " registers";
     if (functionType() == utils::WriteMultiple) {
-      result << "\n values = { ";
+      result += "\n values = { ";
       for (decltype(_values)::size_type i = 0; i < _values.size(); i++) {
-        result << _values[i].toString() + " , ";
+        _values[i].appendTo(result);
+        result += " , ";
         if (i >= 3) {
-          result << " , ... ";
+          result += " , ... ";
           break;
         }
       }
-      result << "}";
+      result += "}";
     }
   } else {
-    result << ", starting from address " + std::to_string(_address)
-           << "\nvalue = " + (*_values.begin()).toString();
+    result += "\nvalue = ";
+    _values.begin()->appendTo(result);
   }
 
-  return result.str();
+  return result;
 }
 
-std::vector<uint8_t> ModbusResponse::toRaw() const {
-  std::vector<uint8_t> result;
+template <typename Buffer> void ModbusResponse::writeRaw(Buffer &result) const {
+  MODBUS_STATS_SCOPE(Stats::Encode);
   result.reserve(6);
 
   result.push_back(_slaveID);
@@ -149,14 +162,9 @@ std::vector<uint8_t> ModbusResponse::toRaw() const {
       result.push_back(
           (_registersNumber / 8) +
           (_registersNumber % 8 == 0 ? 0 : 1)); // number of bytes to follow
-      auto end = result.size() - 1;
-      for (std::size_t i = 0; i < _values.size(); i++) {
-        if (i % 8 == 0) {
-          result.push_back(0x00);
-          end++;
-        }
-        result[end] |= _values[i].coil() << (i % 8);
-      }
+      auto offset = result.size();
+      result.resize(offset + utils::bitsBytes(_values.size()));
+      utils::packCoils(_values.data(), _values.size(), &result[offset]);
     } else {
       result.push_back(_registersNumber * 2); // number of bytes to follow
       for (auto _value : _values) {
@@ -177,10 +185,22 @@ std::vector<uint8_t> ModbusResponse::toRaw() const {
       utils::pushUint16(result, _registersNumber);
     }
   }
+}
 
+std::vector<uint8_t> ModbusResponse::toRaw() const {
+  std::vector<uint8_t> result;
+  writeRaw(result);
   return result;
 }
 
+std::pmr::vector<uint8_t>
+ModbusResponse::toRaw(std::pmr::memory_resource *resource) const {
+  std::pmr::vector<uint8_t> result(resource);
+  writeRaw(result);
+  return result;
+}
+
+
 void ModbusResponse::from(const ModbusRequest &req) {
   if (functionType() == utils::Read) {
     _address = req.registerAddress();
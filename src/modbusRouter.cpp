@@ -0,0 +1,73 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "modbusRouter.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+using namespace MB;
+
+void Router::add(uint8_t first, uint8_t last, Route route) {
+  if (first > last)
+    throw std::runtime_error("Invalid unit range");
+  route.id = _nextRoute++;
+  for (unsigned unit = first; unit <= last; unit++)
+    _routes[unit] = route;
+}
+
+void Router::add(uint8_t first, uint8_t last,
+                 std::shared_ptr<RegisterBank> bank) {
+  if (!bank)
+    throw std::runtime_error("Route needs a register bank");
+  add(first, last, Route{0, std::move(bank), nullptr});
+}
+
+void Router::add(uint8_t first, uint8_t last, Handler handler) {
+  if (!handler)
+    throw std::runtime_error("Route needs a handler");
+  add(first, last, Route{0, nullptr, std::move(handler)});
+}
+
+void Router::remove(uint8_t first, uint8_t last) {
+  for (unsigned unit = first; unit <= last; unit++)
+    _routes[unit] = Route{};
+}
+
+void Router::broadcast(const ModbusRequest &request) {
+  // Slaves never answer broadcasts, so reads make no sense
+  if (request.functionType() == utils::Read)
+    return;
+
+  // Units added together are served once, even when a later add() split
+  // their range
+  std::vector<bool> served(_nextRoute);
+  for (const auto &route : _routes) {
+    if (route.empty() || served[route.id])
+      continue;
+    served[route.id] = true;
+    try {
+      static_cast<void>(route.handle(request));
+    } catch (const ModbusException &) {
+      // There is no one to report the error to
+    }
+  }
+}
+
+std::optional<ModbusResponse> Router::handle(const ModbusRequest &request) {
+  const auto unit = request.slaveID();
+  if (unit == BroadcastUnit && _broadcast != RouteBroadcast) {
+    if (_broadcast == BroadcastToAll)
+      broadcast(request);
+    return std::nullopt;
+  }
+
+  const auto &route = _routes[unit];
+  if (route.empty()) {
+    if (!_unknownUnit)
+      return std::nullopt;
+    throw ModbusException(*_unknownUnit, unit, request.functionCode());
+  }
+  return route.handle(request);
+}
@@ -0,0 +1,167 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "modbusStats.hpp"
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace MB;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using Histograms = std::array<Stats::details::Histogram, Stats::StageCount>;
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<Stats::details::ThreadHistograms *> threads;
+  // Totals of threads that already exited
+  Histograms exited;
+};
+
+// Function static, so threads may record during static initialization
+Registry &registry() {
+  static Registry instance;
+  return instance;
+}
+
+// Adds from to into, into is not written by any other thread
+void merge(const Histograms &from, Histograms &into) {
+  for (std::size_t stage = 0; stage < Stats::StageCount; stage++) {
+    auto &target = into[stage];
+    const auto &source = from[stage];
+    Stats::details::add(target.sum,
+                        source.sum.load(std::memory_order_relaxed));
+    const auto max = source.max.load(std::memory_order_relaxed);
+    if (max > target.max.load(std::memory_order_relaxed))
+      target.max.store(max, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < Stats::Buckets; i++)
+      Stats::details::add(target.buckets[i],
+                          source.buckets[i].load(std::memory_order_relaxed));
+  }
+}
+
+void clear(Histograms &histograms) {
+  for (auto &histogram : histograms) {
+    histogram.sum.store(0, std::memory_order_relaxed);
+    histogram.max.store(0, std::memory_order_relaxed);
+    for (auto &bucket : histogram.buckets)
+      bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+// Reference point for converting ticks to nanoseconds
+const auto startTicks = Stats::ticks();
+const auto startTime = Clock::now();
+
+double nanosecondsPerTick() {
+#if defined(MODBUS_STATS) && (defined(__x86_64__) || defined(__i386__))
+  // Short period would make the ratio inaccurate
+  if (Clock::now() - startTime < std::chrono::milliseconds(10))
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  const auto ticks = Stats::ticks();
+  const auto time = Clock::now();
+  return static_cast<double>(
+             std::chrono::duration_cast<std::chrono::nanoseconds>(time -
+                                                                  startTime)
+                 .count()) /
+         static_cast<double>(ticks - startTicks);
+#else
+  return static_cast<double>(Clock::period::num) * 1e9 /
+         static_cast<double>(Clock::period::den);
+#endif
+}
+} // namespace
+
+Stats::details::ThreadHistograms::ThreadHistograms() {
+  auto &shared = registry();
+  std::lock_guard lock(shared.mutex);
+  shared.threads.push_back(this);
+}
+
+Stats::details::ThreadHistograms::~ThreadHistograms() {
+  auto &shared = registry();
+  std::lock_guard lock(shared.mutex);
+  merge(histograms, shared.exited);
+  std::erase(shared.threads, this);
+}
+
+double Stats::StageStats::percentile(double percent) const noexcept {
+  if (count == 0)
+    return 0;
+
+  const auto target =
+      static_cast<uint64_t>(static_cast<double>(count) * percent / 100.0);
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < Buckets; i++) {
+    seen += buckets[i];
+    if (seen > target || (seen == count && buckets[i] != 0))
+      return std::min(bucketLimits[i], max);
+  }
+  return max;
+}
+
+Stats::Snapshot Stats::snapshot() {
+  const double scale = nanosecondsPerTick();
+
+  Histograms totals;
+  {
+    auto &shared = registry();
+    std::lock_guard lock(shared.mutex);
+    merge(shared.exited, totals);
+    for (const auto *thread : shared.threads)
+      merge(thread->histograms, totals);
+  }
+
+  Snapshot result;
+  for (std::size_t stage = 0; stage < StageCount; stage++) {
+    const auto &histogram = totals[stage];
+    auto &stats = result[stage];
+
+    for (std::size_t i = 0; i < Buckets; i++) {
+      stats.buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+      stats.count += stats.buckets[i];
+      // Bucket i holds durations below 2^i ticks
+      stats.bucketLimits[i] = static_cast<double>(uint64_t(1) << i) * scale;
+    }
+
+    if (stats.count != 0)
+      stats.mean = static_cast<double>(
+                       histogram.sum.load(std::memory_order_relaxed)) *
+                   scale / static_cast<double>(stats.count);
+    stats.max =
+        static_cast<double>(histogram.max.load(std::memory_order_relaxed)) *
+        scale;
+  }
+  return result;
+}
+
+void Stats::reset() noexcept {
+  auto &shared = registry();
+  std::lock_guard lock(shared.mutex);
+  clear(shared.exited);
+  for (auto *thread : shared.threads)
+    clear(thread->histograms);
+}
+
+std::string Stats::toString(Stage stage) {
+  switch (stage) {
+  case Receive:
+    return "Receive";
+  case Framing:
+    return "Framing";
+  case Parse:
+    return "Parse";
+  case Handler:
+    return "Handler";
+  case Encode:
+    return "Encode";
+  case Send:
+    return "Send";
+  default:
+    return "Undefined";
+  }
+}
@@ -0,0 +1,282 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "registerBank.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace MB;
+
+namespace {
+// Largest quantity allowed by the specification for a single request
+uint16_t quantityLimit(utils::MBFunctionCode functionCode) {
+  switch (functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+    return 2000;
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters:
+    return 125;
+  case utils::WriteMultipleDiscreteOutputCoils:
+    return 1968;
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    return 123;
+  default:
+    return 1;
+  }
+}
+
+bool isCoilTable(utils::MBFunctionRegisters table) {
+  return table == utils::OutputCoils || table == utils::InputContacts;
+}
+} // namespace
+
+ModbusResponse RegisterBank::handle(const ModbusRequest &request) {
+  const auto functionCode = request.functionCode();
+  const auto fail = [&](utils::MBErrorCode errorCode) {
+    return ModbusException(errorCode, request.slaveID(), functionCode);
+  };
+
+  switch (functionCode) {
+  case utils::ReadDiscreteOutputCoils:
+  case utils::ReadDiscreteInputContacts:
+  case utils::ReadAnalogOutputHoldingRegisters:
+  case utils::ReadAnalogInputRegisters:
+  case utils::WriteSingleDiscreteOutputCoil:
+  case utils::WriteSingleAnalogOutputRegister:
+  case utils::WriteMultipleDiscreteOutputCoils:
+  case utils::WriteMultipleAnalogOutputHoldingRegisters:
+    break;
+  default:
+    throw fail(utils::IllegalFunction);
+  }
+
+  const auto count = request.numberOfRegisters();
+  if (count == 0 || count > quantityLimit(functionCode))
+    throw fail(utils::IllegalDataValue);
+  if (std::size_t(request.registerAddress()) + count >
+      DenseRegisterBank::MaxTableSize)
+    throw fail(utils::IllegalDataAddress);
+
+  const auto table = request.functionRegisters();
+  try {
+    if (request.functionType() == utils::Read) {
+      ModbusCells values(count);
+      read(table, request.registerAddress(),
+           std::span<ModbusCell>(values.data(), values.size()));
+      return ModbusResponse(request.slaveID(), functionCode,
+                            request.registerAddress(), count, values);
+    }
+
+    const auto &values = request.registerValues();
+    if (values.size() < count)
+      throw fail(utils::IllegalDataValue);
+    write(table, request.registerAddress(),
+          std::span<const ModbusCell>(values.data(), count));
+    if (_notifier)
+      _notifier->publish(request.slaveID(), table, request.registerAddress(),
+                         count);
+    // Write responses echo address with either value or quantity
+    return ModbusResponse(request.slaveID(), functionCode,
+                          request.registerAddress(), count, values);
+  } catch (const ModbusException &ex) {
+    // Banks report bare error codes, response needs the request context
+    throw fail(ex.getErrorCode());
+  }
+}
+
+DenseRegisterBank::DenseRegisterBank(std::size_t outputCoils,
+                                     std::size_t inputContacts,
+                                     std::size_t holdingRegisters,
+                                     std::size_t inputRegisters) {
+  if (outputCoils > MaxTableSize || inputContacts > MaxTableSize ||
+      holdingRegisters > MaxTableSize || inputRegisters > MaxTableSize)
+    throw std::runtime_error("Register bank table can not exceed 65536 values");
+
+  _coils.resize(outputCoils);
+  _contacts.resize(inputContacts);
+  _holding.resize(holdingRegisters);
+  _input.resize(inputRegisters);
+}
+
+void DenseRegisterBank::check(std::size_t tableSize, uint16_t address,
+                              std::size_t count) const {
+  if (std::size_t(address) + count > tableSize)
+    throw ModbusException(utils::IllegalDataAddress);
+}
+
+void DenseRegisterBank::read(utils::MBFunctionRegisters table, uint16_t address,
+                             std::span<ModbusCell> out) const {
+  if (isCoilTable(table)) {
+    const auto &bits = coils(table);
+    check(bits.size(), address, out.size());
+    for (std::size_t i = 0; i < out.size(); i++)
+      out[i] = ModbusCell(static_cast<bool>(bits[address + i]));
+  } else {
+    const auto words = registers(table);
+    check(words.size(), address, out.size());
+    for (std::size_t i = 0; i < out.size(); i++)
+      out[i] = ModbusCell(words[address + i]);
+  }
+}
+
+void DenseRegisterBank::write(utils::MBFunctionRegisters table,
+                              uint16_t address,
+                              std::span<const ModbusCell> values) {
+  if (isCoilTable(table)) {
+    auto &bits = coils(table);
+    check(bits.size(), address, values.size());
+    for (std::size_t i = 0; i < values.size(); i++)
+      bits[address + i] = values[i].coil();
+  } else {
+    const auto words = registers(table);
+    check(words.size(), address, values.size());
+    for (std::size_t i = 0; i < values.size(); i++)
+      words[address + i] = values[i].reg();
+  }
+}
+
+std::size_t DenseRegisterBank::size(utils::MBFunctionRegisters table) const {
+  return isCoilTable(table) ? coils(table).size() : registers(table).size();
+}
+
+std::span<uint16_t>
+DenseRegisterBank::registers(utils::MBFunctionRegisters table) {
+  switch (table) {
+  case utils::HoldingRegisters:
+    return _holding;
+  case utils::InputRegisters:
+    return _input;
+  default:
+    throw std::runtime_error("Coil table does not contain registers");
+  }
+}
+
+std::span<const uint16_t>
+DenseRegisterBank::registers(utils::MBFunctionRegisters table) const {
+  return const_cast<DenseRegisterBank *>(this)->registers(table);
+}
+
+std::vector<bool> &DenseRegisterBank::coils(utils::MBFunctionRegisters table) {
+  switch (table) {
+  case utils::OutputCoils:
+    return _coils;
+  case utils::InputContacts:
+    return _contacts;
+  default:
+    throw std::runtime_error("Register table does not contain coils");
+  }
+}
+
+const std::vector<bool> &
+DenseRegisterBank::coils(utils::MBFunctionRegisters table) const {
+  return const_cast<DenseRegisterBank *>(this)->coils(table);
+}
+
+template <typename Function>
+void SparseRegisterBank::forRange(utils::MBFunctionRegisters table,
+                                  uint16_t address, std::size_t count,
+                                  Function &&fn) const {
+  if (std::size_t(address) + count > DenseRegisterBank::MaxTableSize)
+    throw ModbusException(utils::IllegalDataAddress);
+
+  const auto &pages = this->table(table);
+  // Range is checked as a whole first, so failed writes change nothing
+  for (std::size_t first = address, end = first + count; first < end;) {
+    const auto offset = first % PageSize;
+    const auto chunk = std::min(PageSize - offset, end - first);
+    const auto &page = pages[first / PageSize];
+    if (!page)
+      throw ModbusException(utils::IllegalDataAddress);
+    if (chunk == PageSize) {
+      if (!page->defined.all())
+        throw ModbusException(utils::IllegalDataAddress);
+    } else {
+      for (std::size_t i = offset; i < offset + chunk; i++)
+        if (!page->defined.test(i))
+          throw ModbusException(utils::IllegalDataAddress);
+    }
+    first += chunk;
+  }
+
+  for (std::size_t first = address, end = first + count; first < end;) {
+    const auto offset = first % PageSize;
+    const auto chunk = std::min(PageSize - offset, end - first);
+    fn(*pages[first / PageSize], offset, chunk);
+    first += chunk;
+  }
+}
+
+void SparseRegisterBank::define(utils::MBFunctionRegisters table,
+                                uint16_t address, std::size_t count,
+                                uint16_t initial) {
+  if (std::size_t(address) + count > DenseRegisterBank::MaxTableSize)
+    throw std::runtime_error("Defined range exceeds 65536 values");
+  if (isCoilTable(table))
+    initial = initial ? 1 : 0;
+
+  auto &pages = this->table(table);
+  for (std::size_t i = address; i < address + count; i++) {
+    auto &page = pages[i / PageSize];
+    if (!page)
+      page = std::make_unique<Page>();
+    page->values[i % PageSize] = initial;
+    page->defined.set(i % PageSize);
+  }
+}
+
+void SparseRegisterBank::undefine(utils::MBFunctionRegisters table,
+                                  uint16_t address, std::size_t count) {
+  auto &pages = this->table(table);
+  const auto end = std::min(std::size_t(address) + count,
+                            DenseRegisterBank::MaxTableSize);
+  for (std::size_t i = address; i < end; i++) {
+    auto &page = pages[i / PageSize];
+    if (!page)
+      continue;
+    page->defined.reset(i % PageSize);
+    if (page->defined.none())
+      page.reset();
+  }
+}
+
+bool SparseRegisterBank::defined(utils::MBFunctionRegisters table,
+                                 uint16_t address) const {
+  const auto &page = this->table(table)[address / PageSize];
+  return page && page->defined.test(address % PageSize);
+}
+
+std::size_t SparseRegisterBank::pagesCount() const {
+  std::size_t count = 0;
+  for (const auto &pages : _tables)
+    for (const auto &page : pages)
+      count += page ? 1 : 0;
+  return count;
+}
+
+void SparseRegisterBank::read(utils::MBFunctionRegisters table,
+                              uint16_t address,
+                              std::span<ModbusCell> out) const {
+  const bool coils = isCoilTable(table);
+  auto cell = out.begin();
+  forRange(table, address, out.size(),
+           [&](const Page &page, std::size_t offset, std::size_t count) {
+             for (std::size_t i = offset; i < offset + count; i++)
+               *cell++ = coils ? ModbusCell(page.values[i] != 0)
+                               : ModbusCell(page.values[i]);
+           });
+}
+
+void SparseRegisterBank::write(utils::MBFunctionRegisters table,
+                               uint16_t address,
+                               std::span<const ModbusCell> values) {
+  const bool coils = isCoilTable(table);
+  auto cell = values.begin();
+  forRange(table, address, values.size(),
+           [&](Page &page, std::size_t offset, std::size_t count) {
+             for (std::size_t i = offset; i < offset + count; i++, cell++)
+               page.values[i] = coils ? uint16_t(cell->coil()) : cell->reg();
+           });
+}
@@ -0,0 +1,104 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/flightRecorder.hpp"
+#include "MB/modbusCodec.hpp"
+#include "MB/modbusLogger.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "allocationCounter.hpp"
+#include "gtest/gtest.h"
+
+#include <memory_resource>
+
+using namespace MB;
+
+namespace {
+constexpr int Transactions = 100;
+
+// Runs transaction once to warm up, then counts allocations of the rest
+template <typename Transaction> uint64_t steadyState(Transaction &&transaction) {
+  transaction();
+  Allocations::Counter counter;
+  for (int i = 0; i < Transactions; i++)
+    transaction();
+  return counter.count();
+}
+} // namespace
+
+TEST(Allocations, CounterCounts) {
+  Allocations::Counter counter;
+  auto value = std::make_unique<int>(1);
+  std::vector<int> values(4);
+  EXPECT_EQ(counter.count(), 2);
+  EXPECT_NE(static_cast<void *>(value.get()),
+            static_cast<void *>(values.data()));
+}
+
+TEST(Allocations, Codec) {
+  Codec::Frame read;
+  read.slaveId = 1;
+  read.functionCode = utils::ReadAnalogOutputHoldingRegisters;
+  read.count = 125;
+  for (std::size_t i = 0; i < read.count; i++)
+    read.setReg(i, static_cast<uint16_t>(i));
+
+  EXPECT_EQ(steadyState([&] {
+              Codec::Buffer buffer;
+              Codec::Frame frame;
+              const auto size = Codec::encodeResponse(read, buffer, true);
+              ASSERT_EQ(Codec::decodeResponse({buffer.data(), size}, frame, true),
+                        Codec::Ok);
+            }),
+            0);
+}
+
+TEST(Allocations, RequestAndResponse) {
+  std::array<std::byte, 4096> arena;
+  std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size(),
+                                               std::pmr::null_memory_resource());
+
+  const auto rawRequest =
+      ModbusRequest(1, utils::WriteMultipleAnalogOutputHoldingRegisters, 10, 3,
+                    {uint16_t(1), uint16_t(2), uint16_t(3)})
+          .toRaw();
+  const auto rawResponse =
+      ModbusResponse(1, utils::ReadAnalogOutputHoldingRegisters, 10, 3,
+                     {uint16_t(1), uint16_t(2), uint16_t(3)})
+          .toRaw();
+
+  EXPECT_EQ(steadyState([&] {
+              {
+                auto request = ModbusRequest::fromRaw(rawRequest, &resource);
+                auto encodedRequest = request.toRaw(&resource);
+                auto response = ModbusResponse::fromRaw(rawResponse, &resource);
+                auto encodedResponse = response.toRaw(&resource);
+                EXPECT_EQ(encodedResponse.size(), rawResponse.size());
+              }
+              resource.release();
+            }),
+            0);
+}
+
+TEST(Allocations, ExceptionMessage) {
+  const ModbusException exception(utils::Timeout, 1,
+                                  utils::ReadAnalogInputRegisters);
+  EXPECT_EQ(steadyState([&] { EXPECT_NE(exception.what()[0], '\0'); }), 0);
+}
+
+TEST(Allocations, FlightRecorderAndLogger) {
+  FlightRecorder recorder(16);
+  Logger logger([](Logger::Level, std::string_view) {}, Logger::Debug);
+  const ModbusRequest request(1, utils::ReadAnalogOutputHoldingRegisters, 0,
+                              10);
+  const auto raw = request.toRaw();
+
+  // Background thread of logger allocates, it is not counted here
+  EXPECT_EQ(steadyState([&] {
+              recorder.record(FlightRecorder::Tx, raw);
+              logger.request(Logger::Debug, Logger::Tx, request);
+              logger.exception(Logger::Error, ModbusException(utils::Timeout));
+            }),
+            0);
+}
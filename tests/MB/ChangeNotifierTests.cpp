@@ -0,0 +1,114 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/changeNotifier.hpp"
+#include "MB/registerBank.hpp"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace MB;
+
+TEST(ChangeNotifier, WritesFromRequests) {
+  auto notifier = std::make_shared<ChangeNotifier>();
+  DenseRegisterBank bank(100);
+  bank.setChangeNotifier(notifier);
+  auto subscription =
+      notifier->subscribe(ChangeRange{utils::HoldingRegisters, 10, 19});
+
+  // Outside of the range, read and direct write are not published
+  static_cast<void>(bank.handle(ModbusRequest(
+      1, utils::WriteSingleAnalogOutputRegister, 30, 1, {uint16_t(1)})));
+  static_cast<void>(
+      bank.handle(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 10, 5)));
+  const ModbusCell value(uint16_t(3));
+  bank.write(utils::HoldingRegisters, 12, std::span<const ModbusCell>(&value, 1));
+  EXPECT_FALSE(subscription->next().has_value());
+
+  static_cast<void>(bank.handle(
+      ModbusRequest(4, utils::WriteMultipleAnalogOutputHoldingRegisters, 8, 4,
+                    {uint16_t(1), uint16_t(2), uint16_t(3), uint16_t(4)})));
+  const auto change = subscription->next();
+  ASSERT_TRUE(change.has_value());
+  EXPECT_EQ(change->unit, 4);
+  // Clipped to the subscribed range
+  EXPECT_EQ(change->first, 10);
+  EXPECT_EQ(change->last, 11);
+  EXPECT_FALSE(change->coalesced);
+}
+
+TEST(ChangeNotifier, FiltersUnitsAndTables) {
+  ChangeNotifier notifier;
+  auto unit = notifier.subscribe(ChangeRange{utils::OutputCoils, 0, 0xFFFF, 7});
+  auto all = notifier.subscribe(ChangeRange{utils::OutputCoils});
+
+  notifier.publish(3, utils::OutputCoils, 5, 1);
+  notifier.publish(7, utils::HoldingRegisters, 5, 1);
+  EXPECT_FALSE(unit->next().has_value());
+  ASSERT_TRUE(all->next().has_value());
+  EXPECT_FALSE(all->next().has_value());
+
+  notifier.unsubscribe(all);
+  notifier.publish(7, utils::OutputCoils, 5, 1);
+  EXPECT_TRUE(unit->next().has_value());
+  EXPECT_FALSE(all->next().has_value());
+}
+
+TEST(ChangeNotifier, CoalescesWhenConsumerLags) {
+  ChangeNotifier notifier(2);
+  auto subscription = notifier.subscribe(ChangeRange{utils::HoldingRegisters});
+
+  for (uint16_t address = 100; address < 110; address++)
+    notifier.publish(1, utils::HoldingRegisters, address, 1);
+
+  EXPECT_EQ(subscription->next()->first, 100);
+  EXPECT_EQ(subscription->next()->first, 101);
+  const auto merged = subscription->next();
+  ASSERT_TRUE(merged.has_value());
+  EXPECT_TRUE(merged->coalesced);
+  EXPECT_EQ(merged->first, 102);
+  EXPECT_EQ(merged->last, 109);
+  EXPECT_FALSE(subscription->next().has_value());
+}
+
+TEST(ChangeNotifier, Callbacks) {
+  ChangeNotifier notifier;
+  std::atomic<int> delivered = 0;
+  std::atomic<bool> otherThread = false;
+  const auto publisher = std::this_thread::get_id();
+  notifier.subscribe(ChangeRange{utils::InputRegisters},
+                     [&](const Change &change) {
+                       otherThread = std::this_thread::get_id() != publisher;
+                       delivered += change.last - change.first + 1;
+                     });
+
+  notifier.publish(1, utils::InputRegisters, 0, 3);
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (delivered < 3 && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(delivered, 3);
+  EXPECT_TRUE(otherThread);
+}
+
+TEST(ChangeNotifier, BlockingNext) {
+  ChangeNotifier notifier;
+  auto subscription = notifier.subscribe(ChangeRange{utils::HoldingRegisters});
+
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(subscription->next(std::chrono::milliseconds(20)).has_value());
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(20));
+
+  std::thread publisher([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    notifier.publish(1, utils::HoldingRegisters, 5, 2);
+  });
+  const auto change = subscription->next(std::chrono::seconds(5));
+  publisher.join();
+  ASSERT_TRUE(change.has_value());
+  EXPECT_EQ(change->first, 5);
+  EXPECT_EQ(change->last, 6);
+}
@@ -0,0 +1,104 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/decodePool.hpp"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace MB;
+
+TEST(DecodePool, PerDeviceOrder) {
+  const uint32_t devices = 32;
+  const uint16_t frames = 200;
+
+  std::vector<std::vector<uint16_t>> received(devices);
+  std::atomic<int> errors = 0;
+
+  DecodePool pool(4);
+
+  auto callback = [&](uint32_t device, const ModbusResponse *response,
+                      std::exception_ptr error) {
+    if (error || response == nullptr) {
+      errors++;
+      return;
+    }
+    // Device callbacks are never concurrent, so no locking is needed
+    received[device].push_back(response->registerValues()[0].reg());
+  };
+
+  for (uint16_t i = 0; i < frames; i++) {
+    for (uint32_t device = 0; device < devices; device++) {
+      pool.submit(device,
+                  ModbusResponse(1, utils::ReadAnalogInputRegisters, 0, 1,
+                                 {ModbusCell::initReg(i)})
+                      .toRaw(),
+                  callback);
+    }
+  }
+  pool.drain();
+
+  EXPECT_EQ(errors, 0);
+  for (uint32_t device = 0; device < devices; device++) {
+    ASSERT_EQ(received[device].size(), frames);
+    for (uint16_t i = 0; i < frames; i++)
+      EXPECT_EQ(received[device][i], i);
+  }
+}
+
+TEST(DecodePool, Errors) {
+  DecodePool pool(2);
+
+  std::mutex mutex;
+  std::vector<utils::MBErrorCode> codes;
+
+  auto callback = [&](uint32_t, const ModbusResponse *response,
+                      std::exception_ptr error) {
+    EXPECT_EQ(response, nullptr);
+    try {
+      std::rethrow_exception(error);
+    } catch (const ModbusException &ex) {
+      std::lock_guard lock(mutex);
+      codes.push_back(ex.getErrorCode());
+    }
+  };
+
+  // Exception frame
+  pool.submit(1, {0x0A, 0x83, 0x02}, callback);
+  // Response with invalid CRC
+  pool.submit(1, {0x11, 0x04, 0x02, 0x00, 0x0A, 0xF8, 0xF5}, callback, true);
+  pool.drain();
+
+  ASSERT_EQ(codes.size(), 2);
+  EXPECT_EQ(codes[0], utils::IllegalDataAddress);
+  EXPECT_EQ(codes[1], utils::InvalidCRC);
+}
+
+TEST(DecodePool, ThrowingCallbackAndIdleStrands) {
+  DecodePool pool(2);
+  std::atomic<int> calls = 0;
+
+  for (uint32_t device = 0; device < 100; device++)
+    pool.submit(device,
+                ModbusResponse(1, utils::ReadAnalogInputRegisters, 0, 1,
+                               {ModbusCell::initReg(1)})
+                    .toRaw(),
+                [&](uint32_t, const ModbusResponse *, std::exception_ptr) {
+                  calls++;
+                  throw std::runtime_error("Callback failure");
+                });
+  pool.drain();
+
+  EXPECT_EQ(calls, 100);
+  // Strands of devices that have nothing left to decode are removed, right
+  // after their last callback returns
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (pool.strandsCount() != 0 && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::yield();
+  EXPECT_EQ(pool.strandsCount(), 0);
+}
@@ -0,0 +1,120 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/durableRegisterBank.hpp"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using namespace MB;
+
+namespace {
+// Fresh directory, removed with its content at the end of the test
+class BankDirectory {
+private:
+  std::filesystem::path _path;
+
+public:
+  explicit BankDirectory(const std::string &name)
+      : _path(std::filesystem::temp_directory_path() /
+              ("modbus-bank-" + name + "-" + std::to_string(::getpid()))) {
+    std::filesystem::remove_all(_path);
+  }
+  ~BankDirectory() { std::filesystem::remove_all(_path); }
+
+  [[nodiscard]] const std::filesystem::path &path() const { return _path; }
+};
+
+DurableOptions smallTables() {
+  DurableOptions options;
+  options.outputCoils = options.inputContacts = 64;
+  options.holdingRegisters = options.inputRegisters = 1024;
+  return options;
+}
+
+uint16_t holding(RegisterBank &bank, uint16_t address) {
+  const auto response = bank.handle(
+      ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, address, 1));
+  return response.registerValues()[0].reg();
+}
+} // namespace
+
+TEST(DurableRegisterBank, SurvivesRestart) {
+  BankDirectory directory("restart");
+  {
+    DurableRegisterBank bank(directory.path(), smallTables());
+    static_cast<void>(bank.handle(
+        ModbusRequest(1, utils::WriteMultipleAnalogOutputHoldingRegisters, 10,
+                      2, {uint16_t(100), uint16_t(200)})));
+    static_cast<void>(bank.handle(
+        ModbusRequest(1, utils::WriteSingleDiscreteOutputCoil, 5, 1, {true})));
+  }
+
+  DurableRegisterBank bank(directory.path(), smallTables());
+  EXPECT_EQ(holding(bank, 10), 100);
+  EXPECT_EQ(holding(bank, 11), 200);
+  const auto coil =
+      bank.handle(ModbusRequest(1, utils::ReadDiscreteOutputCoils, 5, 1));
+  EXPECT_TRUE(coil.registerValues()[0].coil());
+}
+
+TEST(DurableRegisterBank, GroupCommit) {
+  BankDirectory directory("group");
+  auto options = smallTables();
+  options.commitInterval = std::chrono::milliseconds(1000);
+  DurableRegisterBank bank(directory.path(), options);
+
+  std::atomic<int> durable = 0;
+  bank.whenDurable([&](bool ok) { durable += ok; });
+  // Nothing was written, so callback has been called already
+  EXPECT_EQ(durable, 1);
+
+  for (uint16_t i = 0; i < 100; i++) {
+    static_cast<void>(bank.handle(ModbusRequest(
+        1, utils::WriteSingleAnalogOutputRegister, i, 1, {uint16_t(i + 1)})));
+    bank.whenDurable([&](bool ok) { durable += ok; });
+  }
+  // Group waits for the interval, sync() commits it at once
+  bank.sync();
+  EXPECT_EQ(durable, 101);
+}
+
+TEST(DurableRegisterBank, CompactionAndTornLog) {
+  BankDirectory directory("compact");
+  auto options = smallTables();
+  options.compactBytes = 1024;
+  {
+    DurableRegisterBank bank(directory.path(), options);
+    for (uint16_t i = 0; i < 500; i++)
+      static_cast<void>(bank.handle(ModbusRequest(
+          1, utils::WriteSingleAnalogOutputRegister, i, 1, {uint16_t(i * 3)})));
+    bank.sync();
+    EXPECT_LT(std::filesystem::file_size(directory.path() / "wal"), 1024 + 64);
+  }
+
+  // Partially written record is dropped
+  {
+    std::ofstream wal(directory.path() / "wal",
+                      std::ios::binary | std::ios::app);
+    wal.write("\x02\x01\x00\x05\x00\x07", 6);
+  }
+
+  DurableRegisterBank bank(directory.path(), options);
+  EXPECT_EQ(holding(bank, 0), 0);
+  EXPECT_EQ(holding(bank, 499), 499 * 3);
+  EXPECT_EQ(holding(bank, 1), 3);
+}
+
+TEST(DurableRegisterBank, LayoutMismatch) {
+  BankDirectory directory("layout");
+  { DurableRegisterBank bank(directory.path(), smallTables()); }
+
+  auto options = smallTables();
+  options.holdingRegisters = 10;
+  EXPECT_THROW(DurableRegisterBank(directory.path(), options),
+               std::runtime_error);
+}
@@ -0,0 +1,119 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/flightRecorder.hpp"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+using namespace MB;
+
+TEST(FlightRecorder, KeepsLastFrames) {
+  FlightRecorder recorder(3);
+  EXPECT_EQ(recorder.capacity(), 4);
+  EXPECT_TRUE(recorder.records().empty());
+
+  for (uint8_t i = 0; i < 6; i++) {
+    const std::vector<uint8_t> frame(i + 1, i);
+    recorder.record(i % 2 ? FlightRecorder::Rx : FlightRecorder::Tx, frame);
+  }
+
+  const auto records = recorder.records();
+  ASSERT_EQ(records.size(), 4);
+  for (uint8_t i = 0; i < 4; i++) {
+    const auto &record = records[i];
+    EXPECT_EQ(record.direction,
+              (i + 2) % 2 ? FlightRecorder::Rx : FlightRecorder::Tx);
+    EXPECT_EQ(record.errorCode, 0);
+    EXPECT_EQ(record.length, i + 3);
+    EXPECT_EQ(record.frame, std::vector<uint8_t>(i + 3, i + 2));
+  }
+  EXPECT_LE(records.front().time, records.back().time);
+}
+
+TEST(FlightRecorder, TruncatesLongFrames) {
+  FlightRecorder recorder(1);
+  std::vector<uint8_t> frame(FlightRecorder::MaxFrameSize + 10);
+  for (std::size_t i = 0; i < frame.size(); i++)
+    frame[i] = static_cast<uint8_t>(i);
+  recorder.record(FlightRecorder::Rx, frame);
+
+  const auto records = recorder.records();
+  ASSERT_EQ(records.size(), 1);
+  EXPECT_EQ(records[0].length, frame.size());
+  EXPECT_EQ(records[0].frame,
+            std::vector<uint8_t>(frame.begin(),
+                                 frame.begin() + FlightRecorder::MaxFrameSize));
+}
+
+TEST(FlightRecorder, DumpsOnNonStandardError) {
+  FlightRecorder recorder;
+  int dumps = 0;
+  recorder.setDumpHandler(
+      [&](const FlightRecorder &dumped, const ModbusException &error) {
+        EXPECT_EQ(&dumped, &recorder);
+        EXPECT_EQ(error.getErrorCode(), utils::Timeout);
+        dumps++;
+      });
+
+  recorder.record(FlightRecorder::Tx, std::vector<uint8_t>{0x01, 0x03});
+  recorder.failure(ModbusException(utils::IllegalDataAddress));
+  EXPECT_EQ(dumps, 0);
+  recorder.failure(ModbusException(utils::Timeout));
+  EXPECT_EQ(dumps, 1);
+
+  const auto records = recorder.records();
+  ASSERT_EQ(records.size(), 3);
+  EXPECT_EQ(records[1].direction, FlightRecorder::Error);
+  EXPECT_EQ(records[1].errorCode, utils::IllegalDataAddress);
+  EXPECT_TRUE(records[1].frame.empty());
+  EXPECT_EQ(records[2].errorCode, utils::Timeout);
+}
+
+TEST(FlightRecorder, Dump) {
+  FlightRecorder recorder;
+  recorder.record(FlightRecorder::Tx, std::vector<uint8_t>{0x01, 0xAB});
+  recorder.failure(ModbusException(utils::IllegalFunction));
+
+  std::stringstream out;
+  recorder.dump(out);
+  const auto text = out.str();
+
+  const auto newline = text.find('\n');
+  ASSERT_NE(newline, std::string::npos);
+  EXPECT_NE(text.find("TX [2] 01 ab\n"), std::string::npos);
+  EXPECT_NE(text.find(" ERR " + utils::mbErrorCodeToStr(utils::IllegalFunction),
+                      newline),
+            std::string::npos);
+}
+
+TEST(FlightRecorder, ConcurrentDump) {
+  FlightRecorder recorder(16);
+  std::atomic<bool> done = false;
+
+  std::thread writer([&] {
+    std::vector<uint8_t> frame(32);
+    for (uint32_t i = 0; i < 100000; i++) {
+      std::fill(frame.begin(), frame.end(), static_cast<uint8_t>(i));
+      recorder.record(FlightRecorder::Rx, frame);
+    }
+    done = true;
+  });
+
+  // Every returned record has to be one whole frame
+  std::size_t torn = 0;
+  while (!done) {
+    for (const auto &record : recorder.records()) {
+      if (record.frame.size() != 32 ||
+          std::count(record.frame.begin(), record.frame.end(),
+                     record.frame[0]) != 32)
+        torn++;
+    }
+  }
+  writer.join();
+  EXPECT_EQ(torn, 0);
+  EXPECT_EQ(recorder.records().size(), 16);
+}
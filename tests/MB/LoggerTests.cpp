@@ -0,0 +1,106 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusLogger.hpp"
+#include "gtest/gtest.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace MB;
+
+namespace {
+struct Lines {
+  std::mutex mutex;
+  std::vector<std::string> lines;
+
+  Logger::Sink sink() {
+    return [this](Logger::Level, std::string_view line) {
+      std::lock_guard lock(mutex);
+      lines.emplace_back(line);
+    };
+  }
+};
+
+bool contains(const std::string &line, const std::string &text) {
+  return line.find(text) != std::string::npos;
+}
+} // namespace
+
+TEST(Logger, FormatsRecords) {
+  Lines lines;
+  Logger logger(lines.sink(), Logger::Debug);
+
+  ModbusRequest request(1, utils::ReadAnalogOutputHoldingRegisters, 100, 2);
+  logger.request(Logger::Debug, Logger::Tx, request);
+  logger.response(Logger::Info, Logger::Rx,
+                  std::vector<uint8_t>{0x01, 0x83, 0x02});
+  logger.response(Logger::Info, Logger::Rx, std::vector<uint8_t>{0x01});
+  logger.exception(Logger::Error,
+                   ModbusException(utils::Timeout, 1,
+                                   utils::ReadAnalogOutputHoldingRegisters));
+  logger.message(Logger::Warning, "reconnecting");
+  logger.flush();
+
+  std::lock_guard lock(lines.mutex);
+  ASSERT_EQ(lines.lines.size(), 5);
+  EXPECT_TRUE(contains(lines.lines[0], " DEBUG TX request: " + request.toString()));
+  EXPECT_TRUE(contains(lines.lines[1], " INFO RX response: Error on slave 1 - Illegal data address"));
+  EXPECT_TRUE(contains(lines.lines[2], " invalid response: 01"));
+  EXPECT_TRUE(contains(lines.lines[3], " ERROR Error on slave 1 - Timeout"));
+  EXPECT_TRUE(contains(lines.lines[4], " WARNING reconnecting"));
+}
+
+TEST(Logger, Level) {
+  Lines lines;
+  {
+    Logger logger(lines.sink(), Logger::Warning);
+    EXPECT_FALSE(logger.enabled(Logger::Info));
+    EXPECT_TRUE(logger.enabled(Logger::Error));
+
+    logger.message(Logger::Info, "ignored");
+    logger.message(Logger::Error, "logged");
+    logger.setLevel(Logger::Off);
+    EXPECT_FALSE(logger.enabled(Logger::Error));
+    logger.message(Logger::Error, "ignored");
+    // Destructor writes what is left
+  }
+
+  ASSERT_EQ(lines.lines.size(), 1);
+  EXPECT_TRUE(contains(lines.lines[0], "logged"));
+}
+
+TEST(Logger, ManyThreads) {
+  Lines lines;
+  Logger logger(lines.sink(), Logger::Debug, 1 << 14);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++)
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; i++)
+        logger.request(Logger::Debug, Logger::Rx,
+                       std::vector<uint8_t>{0x01, 0x03, 0x00, 0x00, 0x00, 0x01});
+    });
+  for (auto &thread : threads)
+    thread.join();
+  logger.flush();
+
+  std::lock_guard lock(lines.mutex);
+  EXPECT_EQ(lines.lines.size() + logger.dropped(), 4000);
+}
+
+TEST(Logger, WakesOnPush) {
+  Lines lines;
+  Logger logger(lines.sink(), Logger::Debug);
+
+  // Background thread goes to sleep between records, every push has to wake
+  // it and every flush has to be woken by it
+  for (int i = 0; i < 1000; i++) {
+    logger.message(Logger::Info, "line");
+    logger.flush();
+    std::lock_guard lock(lines.mutex);
+    ASSERT_EQ(lines.lines.size(), i + 1);
+  }
+}
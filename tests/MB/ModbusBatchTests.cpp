@@ -0,0 +1,83 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusBatch.hpp"
+#include "MB/modbusResponse.hpp"
+#include "gtest/gtest.h"
+
+using namespace MB;
+
+class ModBusBatch : public ::testing::Test {
+protected:
+  ModBusBatch() {}
+
+  // Testing data from https://www.simplymodbus.ca/
+  virtual void SetUp() {
+    frames = {
+        {0x11, 0x01, 0x05, 0xCD, 0x6B, 0xB2, 0x0E, 0x1B, 0x45, 0xE6},
+        {0x11, 0x03, 0x06, 0xAE, 0x41, 0x56, 0x52, 0x43, 0x40, 0x49, 0xAD},
+        {0x11, 0x06, 0x00, 0x01, 0x00, 0x03, 0x9A, 0x9B},
+        {0x11, 0x10, 0x00, 0x01, 0x00, 0x02, 0x12, 0x98},
+        {0x0A, 0x82, 0x02, 0xB0, 0xA3},
+        {0x11, 0x03, 0x06, 0xAE, 0x41},             // Truncated
+        {0x11, 0x04, 0x02, 0x00, 0x0A, 0xF8, 0xF5}, // Invalid CRC
+        {0x11, 0x2B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // Unknown function
+    };
+    for (const auto &frame : frames)
+      spans.emplace_back(frame);
+  }
+
+  std::vector<std::vector<uint8_t>> frames;
+  std::vector<std::span<const uint8_t>> spans;
+};
+
+TEST_F(ModBusBatch, Statuses) {
+  ResponseBatch batch;
+
+  EXPECT_EQ(decodeResponses(spans, batch, true), 4);
+  ASSERT_EQ(batch.size(), frames.size());
+
+  EXPECT_EQ(batch.statuses[0], ResponseBatch::Ok);
+  EXPECT_EQ(batch.statuses[1], ResponseBatch::Ok);
+  EXPECT_EQ(batch.statuses[2], ResponseBatch::Ok);
+  EXPECT_EQ(batch.statuses[3], ResponseBatch::Ok);
+  EXPECT_EQ(batch.statuses[4], utils::IllegalDataAddress);
+  EXPECT_EQ(batch.statuses[5], utils::InvalidByteOrder);
+  EXPECT_EQ(batch.statuses[6], utils::InvalidCRC);
+  EXPECT_EQ(batch.statuses[7], utils::InvalidByteOrder);
+
+  EXPECT_EQ(batch.slaveIDs[4], 0x0A);
+  EXPECT_EQ(batch.functionCodes[4], utils::ReadDiscreteInputContacts);
+}
+
+TEST_F(ModBusBatch, Columns) {
+  ResponseBatch batch;
+  decodeResponses(spans, batch, true);
+
+  for (std::size_t i = 0; i < 4; i++) {
+    auto response = ModbusResponse::fromRawCRC(frames[i]);
+    EXPECT_EQ(batch.slaveIDs[i], response.slaveID());
+    EXPECT_EQ(batch.functionCodes[i], response.functionCode());
+    EXPECT_EQ(batch.counts[i], response.numberOfRegisters());
+    if (response.functionType() != utils::Read) {
+      EXPECT_EQ(batch.addresses[i], response.registerAddress());
+    }
+  }
+
+  // Register values are read straight from the frame
+  ASSERT_EQ(batch.payloadOffsets[1], 3);
+  EXPECT_EQ(utils::bigEndianConv(&frames[1][batch.payloadOffsets[1] + 4]),
+            0x4340);
+  EXPECT_EQ(batch.payloadOffsets[3], 0);
+}
+
+TEST_F(ModBusBatch, WithoutCRC) {
+  ResponseBatch batch;
+
+  // Truncated frame is still too short, CRC of frame 6 is ignored
+  EXPECT_EQ(decodeResponses(spans, batch), 5);
+  EXPECT_EQ(batch.statuses[5], utils::InvalidByteOrder);
+  EXPECT_EQ(batch.statuses[6], ResponseBatch::Ok);
+  EXPECT_EQ(batch.counts[6], 1);
+}
@@ -0,0 +1,95 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusBits.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace MB;
+
+TEST(ModbusBits, PackUnpack) {
+  // Odd sizes exercise vector loops as well as scalar tails
+  for (std::size_t count : {1u, 7u, 8u, 15u, 16u, 17u, 100u, 2000u}) {
+    std::vector<uint8_t> bytes(count);
+    for (std::size_t i = 0; i < count; i++)
+      bytes[i] = (i * 7 + i / 3) % 5 == 0 ? 1 : 0;
+
+    std::vector<uint8_t> wire(utils::bitsBytes(count), 0xAA);
+    utils::packBits(bytes.data(), count, wire.data());
+
+    for (std::size_t i = 0; i < count; i++)
+      EXPECT_EQ((wire[i / 8] >> (i % 8)) & 1, bytes[i]);
+    if (count % 8 != 0) {
+      EXPECT_EQ(wire.back() >> (count % 8), 0);
+    }
+
+    std::vector<uint8_t> unpacked(count);
+    utils::unpackBits(wire.data(), count, unpacked.data());
+    EXPECT_EQ(bytes, unpacked);
+  }
+}
+
+TEST(ModbusBits, BitArray) {
+  const std::vector<uint8_t> wire = {0xCD, 0x6B, 0xB2, 0x0E, 0x1B};
+  auto bits = BitArray::fromWire(wire, 37);
+
+  EXPECT_EQ(bits.size(), 37);
+  EXPECT_TRUE(bits.test(0));
+  EXPECT_FALSE(bits.test(1));
+  EXPECT_TRUE(bits.test(36));
+  EXPECT_EQ(bits.count(), 21);
+  EXPECT_EQ(bits.count(8, 8), 5);
+  EXPECT_EQ(bits.count(3, 30), bits.range(3, 30).count());
+
+  std::vector<uint8_t> back(5);
+  bits.toWire(back.data());
+  EXPECT_EQ(back[0], 0xCD);
+  EXPECT_EQ(back[4], 0x1B & 0x1F);
+
+  auto changed = bits;
+  changed.set(0, false);
+  changed.set(22);
+  std::vector<std::size_t> indexes;
+  bits.diff(changed).forEachSet([&](std::size_t i) { indexes.push_back(i); });
+  EXPECT_EQ(indexes, (std::vector<std::size_t>{0, 22}));
+
+  std::vector<uint8_t> bytes(bits.size());
+  bits.toBytes(bytes.data());
+  EXPECT_EQ(BitArray::fromBytes(bytes), bits);
+
+  auto shifted = BitArray(200);
+  shifted.set(70);
+  shifted.set(130);
+  auto part = shifted.range(65, 100);
+  EXPECT_EQ(part.count(), 2);
+  EXPECT_TRUE(part.test(5));
+  EXPECT_TRUE(part.test(65));
+}
+
+TEST(ModbusBits, LargeCoilFrames) {
+  // 2000 coils, more than int8_t loop counter used to handle
+  std::vector<ModbusCell> values(2000);
+  for (std::size_t i = 0; i < values.size(); i++)
+    values[i] = ModbusCell::initCoil(i % 3 == 0);
+
+  ModbusRequest request(1, utils::WriteMultipleDiscreteOutputCoils, 0, 2000,
+                        values);
+  auto parsed = ModbusRequest::fromRaw(request.toRaw());
+  ASSERT_EQ(parsed.registerValues().size(), 2000);
+  for (std::size_t i = 0; i < values.size(); i++)
+    EXPECT_EQ(parsed.registerValues()[i].coil(), i % 3 == 0);
+
+  std::vector<uint8_t> raw = {0x01, 0x01, 0x02, 0x0F, 0x80};
+  auto response = ModbusResponse::fromRaw(raw);
+  EXPECT_TRUE(response.registerValues()[3].coil());
+  EXPECT_FALSE(response.registerValues()[4].coil());
+  EXPECT_TRUE(response.registerValues()[15].coil());
+  EXPECT_EQ(response.toRaw(), raw);
+
+  EXPECT_THROW(ModbusResponse::fromRaw({0x01, 0x01, 0x04, 0xFF}),
+               ModbusException);
+}
@@ -0,0 +1,102 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// These tests are also built with MODBUS_FREESTANDING, so they can not use
+// exceptions nor other parts of the core
+
+#include "MB/modbusCodec.hpp"
+#include "gtest/gtest.h"
+
+#include <array>
+
+using namespace MB;
+
+TEST(ModbusCodec, Request) {
+  const std::array<uint8_t, 8> raw = {0x01, 0x01, 0x00, 0x64,
+                                      0x00, 0x0A, 0xFD, 0xD2};
+  Codec::Frame frame;
+  EXPECT_EQ(Codec::decodeRequest(raw, frame, true), Codec::Ok);
+  EXPECT_EQ(frame.slaveId, 1);
+  EXPECT_EQ(frame.functionCode, utils::ReadDiscreteOutputCoils);
+  EXPECT_EQ(frame.address, 100);
+  EXPECT_EQ(frame.count, 10);
+
+  Codec::Buffer buffer;
+  ASSERT_EQ(Codec::encodeRequest(frame, buffer, true), raw.size());
+  EXPECT_TRUE(std::equal(raw.begin(), raw.end(), buffer.begin()));
+
+  auto corrupted = raw;
+  corrupted[7] ^= 1;
+  EXPECT_EQ(Codec::decodeRequest(corrupted, frame, true), utils::InvalidCRC);
+  EXPECT_EQ(Codec::decodeRequest(std::span(raw).first(5), frame),
+            utils::InvalidByteOrder);
+}
+
+TEST(ModbusCodec, WriteRequests) {
+  const std::array<uint8_t, 11> raw = {0x01, 0x10, 0x00, 0x01, 0x00, 0x02,
+                                       0x04, 0x00, 0x0A, 0x01, 0x02};
+  Codec::Frame frame;
+  ASSERT_EQ(Codec::decodeRequest(raw, frame), Codec::Ok);
+  EXPECT_EQ(frame.count, 2);
+  EXPECT_EQ(frame.reg(0), 0x000A);
+  EXPECT_EQ(frame.reg(1), 0x0102);
+
+  frame.setReg(1, 0xBEEF);
+  Codec::Buffer buffer;
+  ASSERT_EQ(Codec::encodeRequest(frame, buffer), raw.size());
+  EXPECT_EQ(buffer[9], 0xBE);
+  EXPECT_EQ(buffer[10], 0xEF);
+
+  const std::array<uint8_t, 6> coil = {0x01, 0x05, 0x00, 0x03, 0xFF, 0x00};
+  ASSERT_EQ(Codec::decodeRequest(coil, frame), Codec::Ok);
+  EXPECT_TRUE(frame.coil(0));
+  ASSERT_EQ(Codec::encodeRequest(frame, buffer), coil.size());
+  EXPECT_TRUE(std::equal(coil.begin(), coil.end(), buffer.begin()));
+
+  // Byte count has to match number of values
+  auto invalid = raw;
+  invalid[6] = 0x06;
+  EXPECT_EQ(Codec::decodeRequest(invalid, frame), utils::IllegalDataValue);
+
+  const std::array<uint8_t, 6> unknown = {0x01, 0x2B, 0x00, 0x00, 0x00, 0x01};
+  EXPECT_EQ(Codec::decodeRequest(unknown, frame), utils::IllegalFunction);
+}
+
+TEST(ModbusCodec, Response) {
+  const std::array<uint8_t, 5> coils = {0x01, 0x01, 0x02, 0x0F, 0x80};
+  Codec::Frame frame;
+  ASSERT_EQ(Codec::decodeResponse(coils, frame), Codec::Ok);
+  EXPECT_EQ(frame.count, 16);
+  EXPECT_TRUE(frame.coil(3));
+  EXPECT_FALSE(frame.coil(4));
+  EXPECT_TRUE(frame.coil(15));
+
+  Codec::Buffer buffer;
+  ASSERT_EQ(Codec::encodeResponse(frame, buffer), coils.size());
+  EXPECT_TRUE(std::equal(coils.begin(), coils.end(), buffer.begin()));
+
+  const std::array<uint8_t, 3> exception = {0x01, 0x83, 0x02};
+  EXPECT_EQ(Codec::decodeResponse(exception, frame), utils::IllegalDataAddress);
+  EXPECT_EQ(frame.functionCode, utils::ReadAnalogOutputHoldingRegisters);
+
+  ASSERT_EQ(Codec::encodeException(1, utils::ReadAnalogOutputHoldingRegisters,
+                                   utils::IllegalDataAddress, buffer, true),
+            5);
+  EXPECT_EQ(Codec::decodeResponse(std::span(buffer).first(5), frame, true),
+            utils::IllegalDataAddress);
+}
+
+TEST(ModbusCodec, Limits) {
+  Codec::Frame frame;
+  frame.functionCode = utils::ReadAnalogInputRegisters;
+  frame.count = 125;
+  Codec::Buffer buffer;
+  EXPECT_EQ(Codec::encodeResponse(frame, buffer, true), 3 + 250 + 2);
+
+  frame.count = 126;
+  EXPECT_EQ(Codec::encodeResponse(frame, buffer), 0);
+
+  frame.count = 2;
+  EXPECT_EQ(Codec::encodeRequest(frame, std::span(buffer).first(5)), 0);
+}
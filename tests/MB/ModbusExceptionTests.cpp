@@ -15,3 +15,24 @@ TEST(ModbusException, Other) {
   EXPECT_EQ(MB::ModbusException({0x0A, 0x82, 0x02}).functionCode(),
             MB::utils::ReadDiscreteInputContacts);
 }
+
+TEST(ModbusException, What) {
+  const MB::ModbusException exception(MB::utils::IllegalDataAddress, 17,
+                                      MB::utils::ReadAnalogInputRegisters);
+  EXPECT_STREQ(exception.what(),
+               "Error on slave 17 - Illegal data address ( on function: Read "
+               "from input registers )");
+  EXPECT_EQ(exception.toString(), exception.what());
+  // Same buffer every time, nothing is leaked
+  EXPECT_EQ(exception.what(), exception.what());
+
+  // Each exception owns its message
+  const MB::ModbusException other(MB::utils::Timeout);
+  const char *first = exception.what();
+  EXPECT_STRNE(first, other.what());
+  EXPECT_STREQ(first, exception.toString().c_str());
+
+  char small[8];
+  EXPECT_EQ(exception.format(small), sizeof(small));
+  EXPECT_EQ(std::string(small, sizeof(small)), "Error on");
+}
@@ -0,0 +1,231 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusProtocol.hpp"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+std::vector<uint8_t> takeOutput(auto &machine) {
+  auto pending = machine.pendingOutput();
+  std::vector<uint8_t> result(pending.begin(), pending.end());
+  machine.consumeOutput(result.size());
+  return result;
+}
+} // namespace
+
+TEST(ModbusProtocol, TCPClient) {
+  Protocol::TCPClient client;
+  const auto now = Protocol::Clock::time_point();
+
+  auto first = client.send(
+      ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 10, 1), now);
+  auto second = client.send(
+      ModbusRequest(2, utils::ReadAnalogOutputHoldingRegisters, 20, 1), now,
+      1s);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(client.inFlight(), 2);
+  ASSERT_TRUE(client.nextDeadline().has_value());
+  EXPECT_LE(*client.nextDeadline(), now + Protocol::TCPClient::DefaultTimeout);
+
+  auto output = takeOutput(client);
+  ASSERT_EQ(output.size(), 24);
+  EXPECT_EQ(output[5], 6); // length
+  EXPECT_EQ(output[6], 1); // unit id
+  EXPECT_TRUE(client.pendingOutput().empty());
+
+  // Responses out of order, split in the middle of a frame
+  std::vector<uint8_t> responses = {0x00, static_cast<uint8_t>(second),
+                                    0x00, 0x00, 0x00, 0x05, 0x02, 0x03,
+                                    0x02, 0x00, 0x14, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02,
+                                    0x00, 0x0A};
+  client.receive(std::span(responses).first(15));
+  auto event = client.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->transactionId, second);
+  ASSERT_TRUE(event->response.has_value());
+  EXPECT_EQ(event->response->registerAddress(), 20);
+  EXPECT_FALSE(client.nextEvent().has_value());
+
+  client.receive(std::span(responses).subspan(15));
+  event = client.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->transactionId, first);
+  EXPECT_EQ(event->response->registerValues()[0].reg(), 0x0A);
+  EXPECT_EQ(client.inFlight(), 0);
+}
+
+TEST(ModbusProtocol, TCPClientErrors) {
+  Protocol::TCPClient client;
+  const auto now = Protocol::Clock::time_point();
+
+  auto id = client.send(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1),
+                        now, 100ms);
+  client.onTimer(now + 99ms);
+  EXPECT_FALSE(client.nextEvent().has_value());
+  client.onTimer(now + 100ms);
+  auto event = client.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->transactionId, id);
+  EXPECT_EQ(event->error->getErrorCode(), utils::Timeout);
+  EXPECT_FALSE(client.nextDeadline().has_value());
+
+  id = client.send(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1), now);
+  std::vector<uint8_t> exception = {0x00, static_cast<uint8_t>(id),
+                                    0x00, 0x00, 0x00, 0x03, 0x01, 0x84, 0x02};
+  client.receive(exception);
+  event = client.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->error->getErrorCode(), utils::IllegalDataAddress);
+
+  client.send(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1), now);
+  std::vector<uint8_t> garbage = {0x00, 0x01, 0x12, 0x34, 0x00, 0x03, 0x01};
+  client.receive(garbage);
+  event = client.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->error->getErrorCode(), utils::ProtocolError);
+}
+
+TEST(ModbusProtocol, TCPServer) {
+  Protocol::TCPServer server;
+
+  std::vector<uint8_t> requests = {
+      0x00, 0x07, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x02,
+      0x00, 0x08, 0x00, 0x00, 0x00, 0x02, 0x01, 0x2B,
+      0x00, 0x09, 0x00, 0x00, 0x00, 0x06, 0x01};
+  server.receive(requests);
+
+  auto event = server.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->transactionId, 7);
+  ASSERT_TRUE(event->request.has_value());
+  EXPECT_EQ(event->request->registerAddress(), 0x10);
+  EXPECT_EQ(event->request->numberOfRegisters(), 2);
+
+  event = server.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->transactionId, 8);
+  ASSERT_TRUE(event->error.has_value());
+  EXPECT_EQ(event->error->slaveID(), 1);
+  EXPECT_EQ(event->error->getErrorCode(), utils::IllegalFunction);
+  server.respond(8, *event->error);
+
+  // Third frame is not complete yet
+  EXPECT_FALSE(server.nextEvent().has_value());
+
+  server.respond(7, ModbusResponse(1, utils::ReadAnalogOutputHoldingRegisters,
+                                   0x10, 2, {uint16_t(1), uint16_t(2)}));
+  auto output = takeOutput(server);
+  std::vector<uint8_t> expected = {
+      0x00, 0x08, 0x00, 0x00, 0x00, 0x03, 0x01, 0xAB, 0x01,
+      0x00, 0x07, 0x00, 0x00, 0x00, 0x07, 0x01, 0x03, 0x04,
+      0x00, 0x01, 0x00, 0x02};
+  EXPECT_EQ(output, expected);
+}
+
+TEST(ModbusProtocol, RTUClient) {
+  Protocol::RTUClient client;
+  const auto now = Protocol::Clock::time_point();
+
+  auto first = client.send(
+      ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 1, 1), now);
+  auto second = client.send(
+      ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 2, 1), now);
+  EXPECT_EQ(client.inFlight(), 2);
+
+  // Only the first request is sent until it completes
+  auto output = takeOutput(client);
+  EXPECT_EQ(output, (std::vector<uint8_t>{0x01, 0x03, 0x00, 0x01, 0x00, 0x01,
+                                          0xD5, 0xCA}));
+
+  const std::vector<uint8_t> response = {0x01, 0x03, 0x02, 0x00, 0x0A,
+                                         0x38, 0x43};
+  for (auto byte : response) {
+    EXPECT_FALSE(client.nextEvent().has_value());
+    client.receive(std::span(&byte, 1), now + 10ms);
+  }
+  auto event = client.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->transactionId, first);
+  ASSERT_TRUE(event->response.has_value());
+  EXPECT_EQ(event->response->registerValues()[0].reg(), 0x0A);
+
+  // Second request is sent now, deadline counted from that moment
+  EXPECT_EQ(takeOutput(client).size(), 8);
+  EXPECT_EQ(client.nextDeadline(), now + 10ms + Protocol::RTUClient::DefaultTimeout);
+
+  auto corrupted = response;
+  corrupted.back() ^= 0xFF;
+  client.receive(corrupted, now + 20ms);
+  event = client.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->transactionId, second);
+  EXPECT_EQ(event->error->getErrorCode(), utils::InvalidCRC);
+  EXPECT_EQ(client.inFlight(), 0);
+
+  client.send(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1), now);
+  client.onTimer(now + Protocol::RTUClient::DefaultTimeout);
+  event = client.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  EXPECT_EQ(event->error->getErrorCode(), utils::Timeout);
+}
+
+TEST(ModbusProtocol, RTUServer) {
+  Protocol::RTUServer server;
+
+  const std::vector<uint8_t> read = {0x01, 0x03, 0x00, 0x01, 0x00, 0x01,
+                                     0xD5, 0xCA};
+  for (auto byte : read) {
+    EXPECT_FALSE(server.nextEvent().has_value());
+    server.receive(std::span(&byte, 1));
+  }
+  auto event = server.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  ASSERT_TRUE(event->request.has_value());
+  EXPECT_EQ(event->request->registerAddress(), 1);
+  EXPECT_EQ(event->request->numberOfRegisters(), 1);
+
+  // Length of multiple write is taken from its byte count
+  auto write = ModbusRequest(2, utils::WriteMultipleAnalogOutputHoldingRegisters,
+                             4, 2, {uint16_t(7), uint16_t(8)})
+                   .toRaw();
+  const auto crc = utils::calculateCRC(write);
+  write.push_back(static_cast<uint8_t>(crc));
+  write.push_back(static_cast<uint8_t>(crc >> 8));
+  auto corrupted = read;
+  corrupted.back() ^= 0xFF;
+
+  std::vector<uint8_t> input = write;
+  input.insert(input.end(), corrupted.begin(), corrupted.end());
+  server.receive(input);
+  event = server.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  ASSERT_TRUE(event->request.has_value());
+  EXPECT_EQ(event->request->slaveID(), 2);
+  EXPECT_EQ(event->request->registerValues()[1].reg(), 8);
+  // Frame with invalid CRC is not answered
+  EXPECT_FALSE(server.nextEvent().has_value());
+
+  server.receive(std::vector<uint8_t>{0x01, 0x2B, 0x0E, 0x01});
+  event = server.nextEvent();
+  ASSERT_TRUE(event.has_value());
+  ASSERT_TRUE(event->error.has_value());
+  EXPECT_EQ(event->error->getErrorCode(), utils::IllegalFunction);
+
+  // Partial frame is dropped after silence on the line
+  server.receive(std::vector<uint8_t>{0x01, 0x03, 0x00});
+  server.reset();
+  server.receive(read);
+  EXPECT_TRUE(server.nextEvent().has_value());
+
+  server.respond(ModbusResponse(1, utils::ReadAnalogOutputHoldingRegisters, 1,
+                                1, {uint16_t(0x0A)}));
+  EXPECT_EQ(takeOutput(server), (std::vector<uint8_t>{0x01, 0x03, 0x02, 0x00,
+                                                      0x0A, 0x38, 0x43}));
+}
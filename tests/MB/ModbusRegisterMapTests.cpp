@@ -0,0 +1,128 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusRegisterMap.hpp"
+#include "gtest/gtest.h"
+
+using namespace MB;
+
+namespace {
+struct Meter {
+  float voltage;
+  uint32_t counter;
+  double temperature;
+  int16_t offset;
+};
+
+constexpr auto meterMap = registerMap<Meter>(
+    utils::ReadAnalogOutputHoldingRegisters, 100,
+    field<&Meter::voltage>(0, utils::CDAB),
+    field<&Meter::counter>(2),
+    field<&Meter::temperature, int16_t>(4, utils::ABCD, 0.1),
+    field<&Meter::offset>(10));
+
+struct Large {
+  uint32_t first;
+  uint32_t middle;
+  uint32_t last;
+};
+
+constexpr auto largeMap = registerMap<Large>(
+    utils::ReadAnalogInputRegisters, 0, field<&Large::first>(0),
+    field<&Large::middle>(124), field<&Large::last>(200));
+
+// Registers between the fields are not implemented by the device
+constexpr auto sparseMap = registerMap<Large>(
+    utils::ReadAnalogOutputHoldingRegisters, 10, field<&Large::first>(0),
+    field<&Large::middle>(1000), field<&Large::last>(1002));
+} // namespace
+
+TEST(ModbusRegisterMap, Blocks) {
+  static_assert(meterMap.span() == 11);
+  static_assert(meterMap.readBlocksCount() == 1);
+
+  // Value at 124-125 can not be split, so first block ends after 0-1
+  static_assert(largeMap.readBlocksCount() == 2);
+  static_assert(largeMap.readBlock(0).first == 0);
+  static_assert(largeMap.readBlock(0).count == 2);
+  static_assert(largeMap.readBlock(1).first == 124);
+  static_assert(largeMap.readBlock(1).count == 78);
+
+  auto requests = largeMap.readRequests(3);
+  ASSERT_EQ(requests.size(), 2);
+  EXPECT_EQ(requests[1].slaveID(), 3);
+  EXPECT_EQ(requests[1].functionCode(), utils::ReadAnalogInputRegisters);
+  EXPECT_EQ(requests[1].registerAddress(), 124);
+  EXPECT_EQ(requests[1].numberOfRegisters(), 78);
+}
+
+TEST(ModbusRegisterMap, BlocksSkipGaps) {
+  static_assert(sparseMap.readBlocksCount() == 2);
+  static_assert(sparseMap.readBlock(0).first == 10);
+  static_assert(sparseMap.readBlock(0).count == 2);
+  static_assert(sparseMap.readBlock(1).first == 1010);
+  static_assert(sparseMap.readBlock(1).count == 4);
+  static_assert(sparseMap.readBlock(2).count == 0);
+
+  // Fields are decoded from responses to both blocks
+  const auto requests = sparseMap.readRequests(1);
+  ASSERT_EQ(requests.size(), 2);
+  Large large{};
+  sparseMap.decode(std::vector<uint16_t>{0, 1}, large, 10);
+  sparseMap.decode(std::vector<uint16_t>{0, 2, 0, 3}, large, 1010);
+  EXPECT_EQ(large.first, 1);
+  EXPECT_EQ(large.middle, 2);
+  EXPECT_EQ(large.last, 3);
+}
+
+TEST(ModbusRegisterMap, Decode) {
+  // 123.456f = 0x42F6E979, 21.5 = 215 * 0.1, -3 = 0xFFFD
+  const uint16_t registers[] = {0xE979, 0x42F6, 0x0001, 0x0002, 215, 0,
+                                0,      0,      0,      0,      0xFFFD};
+  Meter meter{};
+  meterMap.decode(registers, meter);
+
+  EXPECT_FLOAT_EQ(meter.voltage, 123.456f);
+  EXPECT_EQ(meter.counter, 0x00010002);
+  EXPECT_DOUBLE_EQ(meter.temperature, 21.5);
+  EXPECT_EQ(meter.offset, -3);
+
+  // Response that covers only part of the map
+  auto request = ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters,
+                               102, 2);
+  auto response = ModbusResponse::fromRaw(
+      {0x01, 0x03, 0x04, 0x00, 0x00, 0x00, 0x07});
+  response.from(request);
+
+  meterMap.decode(response, meter);
+  EXPECT_EQ(meter.counter, 7);
+  EXPECT_FLOAT_EQ(meter.voltage, 123.456f);
+}
+
+TEST(ModbusRegisterMap, Encode) {
+  Meter meter{1.5f, 0xDEADBEEF, -12.3, 5};
+
+  auto requests = meterMap.writeRequests(1, meter);
+  // Registers 6-9 are not part of the map and must not be written
+  ASSERT_EQ(requests.size(), 2);
+  EXPECT_EQ(requests[0].functionCode(),
+            utils::WriteMultipleAnalogOutputHoldingRegisters);
+  EXPECT_EQ(requests[0].registerAddress(), 100);
+  EXPECT_EQ(requests[0].numberOfRegisters(), 5);
+  EXPECT_EQ(requests[1].registerAddress(), 110);
+  EXPECT_EQ(requests[1].numberOfRegisters(), 1);
+
+  std::vector<uint16_t> registers(meterMap.span());
+  meterMap.encode(meter, registers);
+
+  Meter decoded{};
+  meterMap.decode(registers, decoded);
+  EXPECT_FLOAT_EQ(decoded.voltage, meter.voltage);
+  EXPECT_EQ(decoded.counter, meter.counter);
+  EXPECT_DOUBLE_EQ(decoded.temperature, meter.temperature);
+  EXPECT_EQ(decoded.offset, meter.offset);
+
+  Large large{};
+  EXPECT_THROW(auto r = largeMap.writeRequests(1, large), std::runtime_error);
+}
@@ -0,0 +1,90 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusRouter.hpp"
+#include "gtest/gtest.h"
+
+using namespace MB;
+
+namespace {
+ModbusRequest writeRegister(uint8_t unit, uint16_t value) {
+  return ModbusRequest(unit, utils::WriteSingleAnalogOutputRegister, 0, 1,
+                       {value});
+}
+} // namespace
+
+TEST(ModbusRouter, RoutesUnits) {
+  Router router;
+  auto shared = std::make_shared<DenseRegisterBank>(10);
+  auto own = std::make_shared<DenseRegisterBank>(10);
+  router.add(1, 100, shared);
+  router.add(50, own);
+  router.add(200, [](const ModbusRequest &request) {
+    return ModbusResponse(request.slaveID(), request.functionCode(),
+                          request.registerAddress(), 1, {uint16_t(99)});
+  });
+
+  EXPECT_TRUE(router.handle(writeRegister(7, 5)).has_value());
+  EXPECT_TRUE(router.handle(writeRegister(50, 6)).has_value());
+  EXPECT_EQ(shared->registers(utils::HoldingRegisters)[0], 5);
+  EXPECT_EQ(own->registers(utils::HoldingRegisters)[0], 6);
+  EXPECT_EQ(router.bank(100), shared);
+
+  const auto response = router.handle(
+      ModbusRequest(200, utils::ReadAnalogOutputHoldingRegisters, 0, 1));
+  ASSERT_TRUE(response.has_value());
+  EXPECT_EQ(response->registerValues()[0].reg(), 99);
+
+  router.remove(7);
+  EXPECT_FALSE(router.routed(7));
+  EXPECT_TRUE(router.routed(8));
+}
+
+TEST(ModbusRouter, UnknownUnits) {
+  Router router;
+  try {
+    static_cast<void>(router.handle(writeRegister(9, 1)));
+    FAIL() << "Unknown unit must be rejected";
+  } catch (const ModbusException &ex) {
+    EXPECT_EQ(ex.getErrorCode(), utils::GatewayPathUnavailable);
+    EXPECT_EQ(ex.slaveID(), 9);
+  }
+
+  router.setUnknownUnitError(std::nullopt);
+  EXPECT_FALSE(router.handle(writeRegister(9, 1)).has_value());
+}
+
+TEST(ModbusRouter, Broadcast) {
+  Router router;
+  auto first = std::make_shared<DenseRegisterBank>(10);
+  auto second = std::make_shared<DenseRegisterBank>(10);
+  int handled = 0;
+  router.add(1, 20, first);
+  router.add(30, second);
+  router.add(40, 60, [&](const ModbusRequest &request) {
+    handled++;
+    return ModbusResponse(request.slaveID(), request.functionCode(),
+                          request.registerAddress(), 1, {uint16_t(0)});
+  });
+
+  EXPECT_FALSE(router.handle(writeRegister(0, 3)).has_value());
+  EXPECT_EQ(first->registers(utils::HoldingRegisters)[0], 3);
+  EXPECT_EQ(second->registers(utils::HoldingRegisters)[0], 3);
+  EXPECT_EQ(handled, 1);
+
+  // Range split by a later route is still served once
+  router.add(50, first);
+  EXPECT_FALSE(router.handle(writeRegister(0, 6)).has_value());
+  EXPECT_EQ(first->registers(utils::HoldingRegisters)[0], 6);
+  EXPECT_EQ(handled, 2);
+
+  router.setBroadcastPolicy(Router::IgnoreBroadcast);
+  EXPECT_FALSE(router.handle(writeRegister(0, 4)).has_value());
+  EXPECT_EQ(first->registers(utils::HoldingRegisters)[0], 6);
+
+  router.setBroadcastPolicy(Router::RouteBroadcast);
+  router.add(0, second);
+  EXPECT_TRUE(router.handle(writeRegister(0, 5)).has_value());
+  EXPECT_EQ(second->registers(utils::HoldingRegisters)[0], 5);
+}
@@ -0,0 +1,81 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusValues.hpp"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace MB;
+
+TEST(ModbusValues, WordOrders) {
+  // 123.456f = 0x42F6E979
+  const uint16_t abcd[] = {0x42F6, 0xE979};
+  const uint16_t cdab[] = {0xE979, 0x42F6};
+  const uint16_t badc[] = {0xF642, 0x79E9};
+  const uint16_t dcba[] = {0x79E9, 0xF642};
+
+  EXPECT_FLOAT_EQ(utils::decodeValue<float>(abcd, utils::ABCD), 123.456f);
+  EXPECT_FLOAT_EQ(utils::decodeValue<float>(cdab, utils::CDAB), 123.456f);
+  EXPECT_FLOAT_EQ(utils::decodeValue<float>(badc, utils::BADC), 123.456f);
+  EXPECT_FLOAT_EQ(utils::decodeValue<float>(dcba, utils::DCBA), 123.456f);
+
+  EXPECT_EQ(utils::decodeValue<uint32_t>(cdab, utils::ABCD), 0xE97942F6);
+  EXPECT_EQ(utils::decodeValue<int16_t>(dcba, utils::BADC), -5767);
+
+  // 1.0 = 0x3FF0000000000000
+  const uint16_t doubleCdab[] = {0x0000, 0x0000, 0x0000, 0x3FF0};
+  const uint16_t doubleDcba[] = {0x0000, 0x0000, 0x0000, 0xF03F};
+  EXPECT_DOUBLE_EQ(utils::decodeValue<double>(doubleCdab, utils::CDAB), 1.0);
+  EXPECT_DOUBLE_EQ(utils::decodeValue<double>(doubleDcba, utils::DCBA), 1.0);
+}
+
+TEST(ModbusValues, RoundTrip) {
+  for (auto order : {utils::ABCD, utils::CDAB, utils::BADC, utils::DCBA}) {
+    std::vector<int64_t> values = {0, -1, 0x0102030405060708, INT64_MIN, 42};
+    std::vector<uint16_t> registers(values.size() * 4);
+    std::vector<int64_t> decoded(values.size());
+
+    EXPECT_EQ(utils::encodeValues<int64_t>(values, registers, order),
+              values.size());
+    EXPECT_EQ(utils::decodeValues<int64_t>(registers, decoded, order),
+              values.size());
+    EXPECT_EQ(values, decoded);
+  }
+}
+
+TEST(ModbusValues, Payload) {
+  // 60 floats, like a typical energy meter read
+  std::vector<float> values(60);
+  for (std::size_t i = 0; i < values.size(); i++)
+    values[i] = static_cast<float>(i) * 1.5f - 20.0f;
+
+  for (auto order : {utils::ABCD, utils::CDAB, utils::BADC, utils::DCBA}) {
+    std::vector<uint16_t> registers(values.size() * 2);
+    utils::encodeValues<float>(values, registers, order);
+
+    std::vector<uint8_t> payload;
+    for (auto reg : registers)
+      utils::pushUint16(payload, reg);
+
+    std::vector<float> decoded(values.size());
+    EXPECT_EQ(utils::decodeValues<float>(std::span<const uint8_t>(payload),
+                                         decoded, order),
+              values.size());
+    EXPECT_EQ(values, decoded);
+  }
+}
+
+TEST(ModbusValues, Response) {
+  ModbusResponse response(1, utils::ReadAnalogOutputHoldingRegisters, 0, 5,
+                          {ModbusCell::initReg(0x42F6),
+                           ModbusCell::initReg(0xE979), ModbusCell::initReg(0),
+                           ModbusCell::initReg(7), ModbusCell::initReg(1)});
+
+  uint32_t out[3] = {};
+  // Last register does not form full value
+  EXPECT_EQ(utils::decodeValues<uint32_t>(response, out), 2);
+  EXPECT_EQ(out[0], 0x42F6E979);
+  EXPECT_EQ(out[1], 7);
+}
@@ -0,0 +1,127 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/registerBank.hpp"
+#include "gtest/gtest.h"
+
+using namespace MB;
+
+namespace {
+std::optional<utils::MBErrorCode> errorOf(RegisterBank &bank,
+                                          const ModbusRequest &request) {
+  try {
+    static_cast<void>(bank.handle(request));
+  } catch (const ModbusException &ex) {
+    EXPECT_EQ(ex.slaveID(), request.slaveID());
+    return ex.getErrorCode();
+  }
+  return std::nullopt;
+}
+} // namespace
+
+TEST(RegisterBank, ReadWriteRegisters) {
+  DenseRegisterBank bank(100);
+  bank.registers(utils::InputRegisters)[10] = 42;
+
+  const auto written = bank.handle(
+      ModbusRequest(3, utils::WriteMultipleAnalogOutputHoldingRegisters, 5, 2,
+                    {uint16_t(7), uint16_t(8)}));
+  EXPECT_EQ(written.registerAddress(), 5);
+  EXPECT_EQ(written.numberOfRegisters(), 2);
+  EXPECT_EQ(bank.registers(utils::HoldingRegisters)[6], 8);
+
+  const auto holding = bank.handle(
+      ModbusRequest(3, utils::ReadAnalogOutputHoldingRegisters, 4, 3));
+  ASSERT_EQ(holding.registerValues().size(), 3);
+  EXPECT_EQ(holding.registerValues()[0].reg(), 0);
+  EXPECT_EQ(holding.registerValues()[1].reg(), 7);
+  EXPECT_EQ(holding.registerValues()[2].reg(), 8);
+
+  const auto input =
+      bank.handle(ModbusRequest(3, utils::ReadAnalogInputRegisters, 10, 1));
+  EXPECT_EQ(input.registerValues()[0].reg(), 42);
+}
+
+TEST(RegisterBank, ReadWriteCoils) {
+  DenseRegisterBank bank(16);
+
+  const auto written = bank.handle(
+      ModbusRequest(1, utils::WriteSingleDiscreteOutputCoil, 3, 1, {true}));
+  EXPECT_TRUE(written.registerValues()[0].coil());
+  EXPECT_TRUE(bank.coils(utils::OutputCoils)[3]);
+
+  const auto coils =
+      bank.handle(ModbusRequest(1, utils::ReadDiscreteOutputCoils, 2, 3));
+  ASSERT_EQ(coils.registerValues().size(), 3);
+  EXPECT_TRUE(coils.registerValues()[0].isCoil());
+  EXPECT_FALSE(coils.registerValues()[0].coil());
+  EXPECT_TRUE(coils.registerValues()[1].coil());
+  // Response must encode as coil read
+  EXPECT_EQ(coils.toRaw()[2], 1);
+}
+
+TEST(RegisterBank, Errors) {
+  DenseRegisterBank bank(10, 10, 10, 0);
+
+  EXPECT_EQ(errorOf(bank, ModbusRequest(2, utils::ReadAnalogOutputHoldingRegisters,
+                                        8, 3)),
+            utils::IllegalDataAddress);
+  EXPECT_EQ(errorOf(bank, ModbusRequest(2, utils::ReadAnalogInputRegisters, 0, 1)),
+            utils::IllegalDataAddress);
+  EXPECT_EQ(errorOf(bank, ModbusRequest(2, utils::ReadAnalogOutputHoldingRegisters,
+                                        0, 126)),
+            utils::IllegalDataValue);
+
+  EXPECT_THROW(static_cast<void>(bank.registers(utils::OutputCoils)),
+               std::runtime_error);
+  EXPECT_THROW(DenseRegisterBank(70000), std::runtime_error);
+}
+
+TEST(RegisterBank, SparseRanges) {
+  SparseRegisterBank bank;
+  bank.define(utils::HoldingRegisters, 250, 10, 1);
+  bank.define(utils::HoldingRegisters, 60000, 2);
+  bank.define(utils::OutputCoils, 65535, 1, 1);
+  // Range crossing page boundary and one page at the end of both tables
+  EXPECT_EQ(bank.pagesCount(), 4);
+
+  const auto written = bank.handle(
+      ModbusRequest(1, utils::WriteMultipleAnalogOutputHoldingRegisters, 254, 4,
+                    {uint16_t(1), uint16_t(2), uint16_t(3), uint16_t(4)}));
+  EXPECT_EQ(written.numberOfRegisters(), 4);
+  const auto response = bank.handle(
+      ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 253, 6));
+  ASSERT_EQ(response.registerValues().size(), 6);
+  EXPECT_EQ(response.registerValues()[0].reg(), 1);
+  EXPECT_EQ(response.registerValues()[2].reg(), 2);
+  EXPECT_EQ(response.registerValues()[4].reg(), 4);
+
+  const auto coil =
+      bank.handle(ModbusRequest(1, utils::ReadDiscreteOutputCoils, 65535, 1));
+  EXPECT_TRUE(coil.registerValues()[0].coil());
+
+  bank.undefine(utils::HoldingRegisters, 60000, 2);
+  EXPECT_EQ(bank.pagesCount(), 3);
+  EXPECT_FALSE(bank.defined(utils::HoldingRegisters, 60000));
+}
+
+TEST(RegisterBank, SparseMissingAddresses) {
+  SparseRegisterBank bank;
+  bank.define(utils::HoldingRegisters, 0, 10, 5);
+
+  // Range running past defined values is rejected as a whole
+  EXPECT_EQ(errorOf(bank, ModbusRequest(1,
+                                        utils::WriteMultipleAnalogOutputHoldingRegisters,
+                                        8, 3, {uint16_t(0), uint16_t(0), uint16_t(0)})),
+            utils::IllegalDataAddress);
+  EXPECT_EQ(errorOf(bank, ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters,
+                                        8, 2)),
+            std::nullopt);
+  EXPECT_EQ(errorOf(bank, ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1)),
+            utils::IllegalDataAddress);
+
+  ModbusCell value;
+  bank.read(utils::HoldingRegisters, 8, std::span<ModbusCell>(&value, 1));
+  EXPECT_EQ(value.reg(), 5);
+}
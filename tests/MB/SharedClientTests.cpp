@@ -0,0 +1,114 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/sharedClient.hpp"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace MB;
+
+namespace {
+// Loopback "connection" that answers every read with register equal to
+// request address, unit 0xFF answers with exception
+class FakeConnection {
+  uint16_t _messageID = 0;
+  std::vector<ModbusRequest> _sent;
+
+public:
+  FakeConnection() = default;
+  FakeConnection(FakeConnection &&) = default;
+
+  std::vector<uint8_t> sendRequest(const ModbusRequest &req) {
+    _sent.push_back(req);
+    return req.toRaw();
+  }
+
+  ModbusResponse awaitResponse() {
+    auto req = _sent.back();
+    if (req.slaveID() == 0xFF)
+      throw ModbusException(utils::IllegalDataAddress, req.slaveID());
+
+    return ModbusResponse(req.slaveID(), req.functionCode(),
+                          req.registerAddress(), 1,
+                          {ModbusCell::initReg(req.registerAddress())});
+  }
+
+  [[nodiscard]] uint16_t getMessageId() const { return _messageID; }
+  void setMessageId(uint16_t messageId) { _messageID = messageId; }
+};
+} // namespace
+
+TEST(SharedClient, Futures) {
+  SharedClient<FakeConnection> client(FakeConnection{}, 4);
+
+  std::vector<std::thread> threads;
+  std::atomic<int> matched = 0;
+
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t]() {
+      for (uint16_t i = 0; i < 100; i++) {
+        uint16_t address = t * 100 + i;
+        auto response =
+            client
+                .submit(ModbusRequest(t + 1,
+                                      utils::ReadAnalogOutputHoldingRegisters,
+                                      address, 1))
+                .get();
+        if (response.slaveID() == t + 1 &&
+            response.registerValues()[0].reg() == address)
+          matched++;
+      }
+    });
+  }
+
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(matched, 800);
+}
+
+TEST(SharedClient, Callbacks) {
+  std::atomic<int> ok = 0;
+  std::atomic<int> failed = 0;
+
+  {
+    SharedClient<FakeConnection> client(FakeConnection{});
+
+    for (uint16_t i = 0; i < 50; i++) {
+      uint8_t slave = (i % 5 == 0) ? 0xFF : 1;
+      client.submit(
+          ModbusRequest(slave, utils::ReadAnalogInputRegisters, i, 1),
+          [&](const ModbusResponse *response, std::exception_ptr error) {
+            if (response && !error)
+              ok++;
+            else if (!response && error)
+              failed++;
+          });
+    }
+
+    // Make sure everything submitted so far has been processed
+    client.submit(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1))
+        .wait();
+  }
+
+  EXPECT_EQ(ok, 40);
+  EXPECT_EQ(failed, 10);
+}
+
+TEST(SharedClient, Exceptions) {
+  SharedClient<FakeConnection> client(FakeConnection{});
+
+  auto future = client.submit(
+      ModbusRequest(0xFF, utils::ReadAnalogOutputHoldingRegisters, 1, 1));
+
+  try {
+    future.get();
+    FAIL();
+  } catch (const ModbusException &ex) {
+    EXPECT_EQ(ex.getErrorCode(), utils::IllegalDataAddress);
+  }
+}
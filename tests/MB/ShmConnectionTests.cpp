@@ -0,0 +1,214 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/Shm/server.hpp"
+#include "allocationCounter.hpp"
+#include "gtest/gtest.h"
+
+#include <optional>
+#include <thread>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace MB;
+
+namespace {
+std::string segmentName() {
+  return "/modbus-test-" + std::to_string(::getpid());
+}
+} // namespace
+
+TEST(ShmRing, WrapsAround) {
+  alignas(64) Shm::RingHeader header;
+  std::vector<uint8_t> data(64);
+  Shm::Ring ring(&header, data.data(), data.size());
+
+  // Records of 12 bytes do not divide 64, so frames have to skip ring end
+  for (uint8_t i = 0; i < 20; i++) {
+    const std::vector<uint8_t> first = {i, 1, 2};
+    const std::vector<uint8_t> second = {3, 4, 5};
+    ASSERT_TRUE(ring.write(first, second, 0, 0));
+    ASSERT_TRUE(ring.write(first, {}, 0, 0));
+
+    auto frame = ring.read(0, 0);
+    ASSERT_EQ(frame.size(), 6);
+    EXPECT_EQ(frame[0], i);
+    EXPECT_EQ(frame[5], 5);
+    ring.release();
+    EXPECT_EQ(ring.read(0, 0).size(), 3);
+    ring.release();
+  }
+  EXPECT_TRUE(ring.read(0, 0).empty());
+
+  // Full ring times out
+  std::vector<uint8_t> frame(20);
+  EXPECT_TRUE(ring.write(frame, {}, 0, 0));
+  EXPECT_TRUE(ring.write(frame, {}, 0, 0));
+  EXPECT_FALSE(ring.write(frame, {}, 1, 10));
+}
+
+TEST(ShmConnection, RequestResponse) {
+  Shm::Server server(segmentName(), 1024);
+  constexpr int Transactions = 2000;
+
+  std::thread device([&server] {
+    auto connection = server.awaitConnection(1000);
+    for (int i = 0; i < Transactions; i++) {
+      auto request = connection.awaitRequest();
+      if (request.registerAddress() == 0xFFFF) {
+        connection.sendException(ModbusException(utils::IllegalDataAddress,
+                                                 request.slaveID(),
+                                                 request.functionCode()));
+        continue;
+      }
+      ModbusResponse response(request.slaveID(), request.functionCode(),
+                              request.registerAddress(),
+                              request.numberOfRegisters());
+      ModbusCells values(request.numberOfRegisters(),
+                         ModbusCell::initReg(request.registerAddress()));
+      response.setValues(values);
+      connection.sendResponse(response);
+    }
+  });
+
+  auto client = Shm::Connection::with(segmentName());
+  EXPECT_THROW(Shm::Connection::with(segmentName()), std::runtime_error);
+
+  for (int i = 0; i < Transactions - 1; i++) {
+    const auto address = static_cast<uint16_t>(i);
+    client.setMessageId(address);
+    client.sendRequest(
+        ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, address,
+                      static_cast<uint16_t>(i % 125 + 1)));
+    auto response = client.awaitResponse();
+    ASSERT_EQ(response.registerValues().size(), i % 125 + 1);
+    ASSERT_EQ(response.registerValues().back().reg(), address);
+  }
+
+  client.sendRequest(
+      ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 0xFFFF, 1));
+  try {
+    (void)client.awaitResponse();
+    FAIL() << "Exception response expected";
+  } catch (const ModbusException &ex) {
+    EXPECT_EQ(ex.getErrorCode(), utils::IllegalDataAddress);
+  }
+  device.join();
+
+  client.setTimeout(10);
+  client.setSpin(0);
+  EXPECT_THROW((void)client.awaitResponse(), ModbusException);
+}
+
+TEST(ShmConnection, MissingSegment) {
+  EXPECT_THROW(Shm::Connection::with("/modbus-test-missing"),
+               std::runtime_error);
+  Shm::Server server(segmentName());
+  EXPECT_THROW(server.awaitConnection(5), ModbusException);
+}
+
+TEST(ShmConnection, ReconnectDropsStaleFrames) {
+  Shm::Server server(segmentName());
+  const auto request = [](uint16_t address) {
+    return ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, address,
+                         1);
+  };
+  const auto respond = [](Shm::Connection &device, const ModbusRequest &req) {
+    device.sendResponse(ModbusResponse(req.slaveID(), req.functionCode(),
+                                       req.registerAddress(), 1,
+                                       {req.registerAddress()}));
+  };
+
+  auto dead = std::make_optional(Shm::Connection::with(segmentName()));
+  auto device = server.awaitConnection(0);
+  dead->setMessageId(7);
+  dead->sendRequest(request(1));
+  dead->sendRequest(request(2));
+  dead.reset();
+
+  // Request read before the new client attached is not answered to it
+  auto first = device.awaitRequest();
+  EXPECT_EQ(first.registerAddress(), 1);
+  auto client = Shm::Connection::with(segmentName());
+  respond(device, first);
+
+  client.sendRequest(request(3));
+  auto received = device.awaitRequest();
+  EXPECT_EQ(received.registerAddress(), 3);
+  respond(device, received);
+  EXPECT_EQ(client.awaitResponse().registerValues()[0].reg(), 3);
+}
+
+TEST(ShmConnection, KilledClientIsReplaced) {
+  const auto name = segmentName();
+  Shm::Server server(name);
+
+  int ready[2];
+  ASSERT_EQ(::pipe(ready), 0);
+  const auto child = ::fork();
+  ASSERT_NE(child, -1);
+  if (child == 0) {
+    // Attaches, leaves a request behind and waits to be killed
+    try {
+      auto client = Shm::Connection::with(name);
+      client.sendRequest(
+          ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 1, 1));
+      [[maybe_unused]] auto written = ::write(ready[1], "x", 1);
+      while (true)
+        ::pause();
+    } catch (...) {
+    }
+    ::_exit(1);
+  }
+
+  ::close(ready[1]);
+  char byte;
+  const auto attached = ::read(ready[0], &byte, 1);
+  ::close(ready[0]);
+  if (attached != 1)
+    ::waitpid(child, nullptr, 0);
+  ASSERT_EQ(attached, 1);
+  auto device = server.awaitConnection(1000);
+  EXPECT_THROW(Shm::Connection::with(name), std::runtime_error);
+
+  ::kill(child, SIGKILL);
+  ASSERT_EQ(::waitpid(child, nullptr, 0), child);
+
+  auto client = Shm::Connection::with(name);
+  client.sendRequest(
+      ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 2, 1));
+  EXPECT_EQ(device.awaitRequest().registerAddress(), 2);
+}
+
+TEST(ShmConnection, SteadyStateDoesNotAllocate) {
+  Shm::Server server(segmentName());
+  auto client = Shm::Connection::with(segmentName());
+  auto device = server.awaitConnection(0);
+
+  const ModbusRequest request(1, utils::ReadAnalogOutputHoldingRegisters, 0,
+                              10);
+  const ModbusResponse response(1, utils::ReadAnalogOutputHoldingRegisters, 0,
+                                10, ModbusCells(10, ModbusCell(uint16_t(3))));
+
+  std::array<std::byte, 4096> arena;
+  std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size(),
+                                               std::pmr::null_memory_resource());
+  const auto transaction = [&] {
+    {
+      client.sendRequest(request);
+      const auto received = device.awaitRequest(&resource);
+      device.sendResponse(response);
+      const auto answer = client.awaitResponse(&resource);
+      EXPECT_EQ(answer.numberOfRegisters(), 10);
+    }
+    resource.release();
+  };
+
+  transaction();
+  Allocations::Counter counter;
+  for (int i = 0; i < 100; i++)
+    transaction();
+  EXPECT_EQ(counter.count(), 0);
+}
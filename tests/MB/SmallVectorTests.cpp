@@ -0,0 +1,91 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "MB/smallVector.hpp"
+#include "gtest/gtest.h"
+
+#include <array>
+#include <memory_resource>
+#include <vector>
+
+using namespace MB;
+
+TEST(SmallVector, InlineAndHeap) {
+  utils::SmallVector<uint16_t, 4> values = {1, 2, 3};
+  EXPECT_TRUE(values.isInline());
+  EXPECT_EQ(values.size(), 3);
+
+  values.push_back(4);
+  EXPECT_TRUE(values.isInline());
+  values.push_back(5);
+  EXPECT_FALSE(values.isInline());
+  EXPECT_EQ(values, (utils::SmallVector<uint16_t, 4>{1, 2, 3, 4, 5}));
+
+  // Moving heap storage steals it
+  auto data = values.data();
+  auto moved = std::move(values);
+  EXPECT_EQ(moved.data(), data);
+  EXPECT_TRUE(values.empty());
+  EXPECT_TRUE(values.isInline());
+
+  auto copy = moved;
+  EXPECT_EQ(copy, moved);
+  EXPECT_NE(copy.data(), moved.data());
+
+  copy.resize(2);
+  copy.resize(4, 7);
+  EXPECT_EQ(copy, (utils::SmallVector<uint16_t, 4>{1, 2, 7, 7}));
+  EXPECT_EQ(std::vector<uint16_t>(copy), (std::vector<uint16_t>{1, 2, 7, 7}));
+}
+
+TEST(SmallVector, ShortFramesStayInline) {
+  auto request = ModbusRequest::fromRaw({0x01, 0x10, 0x00, 0x01, 0x00, 0x02,
+                                         0x04, 0x00, 0x0A, 0x01, 0x02});
+  EXPECT_TRUE(request.registerValues().isInline());
+
+  auto copy = request;
+  EXPECT_TRUE(copy.registerValues().isInline());
+  EXPECT_EQ(copy.registerValues()[1].reg(), 0x0102);
+
+  auto response = ModbusResponse::fromRaw({0x01, 0x10, 0x00, 0x01, 0x00, 0x02});
+  response.from(request);
+  EXPECT_TRUE(response.registerValues().isInline());
+  EXPECT_EQ(response.registerValues()[0].reg(), 0x000A);
+
+  std::vector<ModbusCell> large(100, ModbusCell::initReg(3));
+  ModbusRequest write(1, utils::WriteMultipleAnalogOutputHoldingRegisters, 0,
+                      100, large);
+  EXPECT_FALSE(write.registerValues().isInline());
+  EXPECT_EQ(write.registerValues().size(), 100);
+}
+
+TEST(SmallVector, MemoryResource) {
+  // Arena without upstream, any allocation outside of it would throw
+  std::array<std::byte, 4096> buffer;
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                            std::pmr::null_memory_resource());
+
+  std::vector<ModbusCell> large(100, ModbusCell::initReg(3));
+  ModbusRequest write(1, utils::WriteMultipleAnalogOutputHoldingRegisters, 0,
+                      100, large, &arena);
+  EXPECT_EQ(write.registerValues().resource(), &arena);
+
+  auto raw = write.toRaw(&arena);
+  EXPECT_EQ(raw.get_allocator().resource(), &arena);
+  EXPECT_EQ(std::vector<uint8_t>(raw.begin(), raw.end()), write.toRaw());
+
+  auto parsed = ModbusRequest::fromRaw(raw, &arena);
+  EXPECT_EQ(parsed.registerValues().resource(), &arena);
+  EXPECT_EQ(parsed.registerValues().size(), 100);
+  EXPECT_EQ(parsed.registerValues()[99].reg(), 3);
+
+  // Moving between resources copies instead of stealing arena memory
+  utils::SmallVector<uint16_t, 2> inArena({1, 2, 3}, &arena);
+  utils::SmallVector<uint16_t, 2> onHeap;
+  onHeap = std::move(inArena);
+  EXPECT_EQ(onHeap.resource(), std::pmr::get_default_resource());
+  EXPECT_EQ(onHeap, (utils::SmallVector<uint16_t, 2>{1, 2, 3}));
+}
@@ -0,0 +1,79 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusStats.hpp"
+#include "gtest/gtest.h"
+
+#include <thread>
+
+using namespace MB;
+
+TEST(Stats, Stages) {
+  Stats::reset();
+
+  ModbusRequest request(1, utils::ReadAnalogOutputHoldingRegisters, 0, 10);
+  auto raw = request.toRaw();
+  (void)ModbusRequest::fromRaw(raw);
+  {
+    MODBUS_STATS_SCOPE(Stats::Handler);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  auto stats = Stats::snapshot();
+  if constexpr (!Stats::Enabled) {
+    for (const auto &stage : stats)
+      EXPECT_EQ(stage.count, 0);
+    return;
+  }
+
+  EXPECT_EQ(stats[Stats::Encode].count, 1);
+  EXPECT_EQ(stats[Stats::Parse].count, 1);
+  EXPECT_EQ(stats[Stats::Receive].count, 0);
+
+  const auto &handler = stats[Stats::Handler];
+  ASSERT_EQ(handler.count, 1);
+  EXPECT_GE(handler.mean, 1.5e6);
+  EXPECT_LT(handler.mean, 1e9);
+  EXPECT_EQ(handler.max, handler.mean);
+  // Histogram is accurate up to factor of 2
+  EXPECT_GE(handler.percentile(99) * 2, handler.max);
+  EXPECT_LE(handler.percentile(50), handler.max);
+
+  Stats::reset();
+  EXPECT_EQ(Stats::snapshot()[Stats::Handler].count, 0);
+}
+
+TEST(Stats, Threads) {
+  if constexpr (!Stats::Enabled)
+    GTEST_SKIP() << "Library is built without MODBUS_STATS";
+
+  Stats::reset();
+  // Histograms of exited threads are kept
+  std::thread([] {
+    for (int i = 0; i < 3; i++) {
+      MODBUS_STATS_SCOPE(Stats::Handler);
+    }
+  }).join();
+  {
+    MODBUS_STATS_SCOPE(Stats::Handler);
+  }
+  EXPECT_EQ(Stats::snapshot()[Stats::Handler].count, 4);
+}
+
+TEST(Stats, Percentile) {
+  Stats::StageStats stats;
+  for (std::size_t i = 0; i < Stats::Buckets; i++)
+    stats.bucketLimits[i] = static_cast<double>(uint64_t(1) << i);
+  stats.buckets[3] = 90; // below 8
+  stats.buckets[10] = 10; // below 1024
+  stats.count = 100;
+  stats.max = 1000;
+
+  EXPECT_EQ(stats.percentile(50), 8);
+  EXPECT_EQ(stats.percentile(89), 8);
+  EXPECT_EQ(stats.percentile(95), 1000);
+  EXPECT_EQ(stats.percentile(100), 1000);
+  EXPECT_EQ(Stats::toString(Stats::Parse), "Parse");
+}
@@ -0,0 +1,276 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/TCP/asyncServer.hpp"
+#include "MB/modbusProtocol.hpp"
+#include "MB/modbusRouter.hpp"
+#include "gtest/gtest.h"
+
+#include <future>
+#include <mutex>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr int ServerPort = 15504;
+
+void sendAll(int fd, Protocol::TCPClient &client,
+             const std::vector<ModbusRequest> &requests) {
+  for (const auto &request : requests)
+    client.send(request, Protocol::Clock::now(), 2s);
+  while (!client.pendingOutput().empty()) {
+    const auto output = client.pendingOutput();
+    const auto sent = ::send(fd, output.data(), output.size(), 0);
+    if (sent <= 0)
+      throw std::runtime_error("Cannot send requests");
+    client.consumeOutput((std::size_t)sent);
+  }
+}
+
+// Reads until count transactions are completed
+std::vector<Protocol::Completion> awaitCompletions(int fd,
+                                                   Protocol::TCPClient &client,
+                                                   std::size_t count) {
+  std::vector<Protocol::Completion> completions;
+  uint8_t buffer[512];
+  while (completions.size() < count) {
+    pollfd pfd = {fd, POLLIN, 0};
+    if (::poll(&pfd, 1, 2000) <= 0)
+      throw std::runtime_error("Server did not respond");
+    const auto size = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (size <= 0)
+      throw std::runtime_error("Server closed connection");
+    client.receive(std::span<const uint8_t>(buffer, (std::size_t)size));
+    while (auto completion = client.nextEvent())
+      completions.push_back(std::move(*completion));
+  }
+  return completions;
+}
+
+// Sends requests back to back and returns completions in order of arrival
+std::vector<Protocol::Completion>
+transact(const std::vector<ModbusRequest> &requests) {
+  auto connection = TCP::Connection::with("127.0.0.1", ServerPort);
+  Protocol::TCPClient client;
+  sendAll(connection.getSockfd(), client, requests);
+  return awaitCompletions(connection.getSockfd(), client, requests.size());
+}
+
+ModbusResponse answer(const ModbusRequest &request) {
+  return ModbusResponse(
+      request.slaveID(), request.functionCode(), request.registerAddress(),
+      request.numberOfRegisters(),
+      ModbusCells(request.numberOfRegisters(),
+                  ModbusCell(static_cast<uint16_t>(request.registerAddress()))));
+}
+} // namespace
+
+TEST(TCPAsyncServer, CompletesOutOfOrder) {
+  std::vector<std::thread> workers;
+  TCP::AsyncServer server(
+      ServerPort, [&](const ModbusRequest &request, auto responder) {
+        if (request.registerAddress() == 1) {
+          // Slow device, answered later from another thread
+          workers.emplace_back([request,
+                                responder = std::move(responder)]() mutable {
+            std::this_thread::sleep_for(100ms);
+            responder.respond(answer(request));
+          });
+        } else {
+          responder.respond(answer(request));
+        }
+      });
+  std::thread loop([&] { server.run(); });
+
+  const auto completions =
+      transact({ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 1, 2),
+                ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 2, 2)});
+
+  server.stop();
+  loop.join();
+  for (auto &worker : workers)
+    worker.join();
+
+  ASSERT_EQ(completions.size(), 2);
+  // Transaction ids are assigned in order of sending
+  EXPECT_EQ(completions[0].transactionId, 1);
+  EXPECT_EQ(completions[1].transactionId, 0);
+  ASSERT_TRUE(completions[0].response.has_value());
+  ASSERT_TRUE(completions[1].response.has_value());
+  EXPECT_EQ(completions[0].response->registerValues()[0].reg(), 2);
+  EXPECT_EQ(completions[1].response->registerValues()[0].reg(), 1);
+}
+
+TEST(TCPAsyncServer, HandlerExceptions) {
+  TCP::AsyncServer server(
+      ServerPort, [](const ModbusRequest &request, auto) {
+        if (request.registerAddress() == 1)
+          throw ModbusException(utils::IllegalDataAddress, request.slaveID(),
+                                request.functionCode());
+        throw std::runtime_error("Handler failure");
+      });
+  std::thread loop([&] { server.run(); });
+
+  const auto completions =
+      transact({ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 1, 2),
+                ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 2, 2)});
+
+  server.stop();
+  loop.join();
+
+  ASSERT_EQ(completions.size(), 2);
+  ASSERT_TRUE(completions[0].error.has_value());
+  ASSERT_TRUE(completions[1].error.has_value());
+  EXPECT_EQ(completions[0].error->getErrorCode(), utils::IllegalDataAddress);
+  EXPECT_EQ(completions[1].error->getErrorCode(), utils::SlaveDeviceFailure);
+}
+
+TEST(TCPAsyncServer, PipelinedSynchronousResponses) {
+  // Many more requests than completion queue holds, all answered from
+  // within handler on the loop thread
+  TCP::AsyncServer server(
+      ServerPort,
+      [](const ModbusRequest &request, auto responder) {
+        responder.respond(answer(request));
+      },
+      4);
+  std::thread loop([&] { server.run(); });
+
+  std::vector<ModbusRequest> requests;
+  for (uint16_t address = 0; address < 1500; address++)
+    requests.emplace_back(1, utils::ReadAnalogOutputHoldingRegisters, address,
+                          1);
+  const auto completions = transact(requests);
+
+  server.stop();
+  loop.join();
+
+  ASSERT_EQ(completions.size(), requests.size());
+  for (const auto &completion : completions) {
+    ASSERT_TRUE(completion.response.has_value());
+    EXPECT_EQ(completion.response->registerValues()[0].reg(),
+              completion.transactionId);
+  }
+}
+
+TEST(TCPAsyncServer, PausesReadingWhileTooManyInFlight) {
+  std::mutex mutex;
+  std::vector<std::pair<ModbusRequest, TCP::AsyncServer::Responder>> pending;
+  std::size_t mostPending = 0;
+  TCP::AsyncServer server(
+      ServerPort, [&](const ModbusRequest &request, auto responder) {
+        std::lock_guard lock(mutex);
+        pending.emplace_back(request, std::move(responder));
+        mostPending = std::max(mostPending, pending.size());
+      });
+  std::thread loop([&] { server.run(); });
+
+  std::vector<ModbusRequest> requests;
+  for (uint16_t address = 0; address < 600; address++)
+    requests.emplace_back(1, utils::ReadAnalogOutputHoldingRegisters, address,
+                          1);
+  auto completions = std::async(std::launch::async, transact, requests);
+
+  // Nobody answers, so reading stops at the limit
+  std::this_thread::sleep_for(200ms);
+  {
+    std::lock_guard lock(mutex);
+    EXPECT_EQ(pending.size(), TCP::AsyncServer::MaxInFlight);
+  }
+
+  while (completions.wait_for(5ms) != std::future_status::ready) {
+    std::lock_guard lock(mutex);
+    for (auto &[request, responder] : pending)
+      responder.respond(answer(request));
+    pending.clear();
+  }
+
+  server.stop();
+  loop.join();
+
+  EXPECT_EQ(completions.get().size(), requests.size());
+  EXPECT_LE(mostPending, TCP::AsyncServer::MaxInFlight);
+}
+
+TEST(TCPAsyncServer, DroppedAndDoubleAnsweredRequests) {
+  TCP::AsyncServer server(
+      ServerPort, [](const ModbusRequest &request, auto responder) {
+        // Dropped responders release their requests
+        if (request.registerAddress() < 2 * TCP::AsyncServer::MaxInFlight)
+          return;
+        responder.respond(answer(request));
+        responder.respond(ModbusException(utils::SlaveDeviceFailure));
+        throw std::runtime_error("Handler failure after response");
+      });
+  std::thread loop([&] { server.run(); });
+
+  auto connection = TCP::Connection::with("127.0.0.1", ServerPort);
+  const auto fd = connection.getSockfd();
+  Protocol::TCPClient client;
+  std::vector<ModbusRequest> requests;
+  for (uint16_t address = 0; address <= 2 * TCP::AsyncServer::MaxInFlight;
+       address++)
+    requests.emplace_back(1, utils::ReadAnalogOutputHoldingRegisters, address,
+                          1);
+  sendAll(fd, client, requests);
+
+  // Only the last request is answered, exactly once
+  std::vector<uint8_t> received;
+  uint8_t buffer[512];
+  pollfd pfd = {fd, POLLIN, 0};
+  while (::poll(&pfd, 1, 300) > 0) {
+    const auto size = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (size <= 0)
+      break;
+    received.insert(received.end(), buffer, buffer + size);
+  }
+  server.stop();
+  loop.join();
+
+  ASSERT_EQ(received.size(), 6u + 5u);
+  client.receive(received);
+  const auto completion = client.nextEvent();
+  ASSERT_TRUE(completion.has_value());
+  ASSERT_TRUE(completion->response.has_value());
+  EXPECT_EQ(completion->response->registerAddress(),
+            2 * TCP::AsyncServer::MaxInFlight);
+}
+
+TEST(TCPAsyncServer, RouterBroadcasts) {
+  Router router;
+  auto bank = std::make_shared<DenseRegisterBank>(10);
+  router.add(1, bank);
+  TCP::AsyncServer server(
+      ServerPort, [&](const ModbusRequest &request, auto responder) {
+        if (auto response = router.handle(request))
+          responder.respond(*response);
+      });
+  std::thread loop([&] { server.run(); });
+
+  // Broadcasts are never answered, they must not use up the connection
+  std::vector<ModbusRequest> requests;
+  for (uint16_t value = 1; value <= 2 * TCP::AsyncServer::MaxInFlight; value++)
+    requests.push_back(ModbusRequest(Router::BroadcastUnit,
+                                     utils::WriteSingleAnalogOutputRegister, 3,
+                                     1, {value}));
+  requests.emplace_back(1, utils::ReadAnalogOutputHoldingRegisters, 3, 1);
+
+  auto connection = TCP::Connection::with("127.0.0.1", ServerPort);
+  Protocol::TCPClient client;
+  sendAll(connection.getSockfd(), client, requests);
+  const auto completions =
+      awaitCompletions(connection.getSockfd(), client, 1);
+
+  server.stop();
+  loop.join();
+
+  ASSERT_EQ(completions.size(), 1);
+  ASSERT_TRUE(completions[0].response.has_value());
+  EXPECT_EQ(completions[0].response->registerValues()[0].reg(),
+            2 * TCP::AsyncServer::MaxInFlight);
+}
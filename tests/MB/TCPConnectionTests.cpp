@@ -0,0 +1,204 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/TCP/connection.hpp"
+#include "MB/TCP/server.hpp"
+#include "MB/sharedClient.hpp"
+#include "allocationCounter.hpp"
+#include "gtest/gtest.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace MB;
+
+namespace {
+constexpr int ServerPort = 15505;
+
+// Client and server connected with socket pair
+std::pair<TCP::Connection, TCP::Connection> connectionPair() {
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    throw std::runtime_error("Cannot create socket pair");
+  return {TCP::Connection(fds[0]), TCP::Connection(fds[1])};
+}
+
+bool readable(int fd) {
+  pollfd pfd = {.fd = fd, .events = POLLIN, .revents = 0};
+  return ::poll(&pfd, 1, 0) > 0;
+}
+
+ModbusRequest readRequest(uint16_t address) {
+  return ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, address, 1);
+}
+
+// Answers with register equal to request address
+void answer(TCP::Connection &connection, const ModbusRequest &request) {
+  connection.sendResponse(ModbusResponse(1, request.functionCode(),
+                                         request.registerAddress(), 1,
+                                         {request.registerAddress()}));
+}
+} // namespace
+
+TEST(TCPConnection, RequestResponse) {
+  auto [client, server] = connectionPair();
+  client.setMessageId(7);
+
+  client.sendRequest(
+      ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 100, 2));
+  const auto request = server.awaitRequest();
+  EXPECT_EQ(server.getMessageId(), 7);
+  EXPECT_EQ(request.registerAddress(), 100);
+
+  server.sendResponse(ModbusResponse(1, request.functionCode(), 100, 2,
+                                     {uint16_t(5), uint16_t(6)}));
+  const auto response = client.awaitResponse();
+  EXPECT_EQ(response.registerValues()[1].reg(), 6);
+}
+
+TEST(TCPConnection, SteadyStateDoesNotAllocate) {
+  auto [client, server] = connectionPair();
+  const ModbusRequest request(1, utils::ReadAnalogOutputHoldingRegisters, 0,
+                              10);
+  const ModbusResponse response(1, utils::ReadAnalogOutputHoldingRegisters, 0,
+                                10, ModbusCells(10, ModbusCell(uint16_t(3))));
+
+  std::array<std::byte, 8192> arena;
+  std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size(),
+                                               std::pmr::null_memory_resource());
+  const auto transaction = [&] {
+    {
+      client.sendRequest(request, &resource);
+      const auto received = server.awaitRequest(&resource);
+      server.sendResponse(response, &resource);
+      const auto answer = client.awaitResponse(&resource);
+      EXPECT_EQ(answer.numberOfRegisters(), 10);
+    }
+    resource.release();
+  };
+
+  transaction();
+  Allocations::Counter counter;
+  for (int i = 0; i < 100; i++)
+    transaction();
+  EXPECT_EQ(counter.count(), 0);
+}
+
+TEST(TCPConnection, PipelinedRequests) {
+  auto [client, server] = connectionPair();
+
+  // Sent back to back, before server reads anything
+  for (uint16_t id = 1; id <= 3; id++) {
+    client.setMessageId(id);
+    client.sendRequest(
+        ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, id, 1));
+  }
+
+  for (uint16_t id = 1; id <= 3; id++) {
+    const auto request = server.awaitRequest();
+    EXPECT_EQ(server.getMessageId(), id);
+    EXPECT_EQ(request.registerAddress(), id);
+    EXPECT_EQ(server.hasBufferedRequest(), id < 3);
+
+    server.sendResponse(ModbusResponse(1, request.functionCode(), id, 1,
+                                       {uint16_t(id * 10)}));
+    // Held back until the response to the last buffered request
+    EXPECT_EQ(readable(client.getSockfd()), id == 3);
+  }
+
+  for (uint16_t id = 1; id <= 3; id++) {
+    client.setMessageId(id);
+    EXPECT_EQ(client.awaitResponse().registerValues()[0].reg(), id * 10);
+  }
+}
+
+TEST(TCPConnection, InvalidLength) {
+  auto [client, server] = connectionPair();
+  const std::vector<uint8_t> frame = {0, 1, 0, 0, 0x10, 0x00, 1, 3};
+  ASSERT_EQ(::send(client.getSockfd(), frame.data(), frame.size(), 0),
+            static_cast<ssize_t>(frame.size()));
+  EXPECT_THROW((void)server.awaitRequest(), ModbusException);
+}
+
+TEST(TCPConnection, InvalidProtocolId) {
+  auto [client, server] = connectionPair();
+  const std::vector<uint8_t> frame = {0, 1, 0, 1, 0, 6, 1, 3, 0, 0, 0, 1};
+  ASSERT_EQ(::send(client.getSockfd(), frame.data(), frame.size(), 0),
+            static_cast<ssize_t>(frame.size()));
+  EXPECT_THROW((void)server.awaitRequest(), ModbusException);
+}
+
+TEST(TCPConnection, ClosingFlushesHeldResponses) {
+  auto [client, server] = connectionPair();
+  for (uint16_t id = 1; id <= 2; id++) {
+    client.setMessageId(id);
+    client.sendRequest(readRequest(id));
+  }
+
+  {
+    auto closing = std::move(server);
+    const auto request = closing.awaitRequest();
+    ASSERT_TRUE(closing.hasBufferedRequest());
+    answer(closing, request);
+    EXPECT_FALSE(readable(client.getSockfd()));
+  }
+
+  client.setMessageId(1);
+  EXPECT_EQ(client.awaitResponse().registerValues()[0].reg(), 1);
+}
+
+TEST(TCPConnection, SharedClientLoopback) {
+  TCP::Server server(ServerPort);
+  std::thread device([&] {
+    auto connection = server.awaitConnection();
+    for (int i = 0; i < 3; i++)
+      answer(connection, connection.awaitRequest());
+  });
+
+  {
+    SharedClient<TCP::Connection> client(
+        TCP::Connection::with("127.0.0.1", ServerPort));
+    // Transaction ids 1, 2 and 3 are echoed back in network byte order
+    for (uint16_t address = 1; address <= 3; address++)
+      EXPECT_EQ(
+          client.submit(readRequest(address)).get().registerValues()[0].reg(),
+          address);
+  }
+  device.join();
+}
+
+TEST(TCPConnection, SharedClientDropsLateReply) {
+  TCP::Server server(ServerPort);
+  std::thread device([&] {
+    auto connection = server.awaitConnection();
+    // Second request is sent only after the first one timed out
+    const auto late = connection.awaitRequest();
+    const auto lateId = connection.getMessageId();
+    const auto next = connection.awaitRequest();
+    const auto nextId = connection.getMessageId();
+    connection.setMessageId(lateId);
+    answer(connection, late);
+    connection.setMessageId(nextId);
+    answer(connection, next);
+  });
+
+  {
+    auto connection = TCP::Connection::with("127.0.0.1", ServerPort);
+    connection.setTimeout(100);
+    SharedClient<TCP::Connection> client(std::move(connection));
+
+    try {
+      (void)client.submit(readRequest(1)).get();
+      ADD_FAILURE() << "Late reply was not reported as timeout";
+    } catch (const ModbusException &ex) {
+      EXPECT_EQ(ex.getErrorCode(), utils::Timeout);
+    }
+    // Reply to the first request arrives first and is skipped
+    EXPECT_EQ(client.submit(readRequest(2)).get().registerValues()[0].reg(),
+              2);
+  }
+  device.join();
+}
@@ -0,0 +1,123 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/TCP/discovery.hpp"
+#include "MB/TCP/server.hpp"
+#include "MB/modbusProtocol.hpp"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <poll.h>
+#include <thread>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr int SimulatorPort = 15502;
+
+// Loopback device: unit 1 serves up to 100 registers, unit 2 rejects probe,
+// unit 3 is silent and unit 4 is reported missing like by a gateway
+void simulate(TCP::Server &server, const std::atomic<bool> &stop) {
+  while (!stop) {
+    pollfd listening = {server.nativeHandle(), POLLIN, 0};
+    if (::poll(&listening, 1, 20) <= 0)
+      continue;
+
+    auto connection = server.awaitConnection();
+    Protocol::TCPServer protocol;
+    uint8_t buffer[512];
+    while (!stop) {
+      pollfd client = {connection.getSockfd(), POLLIN, 0};
+      if (::poll(&client, 1, 20) <= 0)
+        continue;
+      auto size = ::recv(connection.getSockfd(), buffer, sizeof(buffer), 0);
+      if (size <= 0)
+        break;
+
+      protocol.receive(std::span<const uint8_t>(buffer, (std::size_t)size));
+      while (auto incoming = protocol.nextEvent()) {
+        const auto &request = *incoming->request;
+        if (request.slaveID() == 1 && request.numberOfRegisters() <= 100) {
+          ModbusCells values(request.numberOfRegisters(),
+                             ModbusCell::initReg(7));
+          protocol.respond(incoming->transactionId,
+                           ModbusResponse(1, request.functionCode(),
+                                          request.registerAddress(),
+                                          request.numberOfRegisters(), values));
+        } else if (request.slaveID() == 1) {
+          protocol.respond(incoming->transactionId,
+                           ModbusException(utils::IllegalDataValue, 1,
+                                           request.functionCode()));
+        } else if (request.slaveID() == 2) {
+          protocol.respond(incoming->transactionId,
+                           ModbusException(utils::IllegalDataAddress, 2,
+                                           request.functionCode()));
+        } else if (request.slaveID() == 4) {
+          protocol.respond(
+              incoming->transactionId,
+              ModbusException(utils::GatewayTargetDeviceFailedToRespond, 4,
+                              request.functionCode()));
+        }
+      }
+
+      auto output = protocol.pendingOutput();
+      auto sent = ::send(connection.getSockfd(), output.data(), output.size(),
+                         MSG_NOSIGNAL);
+      if (sent > 0)
+        protocol.consumeOutput((std::size_t)sent);
+    }
+  }
+}
+} // namespace
+
+TEST(TCPDiscovery, HostsOf) {
+  auto hosts = TCP::Discovery::hostsOf("192.168.1.77/22");
+  ASSERT_EQ(hosts.size(), 1022);
+  EXPECT_EQ(hosts.front(), "192.168.0.1");
+  EXPECT_EQ(hosts.back(), "192.168.3.254");
+
+  EXPECT_EQ(TCP::Discovery::hostsOf("10.0.0.5"),
+            std::vector<std::string>{"10.0.0.5"});
+  EXPECT_EQ(TCP::Discovery::hostsOf("10.0.0.0/31").size(), 2);
+
+  EXPECT_THROW(TCP::Discovery::hostsOf("10.0.0.0/33"), std::runtime_error);
+  EXPECT_THROW(TCP::Discovery::hostsOf("10.0.0/8"), std::runtime_error);
+  EXPECT_THROW(TCP::Discovery::hostsOf("10.0.0.0/8x"), std::runtime_error);
+}
+
+TEST(TCPDiscovery, Loopback) {
+  TCP::Server server(SimulatorPort);
+  std::atomic<bool> stop = false;
+  std::thread simulator(simulate, std::ref(server), std::cref(stop));
+
+  TCP::DiscoveryOptions options;
+  options.port = SimulatorPort;
+  options.unitIds = {1, 2, 3, 4};
+  options.pipelineDepth = 2;
+  options.requestTimeout = 100ms;
+  auto devices = TCP::Discovery(options).scan({"127.0.0.1"});
+
+  stop = true;
+  simulator.join();
+
+  ASSERT_EQ(devices.size(), 2);
+  EXPECT_EQ(devices[0].address, "127.0.0.1");
+  EXPECT_EQ(devices[0].unitId, 1);
+  EXPECT_EQ(devices[0].maxRegisters, 100);
+  EXPECT_FALSE(devices[0].error.has_value());
+  EXPECT_LT(devices[0].latency, 100ms);
+
+  EXPECT_EQ(devices[1].unitId, 2);
+  EXPECT_EQ(devices[1].maxRegisters, 0);
+  EXPECT_EQ(devices[1].error, utils::IllegalDataAddress);
+}
+
+TEST(TCPDiscovery, NothingListening) {
+  TCP::DiscoveryOptions options;
+  options.port = SimulatorPort + 1;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(TCP::Discovery(options).scan({"127.0.0.1", "127.0.0.2"}).empty());
+  EXPECT_LT(std::chrono::steady_clock::now() - start, options.connectTimeout);
+}
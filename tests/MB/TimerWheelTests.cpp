@@ -0,0 +1,118 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/timerWheel.hpp"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+using Wheel = utils::TimerWheel<int>;
+const auto start = Wheel::Clock::time_point();
+
+std::vector<int> advance(Wheel &wheel, Wheel::Clock::time_point now) {
+  std::vector<int> fired;
+  wheel.advance(now, [&](int value) { fired.push_back(value); });
+  return fired;
+}
+} // namespace
+
+TEST(TimerWheel, FiresInOrder) {
+  Wheel wheel;
+  wheel.schedule(start + 30ms, 3);
+  wheel.schedule(start + 10ms, 1);
+  wheel.schedule(start + 20ms, 2);
+  EXPECT_EQ(wheel.size(), 3);
+  EXPECT_EQ(wheel.nextDeadline(), start + 10ms);
+
+  EXPECT_TRUE(advance(wheel, start + 9ms).empty());
+  EXPECT_EQ(advance(wheel, start + 25ms), (std::vector<int>{1, 2}));
+  EXPECT_EQ(advance(wheel, start + 1s), (std::vector<int>{3}));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(wheel.nextDeadline().has_value());
+}
+
+TEST(TimerWheel, Cancel) {
+  Wheel wheel;
+  auto first = wheel.schedule(start + 5ms, 1);
+  auto second = wheel.schedule(start + 5ms, 2);
+  EXPECT_TRUE(wheel.cancel(first));
+  EXPECT_FALSE(wheel.cancel(first));
+
+  // Reused storage must not be cancelled with old id
+  auto third = wheel.schedule(start + 6ms, 3);
+  EXPECT_EQ(third.index, first.index);
+  EXPECT_FALSE(wheel.cancel(first));
+
+  EXPECT_EQ(advance(wheel, start + 10ms), (std::vector<int>{2, 3}));
+  EXPECT_FALSE(wheel.cancel(second));
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheel, HigherLevels) {
+  Wheel wheel;
+  // Deadlines in every level and beyond the last one (64^4 ms ~ 4.6 h)
+  const std::vector<std::chrono::milliseconds> deadlines = {
+      1ms, 63ms, 64ms, 500ms, 4095ms, 4096ms, 300s, 2h, 10h};
+  for (std::size_t i = 0; i < deadlines.size(); i++)
+    wheel.schedule(start + deadlines[i], static_cast<int>(i));
+
+  for (std::size_t i = 0; i < deadlines.size(); i++) {
+    auto deadline = wheel.nextDeadline();
+    ASSERT_TRUE(deadline.has_value());
+    EXPECT_LE(*deadline, start + deadlines[i]);
+
+    EXPECT_TRUE(advance(wheel, start + deadlines[i] - 1ms).empty());
+    EXPECT_EQ(advance(wheel, start + deadlines[i]),
+              (std::vector<int>{static_cast<int>(i)}));
+  }
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheel, PastAndRescheduling) {
+  Wheel wheel(1ms, start);
+  advance(wheel, start + 100ms);
+
+  // Deadline in the past fires on next advance, even without time passing
+  wheel.schedule(start + 50ms, 1);
+  EXPECT_EQ(wheel.nextDeadline(), start + 100ms);
+  EXPECT_EQ(advance(wheel, start + 100ms), (std::vector<int>{1}));
+
+  // Periodic timer scheduled again from the callback
+  wheel.schedule(start + 110ms, 10);
+  std::vector<int> fired;
+  auto now = start + 100ms;
+  for (int i = 0; i < 5; i++) {
+    now += 10ms;
+    wheel.advance(now, [&](int value) {
+      fired.push_back(value);
+      wheel.schedule(now + 10ms, value + 1);
+    });
+  }
+  EXPECT_EQ(fired, (std::vector<int>{10, 11, 12, 13, 14}));
+  EXPECT_EQ(wheel.size(), 1);
+
+  wheel.clear();
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_TRUE(advance(wheel, now + 1h).empty());
+}
+
+TEST(TimerWheel, ManyTimers) {
+  Wheel wheel;
+  std::vector<Wheel::Id> ids;
+  for (int i = 0; i < 50000; i++)
+    ids.push_back(wheel.schedule(start + std::chrono::milliseconds(i % 1000), i));
+  // Every second one is answered before its timeout
+  for (std::size_t i = 0; i < ids.size(); i += 2)
+    EXPECT_TRUE(wheel.cancel(ids[i]));
+
+  auto fired = advance(wheel, start + 1s);
+  EXPECT_EQ(fired.size(), 25000);
+  for (std::size_t i = 1; i < fired.size(); i++)
+    EXPECT_LE(fired[i - 1] % 1000, fired[i] % 1000);
+  EXPECT_TRUE(wheel.empty());
+}
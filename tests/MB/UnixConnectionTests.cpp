@@ -0,0 +1,98 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/Unix/server.hpp"
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace MB;
+
+namespace {
+std::string socketPath() {
+  return (std::filesystem::temp_directory_path() /
+          ("modbus-test-" + std::to_string(::getpid()) + ".sock"))
+      .string();
+}
+} // namespace
+
+TEST(UnixConnection, RequestResponseWithFd) {
+  const auto path = socketPath();
+  Unix::Server server(path);
+
+  std::thread device([&server] {
+    auto connection = server.awaitConnection();
+    auto request = connection.awaitRequest();
+
+    // Value to respond with is read from the passed pipe
+    auto fds = connection.takeFds();
+    ASSERT_EQ(fds.size(), 1);
+    uint8_t value = 0;
+    EXPECT_EQ(::read(fds[0], &value, 1), 1);
+    ::close(fds[0]);
+
+    ModbusResponse response(request.slaveID(), request.functionCode(),
+                            request.registerAddress(),
+                            request.numberOfRegisters(),
+                            {ModbusCell::initReg(value)});
+    connection.sendResponse(response);
+  });
+
+  int pipe[2];
+  ASSERT_EQ(::pipe(pipe), 0);
+  ASSERT_EQ(::write(pipe[1], "\x2A", 1), 1);
+  ::close(pipe[1]);
+
+  auto client = Unix::Connection::with(path);
+  client.setMessageId(7);
+  auto raw = client.sendRequest(
+      ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 100, 1),
+      std::span<const int>(pipe, 1));
+  ::close(pipe[0]);
+  EXPECT_EQ(raw.size(), 12);
+  EXPECT_EQ(raw[1], 7);
+
+  auto response = client.awaitResponse();
+  device.join();
+
+  EXPECT_EQ(response.slaveID(), 1);
+  ASSERT_EQ(response.registerValues().size(), 1);
+  EXPECT_EQ(response.registerValues()[0].reg(), 0x2A);
+  EXPECT_TRUE(client.takeFds().empty());
+}
+
+TEST(UnixConnection, ServerPath) {
+  const auto path = socketPath();
+  {
+    Unix::Server server(path);
+    EXPECT_TRUE(std::filesystem::is_socket(path));
+    // Stale socket is replaced
+    Unix::Server replacement(path);
+    EXPECT_EQ(replacement.path(), path);
+  }
+  EXPECT_FALSE(std::filesystem::exists(path));
+  EXPECT_THROW(Unix::Connection::with(path), std::runtime_error);
+}
+
+TEST(UnixConnection, InvalidLength) {
+  const auto path = socketPath();
+  Unix::Server server(path);
+  auto client = Unix::Connection::with(path);
+  auto device = server.awaitConnection();
+  device.setTimeout(100);
+
+  // Length above the longest Modbus frame
+  const std::vector<uint8_t> frame = {0, 1, 0, 0, 0x10, 0x00, 1, 3};
+  ASSERT_EQ(::send(client.getSockfd(), frame.data(), frame.size(), 0),
+            static_cast<ssize_t>(frame.size()));
+  try {
+    (void)device.awaitRequest();
+    FAIL() << "Invalid length accepted";
+  } catch (const ModbusException &ex) {
+    EXPECT_EQ(ex.getErrorCode(), utils::ProtocolError);
+  }
+}
@@ -0,0 +1,26 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2020 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// Global operator new of test and benchmark executables is replaced by
+// allocationCounter.cpp, so that hot paths can be checked for heap allocations
+
+#pragma once
+
+#include <cstdint>
+
+namespace Allocations {
+//! Number of heap allocations made by current thread so far
+uint64_t thread() noexcept;
+
+//! Counts heap allocations made by current thread since construction
+class Counter {
+private:
+  uint64_t _start;
+
+public:
+  Counter() noexcept : _start(thread()) {}
+
+  [[nodiscard]] uint64_t count() const noexcept { return thread() - _start; }
+};
+} // namespace Allocations